@@ -11,59 +11,1674 @@
  * Copyright (C) 2024 Fossil Logic. All rights reserved.
  * -----------------------------------------------------------------------------
  */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include "fossil/lib/arguments.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <locale.h>
+#include <math.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+#endif
+#include <sys/stat.h>
+
+enum {
+    _FOSSIL_ARG_INDEX_CACHE = 16,  // option arrays whose index is kept between calls
+    _FOSSIL_ARG_RESPONSE_DEPTH = 8 // nesting limit for @file inside response files
+};
+
+// Open-addressed hash index over the option names of one fossil_option_t array
+typedef struct {
+    uint32_t mask;
+    uint32_t *hashes;
+    int32_t *slots;   // option position, -1 for an empty slot
+} fossil_arg_index_t;
+
+// Index held by the cache and by every parse reading it, freed with the last reference
+typedef struct {
+    fossil_arg_index_t index;
+    int32_t refs;
+} fossil_arg_shared_index_t;
+
+// Index remembered for an option array so repeated parses skip the rebuild
+typedef struct {
+    const fossil_option_t *options;
+    int32_t num_options;
+    uint64_t signature;       // of the name pointers the index was built from
+    uint64_t last_used;
+    fossil_arg_shared_index_t *shared;
+} fossil_arg_index_cache_t;
+
+static fossil_arg_index_cache_t fossil_arg_index_cache[_FOSSIL_ARG_INDEX_CACHE];
+static uint64_t fossil_arg_index_clock;
+
+#ifdef _WIN32
+static SRWLOCK fossil_arg_index_lock = SRWLOCK_INIT;
+    #define _FOSSIL_ARG_INDEX_LOCK()   AcquireSRWLockExclusive(&fossil_arg_index_lock)
+    #define _FOSSIL_ARG_INDEX_UNLOCK() ReleaseSRWLockExclusive(&fossil_arg_index_lock)
+#else
+static pthread_mutex_t fossil_arg_index_lock = PTHREAD_MUTEX_INITIALIZER;
+    #define _FOSSIL_ARG_INDEX_LOCK()   pthread_mutex_lock(&fossil_arg_index_lock)
+    #define _FOSSIL_ARG_INDEX_UNLOCK() pthread_mutex_unlock(&fossil_arg_index_lock)
+#endif
+
+// Contents of one @file or config file; option values point straight into
+// it, so it stays alive until fossil_arg_release_response_files()
+typedef struct fossil_arg_response {
+    struct fossil_arg_response *next;
+    char *data;
+    size_t size;
+    int32_t mapped;   // data is a private mapping rather than a heap copy
+} fossil_arg_response_t;
+
+// Read position inside a response file
+typedef struct {
+    char *pos;
+    char *end;
+} fossil_arg_cursor_t;
+
+// Argument source for the streaming parser, with the @file expansion stack
+typedef struct {
+    fossil_arg_next_t next;
+    void *context;
+    int32_t expand;   // follow @file arguments
+    int32_t depth;
+    fossil_arg_cursor_t files[_FOSSIL_ARG_RESPONSE_DEPTH];
+} fossil_arg_stream_t;
+
+// Name lookup for one parse: a referenced cached index of an option array, or
+// the private index of a schema; both are read without locking. Without an
+// index (allocation failure) names are found by a linear scan.
+typedef struct {
+    const fossil_option_t *options;
+    int32_t num_options;
+    const fossil_arg_index_t *index;
+} fossil_arg_lookup_t;
+
+// Where a parse stores what it finds: the option array itself, or a result
+// object that leaves the options untouched
+typedef struct {
+    fossil_option_t *options;
+    fossil_arg_result_t *result;
+} fossil_arg_target_t;
+
+struct fossil_arg_schema {
+    fossil_option_t *options;   // one block from fossil_arg_build_options
+    int32_t num_options;
+    fossil_arg_index_t index;
+    // Last usage text rendered for the schema, guarded by usage_lock
+    char *usage;
+    size_t usage_length;
+    char *usage_program;
+    int32_t usage_width;
+#ifdef _WIN32
+    SRWLOCK usage_lock;
+#else
+    pthread_mutex_t usage_lock;
+#endif
+};
+
+// One key/value line of a config file, pointing into the loaded file
+typedef struct {
+    const char *section;  // NULL for keys before the first [section]
+    const char *key;
+    const char *value;
+} fossil_arg_config_pair_t;
+
+// Tokenised config file, reused while the file on disk is unchanged
+typedef struct fossil_arg_config {
+    struct fossil_arg_config *next;
+    char *path;
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    int32_t errors;       // malformed lines found by the tokenizer
+    fossil_arg_response_t *file;
+    fossil_arg_config_pair_t *pairs;
+    size_t num_pairs;
+    size_t capacity;
+} fossil_arg_config_t;
+
+typedef void (*fossil_arg_config_emit_t)(void *context, const char *section, const char *key, const char *value);
+
+static fossil_arg_response_t *fossil_arg_responses;
+static fossil_arg_config_t *fossil_arg_configs;
+
+#ifdef _WIN32
+static SRWLOCK fossil_arg_response_lock = SRWLOCK_INIT;
+    #define _FOSSIL_ARG_RESPONSE_LOCK()   AcquireSRWLockExclusive(&fossil_arg_response_lock)
+    #define _FOSSIL_ARG_RESPONSE_UNLOCK() ReleaseSRWLockExclusive(&fossil_arg_response_lock)
+#else
+static pthread_mutex_t fossil_arg_response_lock = PTHREAD_MUTEX_INITIALIZER;
+    #define _FOSSIL_ARG_RESPONSE_LOCK()   pthread_mutex_lock(&fossil_arg_response_lock)
+    #define _FOSSIL_ARG_RESPONSE_UNLOCK() pthread_mutex_unlock(&fossil_arg_response_lock)
+#endif
+
+// FNV-1a over a name of known length, so keys need not be NUL-terminated
+static uint32_t fossil_arg_hash(const char* name, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int32_t fossil_arg_name_equals(const char* option_name, const char* name, size_t len) {
+    return option_name && strncmp(option_name, name, len) == 0 && option_name[len] == '\0';
+}
+
+// Round up to the alignment of the members placed at offset
+static size_t fossil_arg_align(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+static void fossil_arg_index_free(fossil_arg_index_t* index) {
+    free(index->hashes);
+    free(index->slots);
+    memset(index, 0, sizeof(*index));
+}
+
+// Build the index, the first option wins when names repeat (like the linear scan)
+static int32_t fossil_arg_index_build(fossil_arg_index_t* index, const fossil_option_t* options, int32_t num_options) {
+    uint32_t capacity = 8;
+    while (capacity < (uint32_t)num_options * 2) {
+        capacity <<= 1;
+    }
+
+    memset(index, 0, sizeof(*index));
+    index->hashes = malloc(capacity * sizeof(uint32_t));
+    index->slots = malloc(capacity * sizeof(int32_t));
+    if (!index->hashes || !index->slots) {
+        fossil_arg_index_free(index);
+        return -1;
+    }
+    index->mask = capacity - 1;
+    for (uint32_t i = 0; i < capacity; ++i) {
+        index->slots[i] = -1;
+    }
+
+    for (int32_t i = 0; i < num_options; ++i) {
+        if (!options[i].name) {
+            continue;
+        }
+        size_t len = strlen(options[i].name);
+        uint32_t hash = fossil_arg_hash(options[i].name, len);
+        uint32_t slot = hash & index->mask;
+        while (index->slots[slot] != -1) {
+            if (index->hashes[slot] == hash && fossil_arg_name_equals(options[index->slots[slot]].name, options[i].name, len)) {
+                break;
+            }
+            slot = (slot + 1) & index->mask;
+        }
+        if (index->slots[slot] == -1) {
+            index->hashes[slot] = hash;
+            index->slots[slot] = i;
+        }
+    }
+    return 0;
+}
+
+static int32_t fossil_arg_index_find(const fossil_arg_index_t* index, const fossil_option_t* options, const char* name, size_t len) {
+    uint32_t hash = fossil_arg_hash(name, len);
+    for (uint32_t slot = hash & index->mask; index->slots[slot] != -1; slot = (slot + 1) & index->mask) {
+        if (index->hashes[slot] == hash && fossil_arg_name_equals(options[index->slots[slot]].name, name, len)) {
+            return index->slots[slot];
+        }
+    }
+    return -1;
+}
+
+static int32_t fossil_arg_linear_find(const fossil_option_t* options, int32_t num_options, const char* name, size_t len) {
+    for (int32_t i = 0; i < num_options; ++i) {
+        if (fossil_arg_name_equals(options[i].name, name, len)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Fingerprint of an option array's names, pointers and text, so options
+// renamed, added, removed or edited in place all give a new signature.
+// Computed once per parse, never per lookup.
+static uint64_t fossil_arg_index_signature(const fossil_option_t* options, int32_t num_options) {
+    uint64_t hash = 14695981039346656037ULL ^ (uint64_t)num_options;
+    for (int32_t i = 0; i < num_options; ++i) {
+        const char* name = options[i].name;
+        hash = (hash ^ (uint64_t)(uintptr_t)name) * 1099511628211ULL;
+        for (; name && *name; ++name) {
+            hash = (hash ^ (unsigned char)*name) * 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+static void fossil_arg_index_release_locked(fossil_arg_shared_index_t* shared) {
+    if (shared && --shared->refs == 0) {
+        fossil_arg_index_free(&shared->index);
+        free(shared);
+    }
+}
+
+// Referenced index for an option array, built on first use and again only
+// when the array's names changed. Hand it back with fossil_arg_index_release.
+static fossil_arg_shared_index_t* fossil_arg_index_acquire(const fossil_option_t* options, int32_t num_options) {
+    uint64_t signature = fossil_arg_index_signature(options, num_options);
+    fossil_arg_index_cache_t* entry = NULL;
+
+    _FOSSIL_ARG_INDEX_LOCK();
+    for (int32_t i = 0; i < _FOSSIL_ARG_INDEX_CACHE; ++i) {
+        fossil_arg_index_cache_t* candidate = &fossil_arg_index_cache[i];
+        if (candidate->options == options && candidate->num_options == num_options) {
+            entry = candidate;
+            break;
+        }
+        if (!entry || candidate->last_used < entry->last_used) {
+            entry = candidate;  // least recently used is evicted
+        }
+    }
+
+    if (!entry->shared || entry->options != options || entry->num_options != num_options || entry->signature != signature) {
+        fossil_arg_index_release_locked(entry->shared);  // parses still reading it keep it alive
+        entry->shared = NULL;
+        entry->options = NULL;
+
+        fossil_arg_shared_index_t* shared = malloc(sizeof(fossil_arg_shared_index_t));
+        if (!shared || fossil_arg_index_build(&shared->index, options, num_options) != 0) {
+            free(shared);
+            _FOSSIL_ARG_INDEX_UNLOCK();
+            return NULL;
+        }
+        shared->refs = 1;  // the cache's own reference
+        entry->shared = shared;
+        entry->options = options;
+        entry->num_options = num_options;
+        entry->signature = signature;
+    }
+    entry->last_used = ++fossil_arg_index_clock;
+    fossil_arg_shared_index_t* shared = entry->shared;
+    ++shared->refs;
+    _FOSSIL_ARG_INDEX_UNLOCK();
+    return shared;
+}
+
+static void fossil_arg_index_release(fossil_arg_shared_index_t* shared) {
+    if (!shared) {
+        return;
+    }
+    _FOSSIL_ARG_INDEX_LOCK();
+    fossil_arg_index_release_locked(shared);
+    _FOSSIL_ARG_INDEX_UNLOCK();
+}
+
+// Find an option by name for a one-off lookup, through the index the last
+// parse of the array left in the cache. That index is not re-validated: hits
+// are verified by name and a miss, or an array never parsed, falls back to a
+// linear scan, so the answer is right even when the array changed since.
+static int32_t fossil_arg_find(const fossil_option_t* options, int32_t num_options, const char* name, size_t len) {
+    fossil_arg_shared_index_t* shared = NULL;
+    _FOSSIL_ARG_INDEX_LOCK();
+    for (int32_t i = 0; i < _FOSSIL_ARG_INDEX_CACHE; ++i) {
+        fossil_arg_index_cache_t* entry = &fossil_arg_index_cache[i];
+        if (entry->shared && entry->options == options && entry->num_options == num_options) {
+            shared = entry->shared;
+            ++shared->refs;
+            break;
+        }
+    }
+    _FOSSIL_ARG_INDEX_UNLOCK();
+
+    int32_t found = shared ? fossil_arg_index_find(&shared->index, options, name, len) : -1;
+    fossil_arg_index_release(shared);
+    return found != -1 ? found : fossil_arg_linear_find(options, num_options, name, len);
+}
+
+// Function to check if an option has been parsed
+int32_t fossil_arg_parse_has(fossil_option_t* options, int32_t num_options, const char*  option_name) {
+    if (!options || !option_name) {
+        return 0;
+    }
+    int32_t found = fossil_arg_find(options, num_options, option_name, strlen(option_name));
+    return found != -1 && options[found].parsed; // Option not found or not parsed
+}
+
+// Text sink that counts what it could not store, like snprintf
+typedef struct {
+    char* data;
+    size_t size;
+    size_t length;
+} fossil_arg_writer_t;
+
+static void fossil_arg_write(fossil_arg_writer_t* writer, const char* text, size_t len) {
+    if (len == 0) {
+        return;  // text may be NULL then, memcpy must not see it
+    }
+    if (writer->length < writer->size) {
+        size_t room = writer->size - writer->length;
+        memcpy(writer->data + writer->length, text, len < room ? len : room);
+    }
+    writer->length += len;
+}
+
+static void fossil_arg_write_str(fossil_arg_writer_t* writer, const char* text) {
+    fossil_arg_write(writer, text, strlen(text));
+}
+
+static void fossil_arg_writef(fossil_arg_writer_t* writer, const char* format, ...) {
+    va_list args, measure;
+    va_start(args, format);
+    va_copy(measure, args);
+    int len = vsnprintf(NULL, 0, format, measure);
+    va_end(measure);
+    if (len > 0) {
+        size_t room = writer->length < writer->size ? writer->size - writer->length : 0;
+        if ((size_t)len < room) {
+            vsnprintf(writer->data + writer->length, room, format, args);
+            writer->length += (size_t)len;
+        } else {
+            // Only part fits; format in full so the tail is cut at the right byte
+            char* text = room > 0 ? malloc((size_t)len + 1) : NULL;
+            if (text) {
+                vsnprintf(text, (size_t)len + 1, format, args);
+                fossil_arg_write(writer, text, (size_t)len);
+                free(text);
+            } else {
+                writer->length += (size_t)len;
+            }
+        }
+    }
+    va_end(args);
+}
+
+static void fossil_arg_write_pad(fossil_arg_writer_t* writer, size_t count) {
+    static const char spaces[] = "                                ";
+    while (count > 0) {
+        size_t chunk = count < sizeof(spaces) - 1 ? count : sizeof(spaces) - 1;
+        fossil_arg_write(writer, spaces, chunk);
+        count -= chunk;
+    }
+}
+
+static size_t fossil_arg_writer_finish(fossil_arg_writer_t* writer) {
+    if (writer->size > 0) {
+        writer->data[writer->length < writer->size ? writer->length : writer->size - 1] = '\0';
+    }
+    return writer->length;
+}
+
+static int32_t fossil_arg_num_choices(const fossil_option_t* option) {
+    return option->extra_data ? option->num_choices : 0;
+}
+
+// "-name <type>" part of a usage line
+static void fossil_arg_write_label(fossil_arg_writer_t* writer, const fossil_option_t* option) {
+    const fossil_combo_choice_t* choices = (const fossil_combo_choice_t*)option->extra_data;
+    fossil_arg_write_str(writer, "  -");
+    fossil_arg_write_str(writer, option->name);
+    switch (option->type) {
+        case COPTION_TYPE_INT:
+            fossil_arg_write_str(writer, " <int>");
+            break;
+        case COPTION_TYPE_STRING:
+            fossil_arg_write_str(writer, " <string>");
+            break;
+        case COPTION_TYPE_BOOL:
+            fossil_arg_write_str(writer, " (flag)");
+            break;
+        case COPTION_TYPE_COMBO:
+            if (fossil_arg_num_choices(option) == 0) {
+                fossil_arg_write_str(writer, " <choice>");
+                break;
+            }
+            for (int32_t j = 0; j < option->num_choices; ++j) {
+                fossil_arg_write_str(writer, j == 0 ? " {" : "|");
+                fossil_arg_write_str(writer, choices[j].name ? choices[j].name : "");
+            }
+            fossil_arg_write_str(writer, "}");
+            break;
+        case COPTION_TYPE_FEATURE:
+            fossil_arg_write_str(writer, " {enable|disable|auto}");
+            break;
+        case COPTION_TYPE_INT64:
+            fossil_arg_write_str(writer, " <int64>");
+            break;
+        case COPTION_TYPE_DOUBLE:
+            fossil_arg_write_str(writer, " <number>");
+            break;
+        case COPTION_TYPE_SIZE:
+            fossil_arg_write_str(writer, " <size>");
+            break;
+        case COPTION_TYPE_DURATION:
+            fossil_arg_write_str(writer, " <duration>");
+            break;
+        default:
+            fossil_arg_write_str(writer, " <?>");
+            break;
+    }
+}
+
+// Default value in the syntax the parser accepts, nothing for flags
+static void fossil_arg_write_default(fossil_arg_writer_t* writer, const fossil_option_t* option) {
+    static const struct {
+        const char* unit;
+        int64_t scale;
+    } units[] = {{"h", 3600000000000LL}, {"m", 60000000000LL}, {"s", 1000000000LL}, {"ms", 1000000LL}, {"us", 1000LL}};
+    const fossil_combo_choice_t* choices = (const fossil_combo_choice_t*)option->extra_data;
+
+    switch (option->type) {
+        case COPTION_TYPE_INT:
+            fossil_arg_writef(writer, "%d", (int)option->value.int_val);
+            break;
+        case COPTION_TYPE_INT64:
+            fossil_arg_writef(writer, "%lld", (long long)option->value.int64_val);
+            break;
+        case COPTION_TYPE_DOUBLE:
+            fossil_arg_writef(writer, "%g", option->value.double_val);
+            break;
+        case COPTION_TYPE_SIZE:
+            fossil_arg_writef(writer, "%llu", (unsigned long long)option->value.size_val);
+            break;
+        case COPTION_TYPE_STRING:
+            if (option->value.str_val) {
+                fossil_arg_write_str(writer, option->value.str_val);
+            }
+            break;
+        case COPTION_TYPE_COMBO:
+            for (int32_t j = 0; j < fossil_arg_num_choices(option); ++j) {
+                if (choices[j].name && choices[j].value == option->value.combo_val) {
+                    fossil_arg_write_str(writer, choices[j].name);
+                    return;
+                }
+            }
+            fossil_arg_writef(writer, "%d", (int)option->value.combo_val);
+            break;
+        case COPTION_TYPE_FEATURE:
+            fossil_arg_write_str(writer, option->value.feature_val == FEATURE_ENABLE ? "enable" :
+                                         option->value.feature_val == FEATURE_DISABLE ? "disable" : "auto");
+            break;
+        case COPTION_TYPE_DURATION: {
+            int64_t ns = option->value.duration_val;
+            for (size_t u = 0; u < sizeof(units) / sizeof(units[0]); ++u) {
+                if (ns != 0 && ns % units[u].scale == 0) {
+                    fossil_arg_writef(writer, "%lld%s", (long long)(ns / units[u].scale), units[u].unit);
+                    return;
+                }
+            }
+            fossil_arg_writef(writer, "%lldns", (long long)ns);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Make room for a word of the given length in the description column,
+// starting a new line when it would run past the width
+static void fossil_arg_write_break(fossil_arg_writer_t* writer, size_t word, size_t column, size_t width, size_t* line_used) {
+    if (*line_used > column && *line_used + 1 + word > width) {
+        fossil_arg_write_str(writer, "\n");
+        fossil_arg_write_pad(writer, column);
+        *line_used = column;
+    } else if (*line_used > column) {
+        fossil_arg_write_str(writer, " ");
+        ++*line_used;
+    }
+    *line_used += word;
+}
+
+// Word wrap text into the description column
+static void fossil_arg_write_wrapped(fossil_arg_writer_t* writer, const char* text, size_t column, size_t width, size_t* line_used) {
+    while (*text) {
+        while (*text == ' ') {
+            ++text;
+        }
+        size_t word = strcspn(text, " ");
+        if (word == 0) {
+            break;
+        }
+        fossil_arg_write_break(writer, word, column, width, line_used);
+        fossil_arg_write(writer, text, word);
+        text += word;
+    }
+}
+
+static void fossil_arg_render_usage(fossil_arg_writer_t* writer, const char* program_name, const fossil_option_t* options, int32_t num_options, int32_t width) {
+    size_t line_width = width > 0 ? (size_t)width : 80;
+    size_t column = 0;
+
+    // Descriptions start after the widest label, capped so they keep some room
+    for (int32_t i = 0; i < num_options; ++i) {
+        if (options[i].name) {
+            fossil_arg_writer_t counter = {NULL, 0, 0};
+            fossil_arg_write_label(&counter, &options[i]);
+            column = counter.length > column ? counter.length : column;
+        }
+    }
+    column = (column > 30 ? 30 : column) + 2;
+    if (line_width < column + 20) {
+        line_width = column + 20;
+    }
+
+    fossil_arg_write_str(writer, "Usage: ");
+    fossil_arg_write_str(writer, program_name);
+    fossil_arg_write_str(writer, " [options]\n\nOptions:\n");
+    for (int32_t i = 0; i < num_options; ++i) {
+        const fossil_option_t* option = &options[i];
+        if (!option->name) {
+            continue;
+        }
+
+        size_t start = writer->length;
+        fossil_arg_write_label(writer, option);
+        size_t line_used = writer->length - start;
+
+        fossil_arg_writer_t value = {NULL, 0, 0};
+        fossil_arg_write_default(&value, option);
+        if (!option->description && value.length == 0) {
+            fossil_arg_write_str(writer, "\n");
+            continue;
+        }
+
+        if (line_used + 2 > column) {
+            fossil_arg_write_str(writer, "\n");
+            line_used = 0;
+        }
+        fossil_arg_write_pad(writer, column - line_used);
+        line_used = column;
+        if (option->description) {
+            fossil_arg_write_wrapped(writer, option->description, column, line_width, &line_used);
+        }
+        if (value.length > 0) {
+            // Moved to the next line as one piece, its length is already measured
+            fossil_arg_write_break(writer, value.length + sizeof("(default: )") - 1, column, line_width, &line_used);
+            fossil_arg_write_str(writer, "(default: ");
+            fossil_arg_write_default(writer, option);
+            fossil_arg_write_str(writer, ")");
+        }
+        fossil_arg_write_str(writer, "\n");
+    }
+}
+
+size_t fossil_arg_format_usage(const char* program_name, const fossil_option_t* options, int32_t num_options,
+                               int32_t width, char* buffer, size_t size) {
+    fossil_arg_writer_t writer = {buffer, buffer ? size : 0, 0};
+    if (!program_name || (!options && num_options > 0)) {
+        return fossil_arg_writer_finish(&writer);
+    }
+    fossil_arg_render_usage(&writer, program_name, options, num_options, width);
+    return fossil_arg_writer_finish(&writer);
+}
+
+// Hand text that was rendered into a stack buffer, or the heap when it did
+// not fit, to stdout in one write
+static void fossil_arg_write_stdout(const char* text, size_t length) {
+    fwrite(text, 1, length, stdout);
+    fflush(stdout);
+}
+
+void fossil_arg_parse_usage(const char* program_name, fossil_option_t* options, int32_t num_options) {
+    if (!program_name || !options) {
+        fprintf(stderr, "Error: Invalid program name or options.\n");
+        return;
+    }
+
+    char local[4096];
+    size_t length = fossil_arg_format_usage(program_name, options, num_options, 0, local, sizeof(local));
+    if (length < sizeof(local)) {
+        fossil_arg_write_stdout(local, length);
+        return;
+    }
+    char* text = malloc(length + 1);
+    if (!text) {
+        fprintf(stderr, "Memory allocation error for usage text.\n");
+        return;
+    }
+    fossil_arg_format_usage(program_name, options, num_options, 0, text, length + 1);
+    fossil_arg_write_stdout(text, length);
+    free(text);
+}
+
+// Completion candidate: an option name, sorted for prefix searches
+typedef struct {
+    const char* name;
+    int32_t option;
+} fossil_arg_completion_entry_t;
+
+struct fossil_arg_completion {
+    const fossil_option_t* options;
+    int32_t num_options;
+    int32_t num_entries;
+    fossil_arg_completion_entry_t* entries;
+};
+
+static const char* const fossil_arg_feature_names[] = {"enable", "disable", "auto"};
+
+static int32_t fossil_arg_takes_choice(const fossil_option_t* option) {
+    return option->type == COPTION_TYPE_FEATURE || (option->type == COPTION_TYPE_COMBO && fossil_arg_num_choices(option) > 0);
+}
+
+static const char* fossil_arg_choice_name(const fossil_option_t* option, int32_t j) {
+    if (option->type == COPTION_TYPE_FEATURE) {
+        return j < 3 ? fossil_arg_feature_names[j] : NULL;
+    }
+    return j < fossil_arg_num_choices(option) ? ((const fossil_combo_choice_t*)option->extra_data)[j].name : NULL;
+}
+
+// "--name" for long options, "-n" for single letters
+static void fossil_arg_write_flag(fossil_arg_writer_t* writer, const char* name) {
+    fossil_arg_write_str(writer, name[1] ? "--" : "-");
+    fossil_arg_write_str(writer, name);
+}
+
+// Text inside single quotes, where only the quote itself needs care
+static void fossil_arg_write_quoted(fossil_arg_writer_t* writer, const char* text, int32_t zsh_spec) {
+    for (const char* p = text; *p; ++p) {
+        if (*p == '\'') {
+            fossil_arg_write_str(writer, "'\\''");
+        } else if (*p == '\n') {
+            fossil_arg_write_str(writer, " ");
+        } else {
+            if (zsh_spec && (*p == '[' || *p == ']' || *p == ':' || *p == '\\')) {
+                fossil_arg_write_str(writer, "\\");
+            }
+            fossil_arg_write(writer, p, 1);
+        }
+    }
+}
+
+static void fossil_arg_write_choices(fossil_arg_writer_t* writer, const fossil_option_t* option) {
+    const char* choice;
+    for (int32_t j = 0; (choice = fossil_arg_choice_name(option, j)) != NULL; ++j) {
+        if (j > 0) {
+            fossil_arg_write_str(writer, " ");
+        }
+        fossil_arg_write_quoted(writer, choice, 0);
+    }
+}
+
+static void fossil_arg_script_bash(fossil_arg_writer_t* writer, const char* program, const char* function,
+                                   const fossil_option_t* options, int32_t num_options, int32_t dynamic) {
+    fossil_arg_writef(writer, "# bash completion for %s\n%s() {\n", program, function);
+    if (dynamic) {
+        fossil_arg_write_str(writer, "    local IFS=$'\\n'\n    COMPREPLY=($(");
+        fossil_arg_write_str(writer, program);
+        fossil_arg_write_str(writer, " --fossil-complete \"${COMP_WORDS[COMP_CWORD-1]}\" \"${COMP_WORDS[COMP_CWORD]}\" 2>/dev/null))\n}\n");
+    } else {
+        fossil_arg_write_str(writer, "    local cur=\"${COMP_WORDS[COMP_CWORD]}\" prev=\"${COMP_WORDS[COMP_CWORD-1]}\"\n    case \"$prev\" in\n");
+        for (int32_t i = 0; i < num_options; ++i) {
+            if (!options[i].name || options[i].type == COPTION_TYPE_BOOL) {
+                continue;
+            }
+            fossil_arg_write_str(writer, "        ");
+            fossil_arg_write_flag(writer, options[i].name);
+            if (fossil_arg_takes_choice(&options[i])) {
+                fossil_arg_write_str(writer, ") COMPREPLY=($(compgen -W '");
+                fossil_arg_write_choices(writer, &options[i]);
+                fossil_arg_write_str(writer, "' -- \"$cur\")); return ;;\n");
+            } else {
+                fossil_arg_write_str(writer, ") COMPREPLY=(); return ;;\n");
+            }
+        }
+        fossil_arg_write_str(writer, "    esac\n    COMPREPLY=($(compgen -W '");
+        for (int32_t i = 0, first = 1; i < num_options; ++i) {
+            if (options[i].name) {
+                fossil_arg_write_str(writer, first ? "" : " ");
+                fossil_arg_write_flag(writer, options[i].name);
+                first = 0;
+            }
+        }
+        fossil_arg_write_str(writer, "' -- \"$cur\"))\n}\n");
+    }
+    fossil_arg_writef(writer, "complete -F %s %s\n", function, program);
+}
+
+static void fossil_arg_script_zsh(fossil_arg_writer_t* writer, const char* program, const char* function,
+                                  const fossil_option_t* options, int32_t num_options, int32_t dynamic) {
+    fossil_arg_writef(writer, "#compdef %s\n%s() {\n", program, function);
+    if (dynamic) {
+        fossil_arg_write_str(writer, "    local -a candidates\n    candidates=(${(f)\"$(");
+        fossil_arg_write_str(writer, program);
+        fossil_arg_write_str(writer, " --fossil-complete \"${words[CURRENT-1]}\" \"${words[CURRENT]}\" 2>/dev/null)\"})\n    compadd -a candidates\n}\n");
+    } else {
+        fossil_arg_write_str(writer, "    _arguments");
+        for (int32_t i = 0; i < num_options; ++i) {
+            const fossil_option_t* option = &options[i];
+            if (!option->name) {
+                continue;
+            }
+            fossil_arg_write_str(writer, " \\\n        '");
+            fossil_arg_write_flag(writer, option->name);
+            fossil_arg_write_str(writer, "[");
+            fossil_arg_write_quoted(writer, option->description ? option->description : option->name, 1);
+            fossil_arg_write_str(writer, "]");
+            if (fossil_arg_takes_choice(option)) {
+                fossil_arg_write_str(writer, ":value:(");
+                fossil_arg_write_choices(writer, option);
+                fossil_arg_write_str(writer, ")");
+            } else if (option->type != COPTION_TYPE_BOOL) {
+                fossil_arg_write_str(writer, ":value:");
+            }
+            fossil_arg_write_str(writer, "'");
+        }
+        fossil_arg_write_str(writer, "\n}\n");
+    }
+    fossil_arg_writef(writer, "compdef %s %s\n", function, program);
+}
+
+static void fossil_arg_script_fish(fossil_arg_writer_t* writer, const char* program,
+                                   const fossil_option_t* options, int32_t num_options, int32_t dynamic) {
+    fossil_arg_writef(writer, "# fish completion for %s\n", program);
+    if (dynamic) {
+        fossil_arg_writef(writer, "complete -c %s -f -a '(%s --fossil-complete (commandline -opc)[-1] (commandline -ct))'\n", program, program);
+        return;
+    }
+    for (int32_t i = 0; i < num_options; ++i) {
+        const fossil_option_t* option = &options[i];
+        if (!option->name) {
+            continue;
+        }
+        fossil_arg_write_str(writer, "complete -c ");
+        fossil_arg_write_str(writer, program);
+        fossil_arg_write_str(writer, option->name[1] ? " -l " : " -s ");
+        fossil_arg_write_str(writer, option->name);
+        if (fossil_arg_takes_choice(option)) {
+            fossil_arg_write_str(writer, " -x -a '");
+            fossil_arg_write_choices(writer, option);
+            fossil_arg_write_str(writer, "'");
+        } else if (option->type != COPTION_TYPE_BOOL) {
+            fossil_arg_write_str(writer, " -r");
+        }
+        if (option->description) {
+            fossil_arg_write_str(writer, " -d '");
+            fossil_arg_write_quoted(writer, option->description, 0);
+            fossil_arg_write_str(writer, "'");
+        }
+        fossil_arg_write_str(writer, "\n");
+    }
+}
+
+size_t fossil_arg_completion_script(const char* program_name, const fossil_option_t* options, int32_t num_options,
+                                    int32_t shell, char* buffer, size_t size) {
+    fossil_arg_writer_t writer = {buffer, buffer ? size : 0, 0};
+    char function[128] = "_fossil_complete_";
+    size_t prefix = strlen(function);
+    size_t len = program_name ? strlen(program_name) : 0;
+
+    // The name ends up unquoted in the script, so only plain characters are allowed
+    if (len == 0 || prefix + len >= sizeof(function) || (!options && num_options > 0)) {
+        fossil_arg_writer_finish(&writer);
+        return 0;
+    }
+    for (size_t i = 0; i < len; ++i) {
+        char c = program_name[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '.' || c == '_' || c == '-')) {
+            fossil_arg_writer_finish(&writer);
+            return 0;
+        }
+        function[prefix + i] = (c == '.' || c == '-') ? '_' : c;
+    }
+    function[prefix + len] = '\0';
+
+    int32_t dynamic = (shell & FOSSIL_ARG_SHELL_DYNAMIC) != 0;
+    switch (shell & ~FOSSIL_ARG_SHELL_DYNAMIC) {
+        case FOSSIL_ARG_SHELL_BASH:
+            fossil_arg_script_bash(&writer, program_name, function, options, num_options, dynamic);
+            break;
+        case FOSSIL_ARG_SHELL_ZSH:
+            fossil_arg_script_zsh(&writer, program_name, function, options, num_options, dynamic);
+            break;
+        case FOSSIL_ARG_SHELL_FISH:
+            fossil_arg_script_fish(&writer, program_name, options, num_options, dynamic);
+            break;
+        default:
+            writer.length = 0;
+            break;
+    }
+    return fossil_arg_writer_finish(&writer);
+}
+
+static int fossil_arg_completion_compare(const void* a, const void* b) {
+    const fossil_arg_completion_entry_t* left = (const fossil_arg_completion_entry_t*)a;
+    const fossil_arg_completion_entry_t* right = (const fossil_arg_completion_entry_t*)b;
+    return strcmp(left->name, right->name);
+}
+
+fossil_arg_completion_t* fossil_arg_completion_create(const fossil_option_t* options, int32_t num_options) {
+    if (!options || num_options < 0) {
+        return NULL;
+    }
+    size_t entries_offset = fossil_arg_align(sizeof(fossil_arg_completion_t), _Alignof(fossil_arg_completion_entry_t));
+    unsigned char* block = malloc(entries_offset + (size_t)num_options * sizeof(fossil_arg_completion_entry_t));
+    if (!block) {
+        return NULL;
+    }
+
+    fossil_arg_completion_t* completion = (fossil_arg_completion_t*)block;
+    completion->options = options;
+    completion->num_options = num_options;
+    completion->num_entries = 0;
+    completion->entries = (fossil_arg_completion_entry_t*)(block + entries_offset);
+    for (int32_t i = 0; i < num_options; ++i) {
+        if (options[i].name && options[i].name[0]) {
+            completion->entries[completion->num_entries].name = options[i].name;
+            completion->entries[completion->num_entries].option = i;
+            ++completion->num_entries;
+        }
+    }
+    qsort(completion->entries, (size_t)completion->num_entries, sizeof(fossil_arg_completion_entry_t), fossil_arg_completion_compare);
+    return completion;
+}
+
+void fossil_arg_completion_free(fossil_arg_completion_t* completion) {
+    free(completion);
+}
+
+// First entry not ordered before prefix; the matches follow it contiguously
+static int32_t fossil_arg_completion_lower_bound(const fossil_arg_completion_t* completion, const char* prefix, size_t len) {
+    int32_t low = 0;
+    int32_t high = completion->num_entries;
+    while (low < high) {
+        int32_t mid = low + (high - low) / 2;
+        if (strncmp(completion->entries[mid].name, prefix, len) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static int32_t fossil_arg_completion_exact(const fossil_arg_completion_t* completion, const char* name, size_t len) {
+    int32_t i = fossil_arg_completion_lower_bound(completion, name, len);
+    if (i < completion->num_entries && strncmp(completion->entries[i].name, name, len) == 0 && completion->entries[i].name[len] == '\0') {
+        return completion->entries[i].option;
+    }
+    return -1;
+}
+
+static void fossil_arg_complete_choices(fossil_arg_writer_t* writer, const fossil_option_t* option, const char* lead, size_t lead_len, const char* prefix) {
+    size_t len = strlen(prefix);
+    const char* choice;
+    for (int32_t j = 0; (choice = fossil_arg_choice_name(option, j)) != NULL; ++j) {
+        if (strncmp(choice, prefix, len) == 0) {
+            fossil_arg_write(writer, lead, lead_len);
+            fossil_arg_write_str(writer, choice);
+            fossil_arg_write_str(writer, "\n");
+        }
+    }
+}
+
+size_t fossil_arg_complete(const fossil_arg_completion_t* completion, const char* previous, const char* current,
+                           char* buffer, size_t size) {
+    fossil_arg_writer_t writer = {buffer, buffer ? size : 0, 0};
+    if (!completion) {
+        return fossil_arg_writer_finish(&writer);
+    }
+    previous = previous ? previous : "";
+    current = current ? current : "";
+
+    // Value of the option before the cursor
+    if (previous[0] == '-') {
+        const char* name = previous + 1 + (previous[1] == '-');
+        int32_t option = fossil_arg_completion_exact(completion, name, strlen(name));
+        if (option != -1 && completion->options[option].type != COPTION_TYPE_BOOL) {
+            if (fossil_arg_takes_choice(&completion->options[option])) {
+                fossil_arg_complete_choices(&writer, &completion->options[option], NULL, 0, current);
+            }
+            return fossil_arg_writer_finish(&writer);
+        }
+    }
+    if (current[0] != '-' && current[0] != '\0') {
+        return fossil_arg_writer_finish(&writer);  // a positional argument
+    }
+
+    const char* name = current[0] == '-' ? current + 1 + (current[1] == '-') : current;
+    const char* equals = strchr(name, '=');
+    if (equals) {
+        // --name=partial completes the value in place
+        int32_t option = fossil_arg_completion_exact(completion, name, (size_t)(equals - name));
+        if (option != -1 && fossil_arg_takes_choice(&completion->options[option])) {
+            fossil_arg_complete_choices(&writer, &completion->options[option], current, (size_t)(equals + 1 - current), equals + 1);
+        }
+        return fossil_arg_writer_finish(&writer);
+    }
+
+    size_t len = strlen(name);
+    for (int32_t i = fossil_arg_completion_lower_bound(completion, name, len);
+         i < completion->num_entries && strncmp(completion->entries[i].name, name, len) == 0; ++i) {
+        fossil_arg_write_flag(&writer, completion->entries[i].name);
+        fossil_arg_write_str(&writer, "\n");
+    }
+    return fossil_arg_writer_finish(&writer);
+}
+
+int32_t fossil_arg_completion_request(const fossil_arg_completion_t* completion, const fossil_command_line_t* cmd) {
+    if (!completion || !cmd || cmd->argc < 2 || strcmp(cmd->argv[1], "--fossil-complete") != 0) {
+        return 0;
+    }
+
+    const char* previous = cmd->argc > 2 ? cmd->argv[2] : "";
+    const char* current = cmd->argc > 3 ? cmd->argv[3] : "";
+    char local[4096];
+    size_t length = fossil_arg_complete(completion, previous, current, local, sizeof(local));
+    if (length < sizeof(local)) {
+        fossil_arg_write_stdout(local, length);
+        return 1;
+    }
+    char* text = malloc(length + 1);
+    if (text) {
+        fossil_arg_complete(completion, previous, current, text, length + 1);
+        fossil_arg_write_stdout(text, length);
+        free(text);
+    }
+    return 1;
+}
+
+// Accumulate decimal digits; 19 digits always fit in 64 bits, so only the
+// digits after those need an overflow check
+static const char* fossil_arg_scan_u64(const char* p, uint64_t* out, int32_t* overflow) {
+    uint64_t acc = 0;
+    for (int32_t n = 0; n < 19 && (unsigned)(*p - '0') < 10; ++n) {
+        acc = acc * 10 + (uint64_t)(*p++ - '0');
+    }
+    while ((unsigned)(*p - '0') < 10) {
+        uint64_t digit = (uint64_t)(*p++ - '0');
+        if (acc > (UINT64_MAX - digit) / 10) {
+            *overflow = 1;
+        } else {
+            acc = acc * 10 + digit;
+        }
+    }
+    *out = acc;
+    return p;
+}
+
+static int32_t fossil_arg_parse_i64(const char* text, int64_t min, int64_t max, int64_t* out) {
+    const char* p = text;
+    int32_t negative = (*p == '-');
+    int32_t overflow = 0;
+    uint64_t magnitude;
+
+    p += (*p == '-' || *p == '+');
+    if ((unsigned)(*p - '0') >= 10) {
+        return FOSSIL_ARG_ERROR_INVALID;
+    }
+    p = fossil_arg_scan_u64(p, &magnitude, &overflow);
+    if (*p != '\0') {
+        return FOSSIL_ARG_ERROR_INVALID;
+    }
+
+    uint64_t limit = negative ? (uint64_t)(-(min + 1)) + 1 : (uint64_t)max;
+    if (overflow || magnitude > limit) {
+        return FOSSIL_ARG_ERROR_RANGE;
+    }
+    *out = negative ? -(int64_t)(magnitude - 1) - 1 : (int64_t)magnitude;
+    return FOSSIL_ARG_OK;
+}
+
+// Exact for up to 19 significant digits with |exponent| <= 22 (Clinger's
+// fast path), everything else goes through strtod in the "C" locale, so
+// '.' is the decimal point whatever the program's locale is
+static int32_t fossil_arg_parse_double(const char* text, double* out) {
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char* p = text;
+    int32_t negative = (*p == '-');
+    uint64_t mantissa = 0;
+    int32_t digits = 0;
+    int32_t exponent = 0;
+    int32_t truncated = 0;
+    int32_t seen = 0;
+
+    p += (*p == '-' || *p == '+');
+    for (; (unsigned)(*p - '0') < 10; ++p, seen = 1) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            digits += (mantissa != 0);
+        } else {
+            truncated |= (*p != '0');
+            ++exponent;
+        }
+    }
+    if (*p == '.') {
+        for (++p; (unsigned)(*p - '0') < 10; ++p, seen = 1) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                digits += (mantissa != 0);
+                --exponent;
+            } else {
+                truncated |= (*p != '0');
+            }
+        }
+    }
+    if (!seen) {
+        return FOSSIL_ARG_ERROR_INVALID;
+    }
+    if (*p == 'e' || *p == 'E') {
+        int32_t exp_negative = (p[1] == '-');
+        int32_t exp_value = 0;
+        p += 1 + (p[1] == '-' || p[1] == '+');
+        if ((unsigned)(*p - '0') >= 10) {
+            return FOSSIL_ARG_ERROR_INVALID;
+        }
+        for (; (unsigned)(*p - '0') < 10; ++p) {
+            exp_value = exp_value < 100000 ? exp_value * 10 + (*p - '0') : exp_value;
+        }
+        exponent += exp_negative ? -exp_value : exp_value;
+    }
+    if (*p != '\0') {
+        return FOSSIL_ARG_ERROR_INVALID;
+    }
+
+    if (!truncated && mantissa <= ((uint64_t)1 << 53) && exponent >= -22 && exponent <= 22) {
+        double result = (double)mantissa;
+        result = exponent < 0 ? result / powers[-exponent] : result * powers[exponent];
+        *out = negative ? -result : result;
+        return FOSSIL_ARG_OK;
+    }
+
+    double result;
+    errno = 0;
+#ifdef _WIN32
+    _locale_t c_locale = _create_locale(LC_NUMERIC, "C");
+    if (!c_locale) {
+        return FOSSIL_ARG_ERROR_INVALID;
+    }
+    result = _strtod_l(text, NULL, c_locale);
+    int32_t failed = (errno == ERANGE && isinf(result));
+    _free_locale(c_locale);
+#else
+    // uselocale only switches the calling thread
+    locale_t c_locale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+    if (c_locale == (locale_t)0) {
+        return FOSSIL_ARG_ERROR_INVALID;
+    }
+    locale_t previous = uselocale(c_locale);
+    result = strtod(text, NULL);
+    int32_t failed = (errno == ERANGE && isinf(result));
+    uselocale(previous);
+    freelocale(c_locale);
+#endif
+    if (failed) {
+        return FOSSIL_ARG_ERROR_RANGE;
+    }
+    *out = result;
+    return FOSSIL_ARG_OK;
+}
+
+static int32_t fossil_arg_parse_size(const char* text, uint64_t* out) {
+    const char* p = text;
+    int32_t overflow = 0;
+    uint32_t shift = 0;
+    uint64_t amount;
+
+    if ((unsigned)(*p - '0') >= 10) {
+        return FOSSIL_ARG_ERROR_INVALID;
+    }
+    p = fossil_arg_scan_u64(p, &amount, &overflow);
+
+    switch (*p | 0x20) {
+        case 'k': shift = 10; break;
+        case 'm': shift = 20; break;
+        case 'g': shift = 30; break;
+        case 't': shift = 40; break;
+        case 'p': shift = 50; break;
+        default: break;
+    }
+    if (shift) {
+        ++p;
+        p += (*p == 'i');  // KiB and friends
+    }
+    p += ((*p | 0x20) == 'b');
+    if (*p != '\0') {
+        return FOSSIL_ARG_ERROR_INVALID;
+    }
+    if (overflow || (shift && amount > (UINT64_MAX >> shift))) {
+        return FOSSIL_ARG_ERROR_RANGE;
+    }
+    *out = amount << shift;
+    return FOSSIL_ARG_OK;
+}
+
+// Sequence of <number><unit> parts (ns, us, ms, s, m, h, d), a bare number is seconds
+static int32_t fossil_arg_parse_duration(const char* text, int64_t* out) {
+    const char* p = text;
+    uint64_t total = 0;
+
+    do {
+        int32_t overflow = 0;
+        uint64_t amount;
+        uint64_t unit;
+
+        if ((unsigned)(*p - '0') >= 10) {
+            return FOSSIL_ARG_ERROR_INVALID;
+        }
+        p = fossil_arg_scan_u64(p, &amount, &overflow);
+
+        if (p[0] == 'n' && p[1] == 's') {
+            unit = 1ULL;
+            p += 2;
+        } else if (p[0] == 'u' && p[1] == 's') {
+            unit = 1000ULL;
+            p += 2;
+        } else if (p[0] == 'm' && p[1] == 's') {
+            unit = 1000000ULL;
+            p += 2;
+        } else if (p[0] == 's') {
+            unit = 1000000000ULL;
+            p += 1;
+        } else if (p[0] == 'm') {
+            unit = 60ULL * 1000000000ULL;
+            p += 1;
+        } else if (p[0] == 'h') {
+            unit = 3600ULL * 1000000000ULL;
+            p += 1;
+        } else if (p[0] == 'd') {
+            unit = 86400ULL * 1000000000ULL;
+            p += 1;
+        } else if (*p == '\0' && p != text && total == 0) {
+            unit = 1000000000ULL;
+        } else {
+            return FOSSIL_ARG_ERROR_INVALID;
+        }
+
+        if (overflow || amount > (uint64_t)INT64_MAX / unit || total > (uint64_t)INT64_MAX - amount * unit) {
+            return FOSSIL_ARG_ERROR_RANGE;
+        }
+        total += amount * unit;
+    } while (*p != '\0');
+
+    *out = (int64_t)total;
+    return FOSSIL_ARG_OK;
+}
+
+static int32_t fossil_arg_parse_bool(const char* text, int32_t* out) {
+    static const char* truthy[] = {"true", "yes", "on", "1"};
+    static const char* falsy[] = {"false", "no", "off", "0"};
+    for (size_t i = 0; i < sizeof(truthy) / sizeof(truthy[0]); ++i) {
+        if (strcmp(text, truthy[i]) == 0) {
+            *out = 1;
+            return FOSSIL_ARG_OK;
+        }
+        if (strcmp(text, falsy[i]) == 0) {
+            *out = 0;
+            return FOSSIL_ARG_OK;
+        }
+    }
+    return FOSSIL_ARG_ERROR_INVALID;
+}
+
+int32_t fossil_arg_parse_value(const fossil_option_t* option, const char* text, fossil_option_value_t* value) {
+    int32_t result = FOSSIL_ARG_ERROR_INVALID;
+    int64_t integer = 0;
+
+    if (!option || !text || !value) {
+        return FOSSIL_ARG_ERROR_INVALID;
+    }
+
+    switch (option->type) {
+        case COPTION_TYPE_INT:
+            result = fossil_arg_parse_i64(text, INT32_MIN, INT32_MAX, &integer);
+            if (result == FOSSIL_ARG_OK) {
+                value->int_val = (int32_t)integer;
+            }
+            break;
+        case COPTION_TYPE_INT64:
+            result = fossil_arg_parse_i64(text, INT64_MIN, INT64_MAX, &value->int64_val);
+            break;
+        case COPTION_TYPE_STRING:
+            value->str_val = (char*)text;
+            result = FOSSIL_ARG_OK;
+            break;
+        case COPTION_TYPE_BOOL:
+            result = fossil_arg_parse_bool(text, &value->bool_val);
+            break;
+        case COPTION_TYPE_COMBO: {
+            const fossil_combo_choice_t* choices = (const fossil_combo_choice_t*)option->extra_data;
+            for (int32_t i = 0; choices && i < option->num_choices; ++i) {
+                if (choices[i].name && strcmp(text, choices[i].name) == 0) {
+                    value->combo_val = choices[i].value;
+                    result = FOSSIL_ARG_OK;
+                    break;
+                }
+            }
+            break;
+        }
+        case COPTION_TYPE_FEATURE:
+            result = FOSSIL_ARG_OK;
+            if (strcmp(text, "enable") == 0) {
+                value->feature_val = FEATURE_ENABLE;
+            } else if (strcmp(text, "disable") == 0) {
+                value->feature_val = FEATURE_DISABLE;
+            } else if (strcmp(text, "auto") == 0) {
+                value->feature_val = FEATURE_AUTO;
+            } else {
+                result = FOSSIL_ARG_ERROR_INVALID;
+            }
+            break;
+        case COPTION_TYPE_DOUBLE:
+            result = fossil_arg_parse_double(text, &value->double_val);
+            break;
+        case COPTION_TYPE_SIZE:
+            result = fossil_arg_parse_size(text, &value->size_val);
+            break;
+        case COPTION_TYPE_DURATION:
+            result = fossil_arg_parse_duration(text, &value->duration_val);
+            break;
+        default:
+            break;
+    }
+    return result;
+}
+
+// Load a response or config file. With allow_map the file is mapped
+// copy-on-write so tokenising it in place only duplicates the pages that get
+// a terminator written into them. A file whose size is an exact multiple of
+// the page size has no spare byte for the last terminator and is read into
+// the heap instead.
+static fossil_arg_response_t* fossil_arg_file_load(const char* path, int32_t allow_map) {
+    fossil_arg_response_t* response = calloc(1, sizeof(fossil_arg_response_t));
+    if (!response) {
+        return NULL;
+    }
+
+#ifdef _WIN32
+    (void)allow_map;
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        free(response);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    response->data = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    if (!response->data || fread(response->data, 1, (size_t)size, file) != (size_t)size) {
+        fclose(file);
+        free(response->data);
+        free(response);
+        return NULL;
+    }
+    fclose(file);
+    response->size = (size_t)size;
+#else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat info;
+    if (fd < 0) {
+        free(response);
+        return NULL;
+    }
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        close(fd);
+        free(response);
+        return NULL;
+    }
+
+    response->size = (size_t)info.st_size;
+    long page = sysconf(_SC_PAGESIZE);
+    if (allow_map && response->size > 0 && page > 0 && response->size % (size_t)page != 0) {
+        void* map = mmap(NULL, response->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            response->data = map;
+            response->mapped = 1;
+        }
+    }
+    if (!response->mapped) {
+        size_t done = 0;
+        response->data = malloc(response->size + 1);
+        while (response->data && done < response->size) {
+            ssize_t got = read(fd, response->data + done, response->size - done);
+            if (got <= 0) {
+                free(response->data);
+                response->data = NULL;
+                break;
+            }
+            done += (size_t)got;
+        }
+    }
+    close(fd);
+    if (!response->data) {
+        free(response);
+        return NULL;
+    }
+#endif
+    return response;
+}
+
+// Hand a loaded file to the release list, values parsed from it may be in use
+static void fossil_arg_file_keep(fossil_arg_response_t* response) {
+    _FOSSIL_ARG_RESPONSE_LOCK();
+    response->next = fossil_arg_responses;
+    fossil_arg_responses = response;
+    _FOSSIL_ARG_RESPONSE_UNLOCK();
+}
+
+void fossil_arg_release_response_files(void) {
+    _FOSSIL_ARG_RESPONSE_LOCK();
+    fossil_arg_response_t* response = fossil_arg_responses;
+    fossil_arg_config_t* config = fossil_arg_configs;
+    fossil_arg_responses = NULL;
+    fossil_arg_configs = NULL;
+    _FOSSIL_ARG_RESPONSE_UNLOCK();
+
+    while (config) {
+        fossil_arg_config_t* next = config->next;
+        if (config->file) {
+            config->file->next = response;
+            response = config->file;
+        }
+        free(config->pairs);
+        free(config->path);
+        free(config);
+        config = next;
+    }
+
+    while (response) {
+        fossil_arg_response_t* next = response->next;
+#ifndef _WIN32
+        if (response->mapped) {
+            munmap(response->data, response->size);
+        } else
+#endif
+        {
+            free(response->data);
+        }
+        free(response);
+        response = next;
+    }
+}
+
+static int32_t fossil_arg_is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// Next whitespace separated token of a response file, terminated in place.
+// Single and double quotes group text with spaces and a backslash escapes the
+// next character; both are removed by shifting the token down over them.
+static char* fossil_arg_response_token(fossil_arg_cursor_t* cursor) {
+    char* pos = cursor->pos;
+    char* end = cursor->end;
+
+    while (pos < end && fossil_arg_is_space(*pos)) {
+        ++pos;
+    }
+    if (pos == end) {
+        cursor->pos = pos;
+        return NULL;
+    }
+
+    char* token = pos;
+    char* out = pos;
+    char quote = '\0';
+    while (pos < end && (quote || !fossil_arg_is_space(*pos))) {
+        char c = *pos++;
+        if (quote && c == quote) {
+            quote = '\0';
+        } else if (!quote && (c == '"' || c == '\'')) {
+            quote = c;
+        } else if (c == '\\' && quote != '\'' && pos < end) {
+            *out++ = *pos++;
+        } else {
+            *out++ = c;
+        }
+    }
+    // out never passes pos, and pos < end or the buffer has a spare byte
+    *out = '\0';
+    cursor->pos = pos < end ? pos + 1 : pos;
+    return token;
+}
+
+// Next argument from the stream. With expand set, @file arguments are
+// descended into and a name that cannot be opened is passed through as a
+// literal argument; without it the argument is returned as it is.
+static const char* fossil_arg_stream_pull(fossil_arg_stream_t* stream, int32_t expand) {
+    for (;;) {
+        const char* arg;
+        if (stream->depth > 0) {
+            arg = fossil_arg_response_token(&stream->files[stream->depth - 1]);
+            if (!arg) {
+                --stream->depth;
+                continue;
+            }
+        } else {
+            arg = stream->next(stream->context);
+            if (!arg) {
+                return NULL;
+            }
+        }
+
+        if (expand && stream->expand && arg[0] == '@' && arg[1] != '\0' && stream->depth < _FOSSIL_ARG_RESPONSE_DEPTH) {
+            fossil_arg_response_t* response = fossil_arg_file_load(arg + 1, 1);
+            if (response) {
+                fossil_arg_file_keep(response);
+                stream->files[stream->depth].pos = response->data;
+                stream->files[stream->depth].end = response->data + response->size;
+                ++stream->depth;
+                continue;
+            }
+        }
+        return arg;
+    }
+}
+
+// Next argument where an option or positional is expected, @file expands here
+static const char* fossil_arg_stream_next(fossil_arg_stream_t* stream) {
+    return fossil_arg_stream_pull(stream, 1);
+}
+
+// Next argument as the value of an option, taken literally (--user @alice)
+static const char* fossil_arg_stream_value(fossil_arg_stream_t* stream) {
+    return fossil_arg_stream_pull(stream, 0);
+}
+
+typedef struct {
+    char** argv;
+    int argc;
+    int next;
+} fossil_arg_argv_source_t;
+
+static const char* fossil_arg_argv_next(void* context) {
+    fossil_arg_argv_source_t* source = (fossil_arg_argv_source_t*)context;
+    return source->next < source->argc ? source->argv[source->next++] : NULL;
+}
+
+static int32_t fossil_arg_lookup(const fossil_arg_lookup_t* lookup, const char* name, size_t len) {
+    if (lookup->index) {
+        return fossil_arg_index_find(lookup->index, lookup->options, name, len);
+    }
+    return fossil_arg_linear_find(lookup->options, lookup->num_options, name, len);
+}
+
+enum {
+    _FOSSIL_ARG_TOKEN_POSITIONAL,  // not an option, or a lone "-"
+    _FOSSIL_ARG_TOKEN_END,         // "--", everything after it is positional
+    _FOSSIL_ARG_TOKEN_OPTION,      // -name, --name, -name=value, --name=value
+    _FOSSIL_ARG_TOKEN_NEGATED,     // --no-name for a flag or feature
+    _FOSSIL_ARG_TOKEN_BUNDLE,      // -abc, single letter options run together
+    _FOSSIL_ARG_TOKEN_UNKNOWN
+};
+
+typedef struct {
+    int32_t kind;
+    int32_t index;       // option for OPTION and NEGATED
+    const char* value;   // text after '=', NULL when the value is not inline
+} fossil_arg_token_t;
+
+// Classify one argument by its leading bytes; the '=' is found with memchr,
+// which the C library vectorises, and nothing is copied or allocated
+static fossil_arg_token_t fossil_arg_classify(const fossil_arg_lookup_t* lookup, const char* arg) {
+    fossil_arg_token_t token = {_FOSSIL_ARG_TOKEN_POSITIONAL, -1, NULL};
+    if (arg[0] != '-' || arg[1] == '\0') {
+        return token;
+    }
+    int32_t is_long = (arg[1] == '-');
+    if (is_long && arg[2] == '\0') {
+        token.kind = _FOSSIL_ARG_TOKEN_END;
+        return token;
+    }
+
+    const char* name = arg + 1 + is_long;
+    size_t len = strlen(name);
+    const char* equals = memchr(name, '=', len);
+    size_t name_len = equals ? (size_t)(equals - name) : len;
+
+    token.index = fossil_arg_lookup(lookup, name, name_len);
+    if (token.index != -1) {
+        token.kind = _FOSSIL_ARG_TOKEN_OPTION;
+        token.value = equals ? equals + 1 : NULL;
+        return token;
+    }
+    if (is_long && !equals && name_len > 3 && memcmp(name, "no-", 3) == 0) {
+        token.index = fossil_arg_lookup(lookup, name + 3, name_len - 3);
+        if (token.index != -1) {
+            fossil_option_type_t type = lookup->options[token.index].type;
+            if (type == COPTION_TYPE_BOOL || type == COPTION_TYPE_FEATURE) {
+                token.kind = _FOSSIL_ARG_TOKEN_NEGATED;
+                return token;
+            }
+        }
+        token.index = -1;
+    }
+    if (!is_long && len > 1 && fossil_arg_lookup(lookup, name, 1) != -1) {
+        token.kind = _FOSSIL_ARG_TOKEN_BUNDLE;
+        return token;
+    }
+    token.kind = _FOSSIL_ARG_TOKEN_UNKNOWN;
+    return token;
+}
+
+static fossil_option_value_t* fossil_arg_target_value(fossil_arg_target_t* target, int32_t index) {
+    return target->result ? &target->result->values[index] : &target->options[index].value;
+}
+
+static void fossil_arg_target_mark(fossil_arg_target_t* target, int32_t index) {
+    if (target->result) {
+        target->result->present[index / 64] |= (uint64_t)1 << (index % 64);
+    } else {
+        target->options[index].parsed = 1; // Mark the option as parsed
+    }
+}
+
+// Option arrays report problems on stderr like the rest of the parser, results
+// keep the first error so concurrent callers can handle it themselves
+static void fossil_arg_target_fail(fossil_arg_target_t* target, int32_t error, int32_t index, const char* format, ...) {
+    if (target->result) {
+        if (target->result->error == FOSSIL_ARG_OK) {
+            target->result->error = error;
+            target->result->error_option = index;
+        }
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
+
+static void fossil_arg_assign(const fossil_arg_lookup_t* lookup, fossil_arg_target_t* target, int32_t index, const char* text) {
+    const fossil_option_t* option = &lookup->options[index];
+    int32_t result = fossil_arg_parse_value(option, text, fossil_arg_target_value(target, index));
+    if (result == FOSSIL_ARG_ERROR_RANGE) {
+        fossil_arg_target_fail(target, result, index, "Error: Value '%s' is out of range for option '-%s'.\n", text, option->name);
+    } else if (result != FOSSIL_ARG_OK) {
+        fossil_arg_target_fail(target, result, index, "Error: Invalid value '%s' for option '-%s'.\n", text, option->name);
+    }
+}
+
+static void fossil_arg_parse_core(fossil_arg_stream_t* stream, const fossil_arg_lookup_t* lookup, fossil_arg_target_t* target) {
+    const fossil_option_t* options = lookup->options;
+    const char* arg;
+    while ((arg = fossil_arg_stream_next(stream)) != NULL) {
+        fossil_arg_token_t token = fossil_arg_classify(lookup, arg);
+        if (token.kind == _FOSSIL_ARG_TOKEN_END) {
+            return;
+        }
+        if (token.kind == _FOSSIL_ARG_TOKEN_UNKNOWN && target->result) {
+            fossil_arg_target_fail(target, FOSSIL_ARG_ERROR_INVALID, -1, "Error: Unrecognized option '%s'\n", arg);
+            continue;
+        }
+        if (token.kind == _FOSSIL_ARG_TOKEN_NEGATED) {
+            fossil_option_value_t* value = fossil_arg_target_value(target, token.index);
+            fossil_arg_target_mark(target, token.index);
+            if (options[token.index].type == COPTION_TYPE_BOOL) {
+                value->bool_val = 0;
+            } else {
+                value->feature_val = FEATURE_DISABLE;
+            }
+            continue;
+        }
+        if (token.kind == _FOSSIL_ARG_TOKEN_BUNDLE) {
+            // Flags until the first option that takes a value, which gets the
+            // rest of the argument (-j8) or the next argument (-j 8)
+            for (const char* p = arg + 1; *p; ++p) {
+                int32_t j = fossil_arg_lookup(lookup, p, 1);
+                if (j == -1) {
+                    fossil_arg_target_fail(target, FOSSIL_ARG_ERROR_INVALID, -1, "Error: Unrecognized flag '-%c' in '%s'.\n", *p, arg);
+                    break;
+                }
+                fossil_arg_target_mark(target, j);
+                if (options[j].type == COPTION_TYPE_BOOL) {
+                    fossil_arg_target_value(target, j)->bool_val = 1;
+                    continue;
+                }
+                const char* text = p[1] ? p + 1 : fossil_arg_stream_value(stream);
+                if (!text) {
+                    fossil_arg_target_fail(target, FOSSIL_ARG_ERROR_INVALID, j, "Error: Missing argument for option '-%s'.\n", options[j].name);
+                    return;
+                }
+                fossil_arg_assign(lookup, target, j, text);
+                break;
+            }
+            continue;
+        }
+        if (token.kind != _FOSSIL_ARG_TOKEN_OPTION) {
+            continue;
+        }
 
-// Function to check if an option has been parsed
-int32_t fossil_arg_parse_has(fossil_option_t* options, int32_t num_options, const char*  option_name) {
-    for (int32_t i = 0; i < num_options; ++i) {
-        if (strcmp(option_name, options[i].name) == 0 && options[i].parsed) {
-            return 1; // Option has been parsed
+        fossil_arg_target_mark(target, token.index);
+        if (options[token.index].type == COPTION_TYPE_BOOL && !token.value) {
+            fossil_arg_target_value(target, token.index)->bool_val = 1; // Flags take no value unless given with '='
+            continue;
         }
+
+        const char* text = token.value ? token.value : fossil_arg_stream_value(stream);
+        if (!text) {
+            fossil_arg_target_fail(target, FOSSIL_ARG_ERROR_INVALID, token.index, "Error: Missing argument for option '-%s'.\n", options[token.index].name);
+            return;
+        }
+        fossil_arg_assign(lookup, target, token.index, text);
     }
-    return 0; // Option not found or not parsed
 }
 
-void fossil_arg_parse_usage(const char* program_name, fossil_option_t* options, int32_t num_options) {
-    if (!program_name || !options) {
-        fprintf(stderr, "Error: Invalid program name or options.\n");
+void fossil_arg_parse_stream(fossil_arg_next_t next, void* context, fossil_option_t* options, int32_t num_options) {
+    if (!next || !options) {
+        fprintf(stderr, "Error: Invalid argument source or options.\n");
         return;
     }
 
-    printf("Usage: %s [options]\n\nOptions:\n", program_name);
-    for (int32_t i = 0; i < num_options; ++i) {
-        if (!options[i].name) {
-            fprintf(stderr, "Error: Invalid option name.\n");
-            continue;
-        }
-
-        printf("  -%s", options[i].name);
-        switch (options[i].type) {
-            case COPTION_TYPE_INT:
-                printf(" <int>");
-                break;
-            case COPTION_TYPE_STRING:
-                printf(" <string>");
-                break;
-            case COPTION_TYPE_BOOL:
-                printf(" (flag)");
-                break;
-            case COPTION_TYPE_COMBO:
-                printf(" {%s}", ((fossil_combo_choice_t*)options[i].extra_data)[0].name);
-                for (int j = 1; j < options[i].num_choices; ++j) {
-                    printf("|%s", ((fossil_combo_choice_t*)options[i].extra_data)[j].name);
-                }
-                break;
-            case COPTION_TYPE_FEATURE:
-                printf(" {enable|disable|auto}");
-                break;
-            default:
-                fprintf(stderr, "Error: Invalid option type.\n");
-        }
-        printf("\n");
-    }
+    fossil_arg_stream_t stream = {next, context, 1, 0, {{NULL, NULL}}};
+    fossil_arg_shared_index_t* shared = fossil_arg_index_acquire(options, num_options);
+    fossil_arg_lookup_t lookup = {options, num_options, shared ? &shared->index : NULL};
+    fossil_arg_target_t target = {options, NULL};
+    fossil_arg_parse_core(&stream, &lookup, &target);
+    fossil_arg_index_release(shared);
 }
 
 void fossil_arg_parse(fossil_command_line_t* cmd, fossil_option_t* options, int32_t num_options) {
@@ -72,63 +1687,506 @@ void fossil_arg_parse(fossil_command_line_t* cmd, fossil_option_t* options, int3
         return;
     }
 
-    for (int32_t i = 1; i < cmd->argc; ++i) {
-        const char* arg = cmd->argv[i];
-        if (arg[0] == '-') {
-            // Parse options
-            for (int32_t j = 0; j < num_options; ++j) {
-                if (strcmp(arg + 1, options[j].name) == 0) {
-                    options[j].parsed = 1; // Mark the option as parsed
-                    switch (options[j].type) {
-                        case COPTION_TYPE_INT:
-                            if (i + 1 < cmd->argc) {
-                                options[j].value.int_val = atoi(cmd->argv[++i]);
-                            } else {
-                                fprintf(stderr, "Error: Missing argument for option '-%s'.\n", options[j].name);
-                            }
-                            break;
-                        case COPTION_TYPE_STRING:
-                            if (i + 1 < cmd->argc) {
-                                options[j].value.str_val = cmd->argv[++i];
-                            } else {
-                                fprintf(stderr, "Error: Missing argument for option '-%s'.\n", options[j].name);
-                            }
+    fossil_arg_argv_source_t source = {cmd->argv, cmd->argc, 1};
+    fossil_arg_parse_stream(fossil_arg_argv_next, &source, options, num_options);
+}
+
+fossil_arg_schema_t* fossil_arg_schema_create(const fossil_option_spec_t* specs, int32_t num_specs) {
+    fossil_arg_schema_t* schema = calloc(1, sizeof(fossil_arg_schema_t));
+    if (!schema) {
+        return NULL;
+    }
+    if (fossil_arg_build_options(specs, num_specs, NULL, &schema->options) != FOSSIL_ARG_OK) {
+        free(schema);
+        return NULL;
+    }
+    schema->num_options = num_specs;
+    if (fossil_arg_index_build(&schema->index, schema->options, num_specs) != 0) {
+        fossil_arg_free_options(schema->options);
+        free(schema);
+        return NULL;
+    }
+#ifdef _WIN32
+    InitializeSRWLock(&schema->usage_lock);
+#else
+    pthread_mutex_init(&schema->usage_lock, NULL);
+#endif
+    return schema;
+}
+
+void fossil_arg_schema_free(fossil_arg_schema_t* schema) {
+    if (!schema) {
+        return;
+    }
+    fossil_arg_index_free(&schema->index);
+    fossil_arg_free_options(schema->options);
+#ifndef _WIN32
+    pthread_mutex_destroy(&schema->usage_lock);
+#endif
+    free(schema->usage);
+    free(schema->usage_program);
+    free(schema);
+}
+
+int32_t fossil_arg_schema_find(const fossil_arg_schema_t* schema, const char* name) {
+    if (!schema || !name) {
+        return -1;
+    }
+    return fossil_arg_index_find(&schema->index, schema->options, name, strlen(name));
+}
+
+const fossil_option_t* fossil_arg_schema_options(const fossil_arg_schema_t* schema, int32_t* num_options) {
+    if (num_options) {
+        *num_options = schema ? schema->num_options : 0;
+    }
+    return schema ? schema->options : NULL;
+}
+
+size_t fossil_arg_schema_usage(const fossil_arg_schema_t* schema, const char* program_name, int32_t width, char* buffer, size_t size) {
+    if (!schema || !program_name) {
+        return fossil_arg_format_usage(program_name, NULL, 0, width, buffer, size);
+    }
+
+    // The cache is a detail of the schema, it does not change what it describes
+    fossil_arg_schema_t* cache = (fossil_arg_schema_t*)schema;
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&cache->usage_lock);
+#else
+    pthread_mutex_lock(&cache->usage_lock);
+#endif
+    if (!cache->usage || cache->usage_width != width || strcmp(cache->usage_program, program_name) != 0) {
+        size_t length = fossil_arg_format_usage(program_name, schema->options, schema->num_options, width, NULL, 0);
+        size_t program_length = strlen(program_name);
+        char* text = malloc(length + 1);
+        char* program = malloc(program_length + 1);
+        if (text && program) {
+            fossil_arg_format_usage(program_name, schema->options, schema->num_options, width, text, length + 1);
+            memcpy(program, program_name, program_length + 1);
+            free(cache->usage);
+            free(cache->usage_program);
+            cache->usage = text;
+            cache->usage_length = length;
+            cache->usage_program = program;
+            cache->usage_width = width;
+        } else {
+            free(text);
+            free(program);
+        }
+    }
+
+    size_t length;
+    if (cache->usage && cache->usage_width == width && strcmp(cache->usage_program, program_name) == 0) {
+        fossil_arg_writer_t writer = {buffer, buffer ? size : 0, 0};
+        fossil_arg_write(&writer, cache->usage, cache->usage_length);
+        length = fossil_arg_writer_finish(&writer);
+    } else {
+        length = fossil_arg_format_usage(program_name, schema->options, schema->num_options, width, buffer, size);
+    }
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&cache->usage_lock);
+#else
+    pthread_mutex_unlock(&cache->usage_lock);
+#endif
+    return length;
+}
+
+fossil_arg_result_t* fossil_arg_result_create(const fossil_arg_schema_t* schema) {
+    if (!schema) {
+        return NULL;
+    }
+    // Header, values and presence bits in one allocation
+    size_t words = ((size_t)schema->num_options + 63) / 64;
+    size_t values_offset = fossil_arg_align(sizeof(fossil_arg_result_t), _Alignof(fossil_option_value_t));
+    size_t bits_offset = fossil_arg_align(values_offset + (size_t)schema->num_options * sizeof(fossil_option_value_t), _Alignof(uint64_t));
+    unsigned char* block = calloc(1, bits_offset + words * sizeof(uint64_t));
+    if (!block) {
+        return NULL;
+    }
+
+    fossil_arg_result_t* result = (fossil_arg_result_t*)block;
+    result->num_options = schema->num_options;
+    result->error_option = -1;
+    result->values = (fossil_option_value_t*)(block + values_offset);
+    result->present = (uint64_t*)(block + bits_offset);
+    return result;
+}
+
+void fossil_arg_result_free(fossil_arg_result_t* result) {
+    free(result);
+}
+
+int32_t fossil_arg_result_has(const fossil_arg_result_t* result, int32_t index) {
+    if (!result || index < 0 || index >= result->num_options) {
+        return 0;
+    }
+    return (int32_t)((result->present[index / 64] >> (index % 64)) & 1);
+}
+
+int32_t fossil_arg_parse_into(const fossil_arg_schema_t* schema, const fossil_command_line_t* cmd, fossil_arg_result_t* result) {
+    if (!schema || !cmd || !result || result->num_options != schema->num_options) {
+        return FOSSIL_ARG_ERROR_INVALID;
+    }
+
+    // Start from the schema defaults, the schema itself is never written
+    memset(result->present, 0, ((size_t)result->num_options + 63) / 64 * sizeof(uint64_t));
+    for (int32_t i = 0; i < schema->num_options; ++i) {
+        result->values[i] = schema->options[i].value;
+    }
+    result->error = FOSSIL_ARG_OK;
+    result->error_option = -1;
+
+    // No @file expansion: requests must not be able to make the parser open files
+    fossil_arg_argv_source_t source = {cmd->argv, cmd->argc, 1};
+    fossil_arg_stream_t stream = {fossil_arg_argv_next, &source, 0, 0, {{NULL, NULL}}};
+    fossil_arg_lookup_t lookup = {schema->options, schema->num_options, &schema->index};
+    fossil_arg_target_t target = {NULL, result};
+    fossil_arg_parse_core(&stream, &lookup, &target);
+    return result->error;
+}
+
+static int32_t fossil_arg_is_key_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-' || c == '.';
+}
+
+static char* fossil_arg_skip_blank(char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+        ++p;
+    }
+    return p;
+}
+
+// Nothing but blanks or a comment may follow a section header or quoted value
+static int32_t fossil_arg_only_comment(char* p, const char* end) {
+    p = fossil_arg_skip_blank(p, end);
+    return p == end || *p == '#' || *p == ';';
+}
+
+// Single pass over an INI/TOML-style file: [section] headers, key = value or
+// key: value lines, '#' and ';' comments, bare values or "basic" strings with
+// \n \t \" escapes or 'literal' strings. Keys, section names and values are
+// terminated in place and handed to emit, nothing is allocated. Returns the
+// number of malformed lines, which are reported and skipped.
+static int32_t fossil_arg_config_tokenize(char* data, size_t size, const char* path, fossil_arg_config_emit_t emit, void* context) {
+    char* pos = data;
+    char* end = data + size;
+    const char* section = NULL;
+    int32_t line = 0;
+    int32_t errors = 0;
+
+    while (pos < end) {
+        char* eol = memchr(pos, '\n', (size_t)(end - pos));
+        char* p = fossil_arg_skip_blank(pos, end);
+        int32_t valid = 1;
+
+        eol = eol ? eol : end;
+        ++line;
+        if (p == eol || *p == '#' || *p == ';') {
+            pos = eol < end ? eol + 1 : end;
+            continue;
+        }
+
+        if (*p == '[') {
+            char* name = fossil_arg_skip_blank(p + 1, eol);
+            char* close = memchr(name, ']', (size_t)(eol - name));
+            char* name_end = close;
+            while (name_end && name_end > name && (name_end[-1] == ' ' || name_end[-1] == '\t')) {
+                --name_end;
+            }
+            valid = close && name_end > name && *name != '[' && fossil_arg_only_comment(close + 1, eol);
+            if (valid) {
+                *name_end = '\0';
+                section = name;
+            }
+        } else {
+            char* key = p;
+            while (p < eol && fossil_arg_is_key_char(*p)) {
+                ++p;
+            }
+            char* key_end = p;
+            p = fossil_arg_skip_blank(p, eol);
+            valid = key_end > key && p < eol && (*p == '=' || *p == ':');
+
+            char* value = NULL;
+            char* value_end = NULL;
+            if (valid) {
+                p = fossil_arg_skip_blank(p + 1, eol);
+                if (p < eol && (*p == '"' || *p == '\'')) {
+                    char quote = *p++;
+                    value = value_end = p;
+                    while (p < eol && *p != quote) {
+                        if (quote == '"' && *p == '\\' && p + 1 < eol) {
+                            ++p;
+                            *value_end++ = *p == 'n' ? '\n' : *p == 't' ? '\t' : *p;
+                            ++p;
+                        } else {
+                            *value_end++ = *p++;
+                        }
+                    }
+                    valid = p < eol && fossil_arg_only_comment(p + 1, eol);
+                } else {
+                    value = value_end = p;
+                    for (; p < eol; ++p) {
+                        if ((*p == '#' || *p == ';') && (p == value || p[-1] == ' ' || p[-1] == '\t')) {
                             break;
-                        // Handle other option types similarly
-                        default:
-                            fprintf(stderr, "Error: Unsupported option type.\n");
+                        }
+                        if (*p != ' ' && *p != '\t' && *p != '\r') {
+                            value_end = p + 1;
+                        }
                     }
-                    break; // Found and parsed the option, move to the next argument
                 }
             }
+            if (valid) {
+                // Both ends lie at or before eol, which is a byte of the file or the spare byte
+                *key_end = '\0';
+                *value_end = '\0';
+                emit(context, section, key, value);
+            }
+        }
+
+        if (!valid) {
+            fprintf(stderr, "Error: %s:%d: Malformed configuration line.\n", path, line);
+            ++errors;
+        }
+        pos = eol < end ? eol + 1 : end;
+    }
+    return errors;
+}
+
+static void fossil_arg_config_collect(void* context, const char* section, const char* key, const char* value) {
+    fossil_arg_config_t* config = (fossil_arg_config_t*)context;
+    if (config->num_pairs == config->capacity) {
+        size_t capacity = config->capacity ? config->capacity * 2 : 16;
+        fossil_arg_config_pair_t* pairs = realloc(config->pairs, capacity * sizeof(fossil_arg_config_pair_t));
+        if (!pairs) {
+            ++config->errors;
+            return;
+        }
+        config->pairs = pairs;
+        config->capacity = capacity;
+    }
+    fossil_arg_config_pair_t* pair = &config->pairs[config->num_pairs++];
+    pair->section = section;
+    pair->key = key;
+    pair->value = value;
+}
+
+// Cached tokenised config for path, reloaded when the file changes on disk.
+// Call with the response lock held. Values handed out from a replaced file
+// stay valid because the old file moves to the release list.
+static fossil_arg_config_t* fossil_arg_config_acquire_locked(const char* path, const struct stat* info) {
+    fossil_arg_config_t* config = fossil_arg_configs;
+    while (config && strcmp(config->path, path) != 0) {
+        config = config->next;
+    }
+
+    int64_t mtime_nsec = 0;
+#ifdef __linux__
+    mtime_nsec = (int64_t)info->st_mtim.tv_nsec;
+#endif
+    if (config && config->device == (uint64_t)info->st_dev && config->inode == (uint64_t)info->st_ino &&
+        config->size == (uint64_t)info->st_size && config->mtime_sec == (int64_t)info->st_mtime && config->mtime_nsec == mtime_nsec) {
+        return config;
+    }
+
+    // Config files get edited while programs run; truncating a mapped file
+    // would fault on pages still referenced by STRING values, so read it
+    fossil_arg_response_t* file = fossil_arg_file_load(path, 0);
+    if (!file) {
+        return NULL;
+    }
+    if (!config) {
+        config = calloc(1, sizeof(fossil_arg_config_t));
+        size_t len = strlen(path);
+        char* copy = config ? malloc(len + 1) : NULL;
+        if (!copy) {
+            free(config);
+            fossil_arg_file_keep(file);
+            return NULL;
+        }
+        memcpy(copy, path, len + 1);
+        config->path = copy;
+        config->next = fossil_arg_configs;
+        fossil_arg_configs = config;
+    } else if (config->file) {
+        config->file->next = fossil_arg_responses;
+        fossil_arg_responses = config->file;
+    }
+
+    config->device = (uint64_t)info->st_dev;
+    config->inode = (uint64_t)info->st_ino;
+    config->size = (uint64_t)info->st_size;
+    config->mtime_sec = (int64_t)info->st_mtime;
+    config->mtime_nsec = mtime_nsec;
+    config->file = file;
+    config->num_pairs = 0;
+    config->errors = fossil_arg_config_tokenize(file->data, file->size, path, fossil_arg_config_collect, config);
+    return config;
+}
+
+static int32_t fossil_arg_resolve_config(const fossil_arg_layers_t* layers, const fossil_arg_lookup_t* lookup, fossil_option_t* options) {
+    struct stat info;
+    if (stat(layers->config_path, &info) != 0) {
+        return errno == ENOENT ? FOSSIL_ARG_OK : FOSSIL_ARG_ERROR_INVALID;  // a missing file is just an empty layer
+    }
+
+    _FOSSIL_ARG_RESPONSE_LOCK();
+    fossil_arg_config_t* config = fossil_arg_config_acquire_locked(layers->config_path, &info);
+    if (!config) {
+        _FOSSIL_ARG_RESPONSE_UNLOCK();
+        fprintf(stderr, "Error: Unable to read configuration file '%s'.\n", layers->config_path);
+        return FOSSIL_ARG_ERROR_INVALID;
+    }
+
+    int32_t status = config->errors ? FOSSIL_ARG_ERROR_INVALID : FOSSIL_ARG_OK;
+    for (size_t i = 0; i < config->num_pairs; ++i) {
+        const fossil_arg_config_pair_t* pair = &config->pairs[i];
+        if (pair->section && (!layers->section || strcmp(pair->section, layers->section) != 0)) {
+            continue;
+        }
+        int32_t j = fossil_arg_lookup(lookup, pair->key, strlen(pair->key));
+        if (j == -1) {
+            continue;
+        }
+        int32_t result = fossil_arg_parse_value(&options[j], pair->value, &options[j].value);
+        if (result != FOSSIL_ARG_OK) {
+            fprintf(stderr, "Error: Invalid value '%s' for option '%s' in '%s'.\n", pair->value, pair->key, config->path);
+            status = result;
+            continue;
+        }
+        options[j].parsed = 1;
+    }
+    _FOSSIL_ARG_RESPONSE_UNLOCK();
+    return status;
+}
+
+static int32_t fossil_arg_resolve_env(const char* prefix, fossil_option_t* options, int32_t num_options) {
+    size_t prefix_len = strlen(prefix);
+    int32_t status = FOSSIL_ARG_OK;
+    char name[256];
+
+    if (prefix_len >= sizeof(name)) {
+        return FOSSIL_ARG_ERROR_INVALID;
+    }
+    memcpy(name, prefix, prefix_len);
+    for (int32_t i = 0; i < num_options; ++i) {
+        const char* option_name = options[i].name;
+        size_t len = option_name ? strlen(option_name) : 0;
+        if (len == 0 || prefix_len + len >= sizeof(name)) {
+            continue;
+        }
+        // "dry-run" with prefix "APP_" becomes APP_DRY_RUN
+        for (size_t k = 0; k < len; ++k) {
+            char c = option_name[k];
+            name[prefix_len + k] = (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) ? c : '_';
         }
+        name[prefix_len + len] = '\0';
+
+        const char* text = getenv(name);
+        if (!text) {
+            continue;
+        }
+        int32_t result = fossil_arg_parse_value(&options[i], text, &options[i].value);
+        if (result != FOSSIL_ARG_OK) {
+            fprintf(stderr, "Error: Invalid value '%s' in environment variable '%s'.\n", text, name);
+            status = result;
+            continue;
+        }
+        options[i].parsed = 1;
     }
+    return status;
 }
 
+int32_t fossil_arg_resolve(fossil_command_line_t* cmd, fossil_option_t* options, int32_t num_options, const fossil_arg_layers_t* layers) {
+    int32_t status = FOSSIL_ARG_OK;
+    if (!options) {
+        fprintf(stderr, "Error: Invalid options.\n");
+        return FOSSIL_ARG_ERROR_INVALID;
+    }
+
+    // The values already in options are the defaults, each layer overrides the last
+    if (layers && layers->config_path) {
+        // One index for every key of the file
+        fossil_arg_shared_index_t* shared = fossil_arg_index_acquire(options, num_options);
+        fossil_arg_lookup_t lookup = {options, num_options, shared ? &shared->index : NULL};
+        status = fossil_arg_resolve_config(layers, &lookup, options);
+        fossil_arg_index_release(shared);
+    }
+    if (layers && layers->env_prefix) {
+        int32_t result = fossil_arg_resolve_env(layers->env_prefix, options, num_options);
+        status = status == FOSSIL_ARG_OK ? result : status;
+    }
+    if (cmd) {
+        fossil_arg_parse(cmd, options, num_options);
+    }
+    return status;
+}
 
 void fossil_arg_check_unrecognized(fossil_command_line_t* cmd, fossil_option_t* options, int32_t num_options) {
-    for (int32_t i = 1; i < cmd->argc; ++i) {
-        const char* arg = cmd->argv[i];
-        if (arg[0] == '-') {
-            int32_t recognized = 0;
-            for (int32_t j = 0; j < num_options; ++j) {
-                if (strcmp(arg + 1, options[j].name) == 0) {
-                    recognized = 1;
+    fossil_arg_shared_index_t* shared = fossil_arg_index_acquire(options, num_options);
+    fossil_arg_lookup_t lookup = {options, num_options, shared ? &shared->index : NULL};
+    // Walk the same expanded arguments the parser sees, response files included
+    fossil_arg_argv_source_t source = {cmd->argv, cmd->argc, 1};
+    fossil_arg_stream_t stream = {fossil_arg_argv_next, &source, 1, 0, {{NULL, NULL}}};
+    const char* arg;
+    while ((arg = fossil_arg_stream_next(&stream)) != NULL) {
+        fossil_arg_token_t token = fossil_arg_classify(&lookup, arg);
+        if (token.kind == _FOSSIL_ARG_TOKEN_END) {
+            break;
+        }
+        if (token.kind == _FOSSIL_ARG_TOKEN_UNKNOWN) {
+            fprintf(stderr, "Error: Unrecognized option '%s'\n", arg);
+            exit(EXIT_FAILURE);
+        }
+        if (token.kind == _FOSSIL_ARG_TOKEN_BUNDLE) {
+            for (const char* p = arg + 1; *p; ++p) {
+                int32_t j = fossil_arg_lookup(&lookup, p, 1);
+                if (j == -1) {
+                    fprintf(stderr, "Error: Unrecognized option '-%c' in '%s'\n", *p, arg);
+                    exit(EXIT_FAILURE);
+                }
+                if (options[j].type != COPTION_TYPE_BOOL) {
+                    if (p[1] == '\0') {
+                        fossil_arg_stream_value(&stream);  // the value is the next argument
+                    }
                     break;
                 }
             }
-            if (!recognized) {
-                fprintf(stderr, "Error: Unrecognized option '%s'\n", arg);
-                exit(EXIT_FAILURE);
-            }
+        } else if (token.kind == _FOSSIL_ARG_TOKEN_OPTION && !token.value && options[token.index].type != COPTION_TYPE_BOOL) {
+            fossil_arg_stream_value(&stream);  // skip the value, it may look like an option (-5)
         }
     }
+    fossil_arg_index_release(shared);
 }
 
-void fossil_arg_print_parsed_options(fossil_option_t* options, int32_t num_options) {
+static size_t fossil_arg_format_parsed(const fossil_option_t* options, int32_t num_options, char* buffer, size_t size) {
+    fossil_arg_writer_t writer = {buffer, size, 0};
     for (int32_t i = 0; i < num_options; ++i) {
-        printf("Option: %s, Parsed: %s\n", options[i].name, options[i].parsed ? "true" : "false");
+        fossil_arg_write_str(&writer, "Option: ");
+        fossil_arg_write_str(&writer, options[i].name ? options[i].name : "(null)");
+        fossil_arg_write_str(&writer, options[i].parsed ? ", Parsed: true\n" : ", Parsed: false\n");
+    }
+    return fossil_arg_writer_finish(&writer);
+}
+
+void fossil_arg_print_parsed_options(fossil_option_t* options, int32_t num_options) {
+    if (!options) {
+        return;
     }
+
+    char local[4096];
+    size_t length = fossil_arg_format_parsed(options, num_options, local, sizeof(local));
+    if (length < sizeof(local)) {
+        fossil_arg_write_stdout(local, length);
+        return;
+    }
+    char* text = malloc(length + 1);
+    if (!text) {
+        fprintf(stderr, "Memory allocation error for option list.\n");
+        return;
+    }
+    fossil_arg_format_parsed(options, num_options, text, length + 1);
+    fossil_arg_write_stdout(text, length);
+    free(text);
 }
 
 void fossil_arg_reset_parsed_flags(fossil_option_t* options, int32_t num_options) {
@@ -137,38 +2195,417 @@ void fossil_arg_reset_parsed_flags(fossil_option_t* options, int32_t num_options
     }
 }
 
-// Function to create combo choices
+// Bytes for the option array and choices, strings are appended after them
+static size_t fossil_arg_table_size(const fossil_option_spec_t* specs, int32_t num_options, size_t* choices_offset, size_t* strings_offset) {
+    size_t num_choices = 0;
+    size_t strings = 0;
+
+    for (int32_t i = 0; i < num_options; ++i) {
+        if (!specs[i].name) {
+            return 0;
+        }
+        strings += strlen(specs[i].name) + 1;
+        strings += specs[i].description ? strlen(specs[i].description) + 1 : 0;
+        if (specs[i].type == COPTION_TYPE_COMBO) {
+            if (specs[i].num_choices <= 0 || !specs[i].choice_names || !specs[i].choice_values) {
+                return 0;
+            }
+            for (int32_t c = 0; c < specs[i].num_choices; ++c) {
+                if (!specs[i].choice_names[c]) {
+                    return 0;
+                }
+                strings += strlen(specs[i].choice_names[c]) + 1;
+            }
+            num_choices += (size_t)specs[i].num_choices + 1;  // NULL-named terminator
+        }
+    }
+
+    *choices_offset = fossil_arg_align((size_t)num_options * sizeof(fossil_option_t), _Alignof(fossil_combo_choice_t));
+    *strings_offset = *choices_offset + num_choices * sizeof(fossil_combo_choice_t);
+    return *strings_offset + strings;
+}
+
+size_t fossil_arg_options_size(const fossil_option_spec_t* specs, int32_t num_options) {
+    size_t choices_offset;
+    size_t strings_offset;
+    if (!specs || num_options <= 0) {
+        return 0;
+    }
+    size_t size = fossil_arg_table_size(specs, num_options, &choices_offset, &strings_offset);
+    // An arena aligns the block start, which may cost up to one alignment unit
+    return size ? size + _Alignof(max_align_t) - 1 : 0;
+}
+
+static char* fossil_arg_pool_copy(char** pool, const char* text) {
+    size_t len = strlen(text) + 1;
+    char* copy = *pool;
+    memcpy(copy, text, len);
+    *pool += len;
+    return copy;
+}
+
+int32_t fossil_arg_build_options(const fossil_option_spec_t* specs, int32_t num_options, fossil_arg_arena_t* arena, fossil_option_t** options) {
+    size_t choices_offset;
+    size_t strings_offset;
+    unsigned char* block;
+
+    if (!specs || num_options <= 0 || !options) {
+        return FOSSIL_ARG_ERROR_INVALID;
+    }
+    *options = NULL;
+    size_t size = fossil_arg_table_size(specs, num_options, &choices_offset, &strings_offset);
+    if (size == 0) {
+        fprintf(stderr, "Error: Invalid option declarations.\n");
+        return FOSSIL_ARG_ERROR_INVALID;
+    }
+
+    if (arena) {
+        size_t start = fossil_arg_align(arena->used, _Alignof(max_align_t));
+        if (!arena->base || start > arena->size || arena->size - start < size) {
+            return FOSSIL_ARG_ERROR_NOMEM;
+        }
+        block = (unsigned char*)arena->base + start;
+        arena->used = start + size;
+    } else {
+        block = malloc(size);
+        if (!block) {
+            return FOSSIL_ARG_ERROR_NOMEM;
+        }
+    }
+
+    fossil_option_t* table = (fossil_option_t*)block;
+    fossil_combo_choice_t* choices = (fossil_combo_choice_t*)(block + choices_offset);
+    char* pool = (char*)block + strings_offset;
+
+    for (int32_t i = 0; i < num_options; ++i) {
+        table[i].name = fossil_arg_pool_copy(&pool, specs[i].name);
+        table[i].type = specs[i].type;
+        table[i].value = specs[i].value;
+        table[i].extra_data = NULL;
+        table[i].num_choices = 0;
+        table[i].parsed = 0;
+        table[i].description = specs[i].description ? fossil_arg_pool_copy(&pool, specs[i].description) : NULL;
+
+        if (specs[i].type == COPTION_TYPE_COMBO) {
+            table[i].extra_data = choices;
+            table[i].num_choices = specs[i].num_choices;
+            for (int32_t c = 0; c < specs[i].num_choices; ++c) {
+                choices[c].name = fossil_arg_pool_copy(&pool, specs[i].choice_names[c]);
+                choices[c].value = specs[i].choice_values[c];
+            }
+            choices[specs[i].num_choices].name = NULL;
+            choices[specs[i].num_choices].value = 0;
+            choices += specs[i].num_choices + 1;
+        }
+    }
+
+    *options = table;
+    return FOSSIL_ARG_OK;
+}
+
+void fossil_arg_free_options(void* options) {
+    free(options);
+}
+
 fossil_combo_choice_t* fossil_arg_create_fossil_combo_choice_ts(const char* names[], const int32_t values[], int32_t num_choices) {
-    fossil_combo_choice_t* choices = malloc(num_choices * sizeof(fossil_combo_choice_t));
+    if (num_choices < 0 || (num_choices > 0 && (!names || !values))) {
+        fprintf(stderr, "Error: Invalid combo choices.\n");
+        return NULL;
+    }
+
+    fossil_combo_choice_t* choices = malloc(((size_t)num_choices + 1) * sizeof(fossil_combo_choice_t));
     if (!choices) {
         fprintf(stderr, "Memory allocation error for combo choices.\n");
-        exit(EXIT_FAILURE);
+        return NULL;
     }
 
     for (int32_t i = 0; i < num_choices; ++i) {
         choices[i].name = names[i];
         choices[i].value = values[i];
     }
+    choices[num_choices].name = NULL;
+    choices[num_choices].value = 0;
 
     return choices;
 }
 
-// Function to create options
-fossil_option_t* fossil_arg_create_options(const char* names[], fossil_option_type_t types[], fossil_option_value_t values[], void* extra_data[], int32_t num_options) {
-    fossil_option_t* options = malloc(num_options * sizeof(fossil_option_t));
+// Function to create options whose COMBO entries carry a choice count
+fossil_option_t* fossil_arg_create_combo_options(const char* names[], fossil_option_type_t types[], fossil_option_value_t values[], void* extra_data[], const int32_t num_choices[], int32_t num_options) {
+    if (num_options <= 0 || !names || !types || !values) {
+        fprintf(stderr, "Error: Invalid option arrays.\n");
+        return NULL;
+    }
+
+    fossil_option_t* options = malloc((size_t)num_options * sizeof(fossil_option_t));
     if (!options) {
         fprintf(stderr, "Memory allocation error for options.\n");
-        exit(EXIT_FAILURE);
+        return NULL;
     }
 
     for (int32_t i = 0; i < num_options; ++i) {
         options[i].name = names[i];
         options[i].type = types[i];
         options[i].value = values[i];
-        options[i].extra_data = extra_data[i];
+        options[i].extra_data = extra_data ? extra_data[i] : NULL;
         options[i].parsed = 0;
         options[i].num_choices = 0;
+        options[i].description = NULL;
+        if (types[i] == COPTION_TYPE_COMBO && options[i].extra_data && num_choices) {
+            options[i].num_choices = num_choices[i] > 0 ? num_choices[i] : 0;
+        }
     }
 
     return options;
 }
+
+// Function to create options
+fossil_option_t* fossil_arg_create_options(const char* names[], fossil_option_type_t types[], fossil_option_value_t values[], void* extra_data[], int32_t num_options) {
+    return fossil_arg_create_combo_options(names, types, values, extra_data, NULL, num_options);
+}
+
+// One trie node; an edge per next character, ' ' joins command words
+typedef struct {
+    char *labels;
+    int32_t *children;
+    int32_t num_children;
+    int32_t capacity;
+    int32_t registered;
+    fossil_arg_handler_t handler;
+    const fossil_option_spec_t *specs;
+    int32_t num_specs;
+    void *user_data;
+    fossil_option_t *options;  // built on first dispatch, then only read
+    fossil_arg_index_t index;  // names of options, built along with them
+} fossil_arg_command_node_t;
+
+struct fossil_arg_commands {
+    fossil_arg_command_node_t *nodes;  // nodes[0] is the root
+    int32_t num_nodes;
+    int32_t capacity;
+#ifdef _WIN32
+    SRWLOCK lock;
+#else
+    pthread_mutex_t lock;
+#endif
+};
+
+fossil_arg_commands_t* fossil_arg_commands_create(void) {
+    fossil_arg_commands_t* commands = calloc(1, sizeof(fossil_arg_commands_t));
+    if (!commands) {
+        return NULL;
+    }
+    commands->capacity = 64;
+    commands->nodes = calloc((size_t)commands->capacity, sizeof(fossil_arg_command_node_t));
+    if (!commands->nodes) {
+        free(commands);
+        return NULL;
+    }
+    commands->num_nodes = 1;
+#ifdef _WIN32
+    InitializeSRWLock(&commands->lock);
+#else
+    pthread_mutex_init(&commands->lock, NULL);
+#endif
+    return commands;
+}
+
+static void fossil_arg_commands_lock(fossil_arg_commands_t* commands) {
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&commands->lock);
+#else
+    pthread_mutex_lock(&commands->lock);
+#endif
+}
+
+static void fossil_arg_commands_unlock(fossil_arg_commands_t* commands) {
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&commands->lock);
+#else
+    pthread_mutex_unlock(&commands->lock);
+#endif
+}
+
+static int32_t fossil_arg_command_child(const fossil_arg_command_node_t* node, char label) {
+    const char* found = node->num_children ? memchr(node->labels, label, (size_t)node->num_children) : NULL;
+    return found ? node->children[found - node->labels] : -1;
+}
+
+// Child of node for label, added when missing. Returns -1 on allocation failure.
+static int32_t fossil_arg_command_edge(fossil_arg_commands_t* commands, int32_t node, char label) {
+    int32_t child = fossil_arg_command_child(&commands->nodes[node], label);
+    if (child != -1) {
+        return child;
+    }
+
+    if (commands->num_nodes == commands->capacity) {
+        int32_t capacity = commands->capacity * 2;
+        fossil_arg_command_node_t* nodes = realloc(commands->nodes, (size_t)capacity * sizeof(fossil_arg_command_node_t));
+        if (!nodes) {
+            return -1;
+        }
+        memset(nodes + commands->capacity, 0, (size_t)(capacity - commands->capacity) * sizeof(fossil_arg_command_node_t));
+        commands->nodes = nodes;
+        commands->capacity = capacity;
+    }
+
+    fossil_arg_command_node_t* parent = &commands->nodes[node];
+    if (parent->num_children == parent->capacity) {
+        int32_t capacity = parent->capacity ? parent->capacity * 2 : 2;
+        char* labels = realloc(parent->labels, (size_t)capacity);
+        if (!labels) {
+            return -1;
+        }
+        parent->labels = labels;
+        int32_t* children = realloc(parent->children, (size_t)capacity * sizeof(int32_t));
+        if (!children) {
+            return -1;
+        }
+        parent->children = children;
+        parent->capacity = capacity;
+    }
+
+    child = commands->num_nodes++;
+    parent->labels[parent->num_children] = label;
+    parent->children[parent->num_children++] = child;
+    return child;
+}
+
+int32_t fossil_arg_commands_register(fossil_arg_commands_t* commands, const char* path, fossil_arg_handler_t handler,
+                                     const fossil_option_spec_t* specs, int32_t num_specs, void* user_data) {
+    if (!commands || !path || !handler || num_specs < 0 || (num_specs > 0 && !specs)) {
+        return FOSSIL_ARG_ERROR_INVALID;
+    }
+
+    // Adding nodes may move the whole trie, dispatchers must not walk it meanwhile
+    fossil_arg_commands_lock(commands);
+    int32_t node = 0;
+    const char* p = path;
+    while (*p) {
+        while (*p == ' ') {
+            ++p;
+        }
+        if (!*p) {
+            break;
+        }
+        if (node != 0) {
+            node = fossil_arg_command_edge(commands, node, ' ');
+        }
+        while (node != -1 && *p && *p != ' ') {
+            node = fossil_arg_command_edge(commands, node, *p++);
+        }
+        if (node == -1) {
+            fossil_arg_commands_unlock(commands);
+            return FOSSIL_ARG_ERROR_NOMEM;
+        }
+    }
+
+    fossil_arg_command_node_t* target = &commands->nodes[node];
+    if (target->registered) {
+        fossil_arg_commands_unlock(commands);
+        fprintf(stderr, "Error: Command '%s' is already registered.\n", path);
+        return FOSSIL_ARG_ERROR_INVALID;
+    }
+    target->registered = 1;
+    target->handler = handler;
+    target->specs = specs;
+    target->num_specs = num_specs;
+    target->user_data = user_data;
+    fossil_arg_commands_unlock(commands);
+    return FOSSIL_ARG_OK;
+}
+
+int32_t fossil_arg_commands_dispatch(fossil_arg_commands_t* commands, fossil_command_line_t* cmd) {
+    if (!commands || !cmd || cmd->argc < 1) {
+        return FOSSIL_ARG_ERROR_INVALID;
+    }
+
+    // The walk and the lazy build run under the registry lock; every call
+    // parses into its own copy of the defaults and runs the handler unlocked
+    fossil_arg_commands_lock(commands);
+
+    // Walk word by word and remember the deepest registered node
+    int32_t match = commands->nodes[0].registered ? 0 : -1;
+    int32_t match_arg = 0;
+    int32_t node = 0;
+    for (int32_t i = 1; i < cmd->argc && node != -1; ++i) {
+        const char* word = cmd->argv[i];
+        if (word[0] == '-' || word[0] == '\0') {
+            break;
+        }
+        if (i > 1) {
+            node = fossil_arg_command_child(&commands->nodes[node], ' ');
+        }
+        for (const char* p = word; *p && node != -1; ++p) {
+            node = fossil_arg_command_child(&commands->nodes[node], *p);
+        }
+        if (node != -1 && commands->nodes[node].registered) {
+            match = node;
+            match_arg = i;
+        }
+    }
+    if (match == -1) {
+        fossil_arg_commands_unlock(commands);
+        fprintf(stderr, "Error: Unknown command '%s'.\n", cmd->argc > 1 ? cmd->argv[1] : "");
+        return FOSSIL_ARG_ERROR_INVALID;
+    }
+
+    fossil_arg_command_node_t* target = &commands->nodes[match];
+    fossil_arg_handler_t handler = target->handler;
+    void* user_data = target->user_data;
+    int32_t num_options = target->num_specs;
+    fossil_option_t* options = NULL;
+    fossil_command_line_t sub = {cmd->argc - match_arg, cmd->argv + match_arg};
+
+    int32_t status = FOSSIL_ARG_OK;
+    if (!target->options && num_options > 0) {
+        status = fossil_arg_build_options(target->specs, num_options, NULL, &target->options);
+        if (status == FOSSIL_ARG_OK && fossil_arg_index_build(&target->index, target->options, num_options) != 0) {
+            fossil_arg_free_options(target->options);
+            target->options = NULL;
+            status = FOSSIL_ARG_ERROR_NOMEM;
+        }
+    }
+    // The table and its index never change once built, so they are read
+    // without the lock; only the node array may move under a registration
+    const fossil_option_t* defaults = target->options;
+    fossil_arg_index_t index = target->index;
+    fossil_arg_commands_unlock(commands);
+    if (status != FOSSIL_ARG_OK) {
+        return status;
+    }
+
+    if (defaults) {
+        options = malloc((size_t)num_options * sizeof(fossil_option_t));
+        if (!options) {
+            return FOSSIL_ARG_ERROR_NOMEM;
+        }
+        memcpy(options, defaults, (size_t)num_options * sizeof(fossil_option_t));
+
+        fossil_arg_argv_source_t source = {sub.argv, sub.argc, 1};
+        fossil_arg_stream_t stream = {fossil_arg_argv_next, &source, 1, 0, {{NULL, NULL}}};
+        fossil_arg_lookup_t lookup = {defaults, num_options, &index};
+        fossil_arg_target_t into = {options, NULL};
+        fossil_arg_parse_core(&stream, &lookup, &into);
+    }
+
+    int32_t result = handler(&sub, options, num_options, user_data);
+    free(options);
+    return result;
+}
+
+void fossil_arg_commands_free(fossil_arg_commands_t* commands) {
+    if (!commands) {
+        return;
+    }
+    for (int32_t i = 0; i < commands->num_nodes; ++i) {
+        free(commands->nodes[i].labels);
+        free(commands->nodes[i].children);
+        fossil_arg_free_options(commands->nodes[i].options);
+        fossil_arg_index_free(&commands->nodes[i].index);
+    }
+#ifndef _WIN32
+    pthread_mutex_destroy(&commands->lock);
+#endif
+    free(commands->nodes);
+    free(commands);
+}
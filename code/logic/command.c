@@ -11,11 +11,15 @@
  * Copyright (C) 2024 Fossil Logic. All rights reserved.
  * -----------------------------------------------------------------------------
  */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE
+#endif
 #include "fossil/lib/command.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <limits.h>
 #include <errno.h>
 
 #include <sys/stat.h>
@@ -23,22 +27,489 @@
 #ifdef _WIN32
     #include <windows.h>
     #define _FOSSIL_PATH_SEPARATOR ";"
+    #define _FOSSIL_DIR_SEPARATOR "\\"
 #else
     #include <unistd.h>
+    #include <pthread.h>
+    #include <time.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <signal.h>
     #include <sys/types.h>
     #include <sys/wait.h>
+    #include <sys/resource.h>
+    #include <sys/socket.h>
+    #include <spawn.h>
     #define _FOSSIL_PATH_SEPARATOR ":"
+    #define _FOSSIL_DIR_SEPARATOR "/"
+#endif
+
+#ifdef __linux__
+    #include <sys/syscall.h>
+#endif
+
+#ifdef __APPLE__
+    #include <crt_externs.h>
+    #define _FOSSIL_ENVIRON (*_NSGetEnviron())
+#elif !defined(_WIN32)
+extern char **environ;
+    #define _FOSSIL_ENVIRON environ
+#endif
+
+enum {
+    _FOSSIL_COMMAND_PATH_MAX = 4096,
+    _FOSSIL_COMMAND_CACHE_SLOTS = 256,       // power of two, open addressing
+    _FOSSIL_COMMAND_CACHE_RECHECK_MS = 1000, // how often PATH directories are re-stat'ed
+    _FOSSIL_COMMAND_POLL_TICK_MS = 10,       // wait-loop tick without pidfd or with a cancel flag
+    _FOSSIL_COMMAND_DEFAULT_GRACE_MS = 2000, // SIGTERM to SIGKILL delay when none was given
+    _FOSSIL_COMMAND_SESSION_BUFFER = 8192,   // session read window, must exceed the marker line
+    _FOSSIL_COMMAND_SESSION_MARKER = 64
+};
+
+enum {
+    _FOSSIL_COMMAND_TRACE_SLOTS = 32,        // power of two, one per operation and tool name
+    _FOSSIL_COMMAND_TRACE_SUB_BITS = 3,      // 8 sub-buckets per power of two, ~12% precision
+    _FOSSIL_COMMAND_TRACE_SUB = 1 << _FOSSIL_COMMAND_TRACE_SUB_BITS,
+    _FOSSIL_COMMAND_TRACE_BUCKETS = (64 - _FOSSIL_COMMAND_TRACE_SUB_BITS + 1) * _FOSSIL_COMMAND_TRACE_SUB
+};
+
+#if defined(_MSC_VER) && !defined(__clang__)
+    #include <intrin.h>
+    #define _FOSSIL_ATOMIC_LOAD(p)         InterlockedCompareExchange64((volatile LONG64 *)(p), 0, 0)
+    #define _FOSSIL_ATOMIC_LOAD_RELAXED(p) (*(volatile int64_t *)(p))
+    #define _FOSSIL_ATOMIC_STORE(p, v)     InterlockedExchange64((volatile LONG64 *)(p), (LONG64)(v))
+    #define _FOSSIL_ATOMIC_ADD(p, v)       InterlockedExchangeAdd64((volatile LONG64 *)(p), (LONG64)(v))
+    #define _FOSSIL_ATOMIC_CAS(p, e, d)    fossil_command_atomic_cas((volatile LONG64 *)(p), (LONG64 *)(e), (LONG64)(d))
+static int fossil_command_atomic_cas(volatile LONG64 *ptr, LONG64 *expected, LONG64 desired) {
+    LONG64 prev = InterlockedCompareExchange64(ptr, desired, *expected);
+    if (prev == *expected) {
+        return 1;
+    }
+    *expected = prev;
+    return 0;
+}
+#else
+    #define _FOSSIL_ATOMIC_LOAD(p)         __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define _FOSSIL_ATOMIC_LOAD_RELAXED(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+    #define _FOSSIL_ATOMIC_STORE(p, v)     __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+    #define _FOSSIL_ATOMIC_ADD(p, v)       __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+    #define _FOSSIL_ATOMIC_CAS(p, e, d)    __atomic_compare_exchange_n((p), (e), (d), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#endif
+
+// Lock-free log-linear histogram, every field is only touched atomically
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t inverted_min;
+    uint64_t buckets[_FOSSIL_COMMAND_TRACE_BUCKETS];
+} fossil_command_histogram_t;
+
+typedef struct {
+    uint64_t key;             // 0 while the slot is free
+    uint64_t ready;           // set once name and op are published
+    uint32_t op;
+    char name[64];
+    uint64_t calls;
+    uint64_t failures;
+    int64_t last_status;
+    fossil_command_histogram_t metrics[FOSSIL_COMMAND_TRACE_METRICS];
+} fossil_command_trace_slot_t;
+
+#ifndef MSG_NOSIGNAL
+    #define MSG_NOSIGNAL 0
+#endif
+
+// Default sentinel for POSIX sh, written around the marker
+#define _FOSSIL_COMMAND_SESSION_PREFIX "printf '"
+#define _FOSSIL_COMMAND_SESSION_SUFFIX ":%d\\n' \"$?\""
+
+struct fossil_command_session {
+#ifndef _WIN32
+    pid_t pid;
+#endif
+    int in_fd;                // socket connected to the interpreter stdin
+    int out_fd;               // pipe connected to the interpreter stdout
+    int32_t alive;
+    uint64_t seq;
+    int64_t timeout_ms;       // per command and for close, 0 waits without a deadline
+    char *sentinel_prefix;
+    char *sentinel_suffix;
+    size_t len;               // bytes pending in buffer
+    char buffer[_FOSSIL_COMMAND_SESSION_BUFFER];
+};
+
+// Resolved command, path is NULL when the lookup failed (negative entry)
+typedef struct {
+    uint64_t hash;
+    char *name;
+    char *path;
+} fossil_command_cache_entry_t;
+
+// Directory from PATH together with the mtime observed when it was loaded
+typedef struct {
+    const char *dir;
+    time_t mtime;
+} fossil_command_path_dir_t;
+
+static struct {
+    char *path_env;                       // PATH the cache was built from
+    char *path_split;                     // same string split into directories
+    fossil_command_path_dir_t *dirs;
+    size_t num_dirs;
+    int64_t checked_ms;
+    size_t count;
+    fossil_command_cache_entry_t slots[_FOSSIL_COMMAND_CACHE_SLOTS];
+} fossil_command_cache;
+
+#ifdef _WIN32
+static SRWLOCK fossil_command_cache_lock = SRWLOCK_INIT;
+    #define _FOSSIL_COMMAND_CACHE_LOCK()   AcquireSRWLockExclusive(&fossil_command_cache_lock)
+    #define _FOSSIL_COMMAND_CACHE_UNLOCK() ReleaseSRWLockExclusive(&fossil_command_cache_lock)
+#else
+static pthread_mutex_t fossil_command_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+    #define _FOSSIL_COMMAND_CACHE_LOCK()   pthread_mutex_lock(&fossil_command_cache_lock)
+    #define _FOSSIL_COMMAND_CACHE_UNLOCK() pthread_mutex_unlock(&fossil_command_cache_lock)
 #endif
 
 // Define a typedef for char* to make the code more readable
 typedef char* fossil_command_t;
 
+static int64_t fossil_command_now_ns(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER counter;
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&counter);
+    return (int64_t)((double)counter.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+} // end of func
+
+static int64_t fossil_command_now_ms(void) {
+    return fossil_command_now_ns() / 1000000;
+} // end of func
+
+static char *fossil_command_strdup(const char *str) {
+    size_t len = strlen(str) + 1;
+    char *copy = malloc(len);
+    if (copy) {
+        memcpy(copy, str, len);
+    }
+    return copy;
+} // end of func
+
+// FNV-1a, good enough for short command names
+static uint64_t fossil_command_hash(const char *str) {
+    uint64_t hash = 14695981039346656037ULL;
+    while (*str) {
+        hash ^= (unsigned char)*str++;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+} // end of func
+
+// Operations the tracer distinguishes, in the order of their names
+typedef enum {
+    FOSSIL_COMMAND_OP_COMMAND,
+    FOSSIL_COMMAND_OP_OUTPUT,
+    FOSSIL_COMMAND_OP_EXISTS,
+    FOSSIL_COMMAND_OP_SESSION,
+    FOSSIL_COMMAND_OP_PIPELINE,
+    FOSSIL_COMMAND_OP_RESOLVE
+} fossil_command_op_t;
+
+static const char *fossil_command_op_names[] = {"command", "output", "exists", "session", "pipeline", "resolve"};
+
+static int64_t fossil_command_trace_enabled;
+static uint64_t fossil_command_trace_dropped;  // samples lost to a full slot table
+static fossil_command_trace_slot_t fossil_command_trace_slots[_FOSSIL_COMMAND_TRACE_SLOTS];
+
+static uint32_t fossil_command_msb(uint64_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (uint32_t)index;
+#else
+    return 63u - (uint32_t)__builtin_clzll(value);
+#endif
+} // end of func
+
+// Log-linear bucket: exact below 2^SUB_BITS, then 2^SUB_BITS buckets per power of two
+static uint32_t fossil_command_bucket_index(uint64_t value) {
+    if (value < _FOSSIL_COMMAND_TRACE_SUB) {
+        return (uint32_t)value;
+    }
+    uint32_t shift = fossil_command_msb(value) - _FOSSIL_COMMAND_TRACE_SUB_BITS;
+    return (shift + 1) * _FOSSIL_COMMAND_TRACE_SUB + (uint32_t)((value >> shift) & (_FOSSIL_COMMAND_TRACE_SUB - 1));
+} // end of func
+
+// Middle of the value range covered by a bucket
+static uint64_t fossil_command_bucket_value(uint32_t index) {
+    if (index < _FOSSIL_COMMAND_TRACE_SUB) {
+        return index;
+    }
+    uint32_t shift = index / _FOSSIL_COMMAND_TRACE_SUB - 1;
+    uint64_t lower = (uint64_t)(_FOSSIL_COMMAND_TRACE_SUB + index % _FOSSIL_COMMAND_TRACE_SUB) << shift;
+    return lower + (((uint64_t)1 << shift) >> 1);
+} // end of func
+
+static void fossil_command_histogram_record(fossil_command_histogram_t *hist, uint64_t value) {
+    _FOSSIL_ATOMIC_ADD(&hist->buckets[fossil_command_bucket_index(value)], 1);
+    _FOSSIL_ATOMIC_ADD(&hist->count, 1);
+    _FOSSIL_ATOMIC_ADD(&hist->sum, value);
+
+    uint64_t current = _FOSSIL_ATOMIC_LOAD(&hist->max);
+    while (value > current && !_FOSSIL_ATOMIC_CAS(&hist->max, &current, value)) {
+    }
+    // min is stored inverted so a zeroed histogram needs no initialisation
+    current = _FOSSIL_ATOMIC_LOAD(&hist->inverted_min);
+    while (~value > current && !_FOSSIL_ATOMIC_CAS(&hist->inverted_min, &current, ~value)) {
+    }
+} // end of func
+
+static void fossil_command_histogram_stats(fossil_command_histogram_t *hist, fossil_command_trace_stats_t *stats) {
+    const double quantiles[3] = {0.50, 0.90, 0.99};
+    uint64_t *targets[3] = {&stats->p50, &stats->p90, &stats->p99};
+
+    memset(stats, 0, sizeof(*stats));
+    stats->count = _FOSSIL_ATOMIC_LOAD(&hist->count);
+    if (stats->count == 0) {
+        return;
+    }
+    stats->sum = _FOSSIL_ATOMIC_LOAD(&hist->sum);
+    stats->max = _FOSSIL_ATOMIC_LOAD(&hist->max);
+    stats->min = ~_FOSSIL_ATOMIC_LOAD(&hist->inverted_min);
+
+    uint64_t seen = 0;
+    size_t next = 0;
+    for (uint32_t i = 0; i < _FOSSIL_COMMAND_TRACE_BUCKETS && next < 3; ++i) {
+        seen += _FOSSIL_ATOMIC_LOAD(&hist->buckets[i]);
+        while (next < 3 && (double)seen >= quantiles[next] * (double)stats->count) {
+            uint64_t value = fossil_command_bucket_value(i);
+            *targets[next++] = value < stats->min ? stats->min : (value > stats->max ? stats->max : value);
+        }
+    }
+} // end of func
+
+// The traced name is the basename of the first word of the command line
+static void fossil_command_trace_name(const char *command, char *name, size_t name_size) {
+    const char *start = command ? command : "";
+    while (*start == ' ' || *start == '\t') {
+        ++start;
+    }
+    const char *end = start;
+    while (*end && *end != ' ' && *end != '\t' && *end != '\n') {
+        if (*end == '/' || *end == '\\') {
+            start = end + 1;
+        }
+        ++end;
+    }
+    size_t len = (size_t)(end - start);
+    if (len >= name_size) {
+        len = name_size - 1;
+    }
+    memcpy(name, start, len);
+    name[len] = '\0';
+} // end of func
+
+static fossil_command_trace_slot_t *fossil_command_trace_slot(fossil_command_op_t op, const char *command) {
+    char name[sizeof(fossil_command_trace_slots[0].name)];
+    fossil_command_trace_name(command, name, sizeof(name));
+
+    uint64_t key = (fossil_command_hash(name) ^ ((uint64_t)(op + 1) * 0x9E3779B97F4A7C15ULL)) | 1;
+    size_t mask = _FOSSIL_COMMAND_TRACE_SLOTS - 1;
+    for (size_t probe = 0, i = (size_t)key & mask; probe < _FOSSIL_COMMAND_TRACE_SLOTS; ++probe, i = (i + 1) & mask) {
+        fossil_command_trace_slot_t *slot = &fossil_command_trace_slots[i];
+        uint64_t current = _FOSSIL_ATOMIC_LOAD(&slot->key);
+        if (current == key) {
+            return slot;
+        }
+        if (current == 0) {
+            uint64_t expected = 0;
+            if (_FOSSIL_ATOMIC_CAS(&slot->key, &expected, key)) {
+                // Claimed: publish the name, snapshots skip the slot until then
+                slot->op = (uint32_t)op;
+                memcpy(slot->name, name, sizeof(name));
+                _FOSSIL_ATOMIC_STORE(&slot->ready, 1);
+                return slot;
+            }
+            if (expected == key) {
+                return slot;
+            }
+        }
+    }
+    return NULL;  // table full, drop the sample
+} // end of func
+
+static void fossil_command_trace_record(fossil_command_op_t op, const char *command, int64_t spawn_ns, int64_t run_ns, int64_t bytes, int32_t status) {
+    fossil_command_trace_slot_t *slot = fossil_command_trace_slot(op, command);
+    if (!slot) {
+        _FOSSIL_ATOMIC_ADD(&fossil_command_trace_dropped, 1);
+        return;
+    }
+
+    _FOSSIL_ATOMIC_ADD(&slot->calls, 1);
+    if (status != 0) {
+        _FOSSIL_ATOMIC_ADD(&slot->failures, 1);
+    }
+    _FOSSIL_ATOMIC_STORE(&slot->last_status, (int64_t)status);
+
+    if (spawn_ns >= 0) {
+        fossil_command_histogram_record(&slot->metrics[FOSSIL_COMMAND_TRACE_SPAWN], (uint64_t)spawn_ns);
+    }
+    if (run_ns >= 0) {
+        fossil_command_histogram_record(&slot->metrics[FOSSIL_COMMAND_TRACE_RUN], (uint64_t)run_ns);
+    }
+    if (bytes >= 0) {
+        fossil_command_histogram_record(&slot->metrics[FOSSIL_COMMAND_TRACE_BYTES], (uint64_t)bytes);
+    }
+} // end of func
+
+#define _FOSSIL_COMMAND_TRACING() (_FOSSIL_ATOMIC_LOAD_RELAXED(&fossil_command_trace_enabled) != 0)
+
+void fossil_command_trace_enable(int32_t enable) {
+    _FOSSIL_ATOMIC_STORE(&fossil_command_trace_enabled, enable ? 1 : 0);
+} // end of func
+
+size_t fossil_command_trace_snapshot(fossil_command_trace_entry_t *entries, size_t max_entries) {
+    size_t count = 0;
+    for (size_t i = 0; i < _FOSSIL_COMMAND_TRACE_SLOTS; ++i) {
+        fossil_command_trace_slot_t *slot = &fossil_command_trace_slots[i];
+        if (!_FOSSIL_ATOMIC_LOAD(&slot->ready)) {
+            continue;
+        }
+        if (entries && count < max_entries) {
+            fossil_command_trace_entry_t *entry = &entries[count];
+            snprintf(entry->operation, sizeof(entry->operation), "%s", fossil_command_op_names[slot->op]);
+            snprintf(entry->name, sizeof(entry->name), "%s", slot->name);
+            entry->calls = _FOSSIL_ATOMIC_LOAD(&slot->calls);
+            entry->failures = _FOSSIL_ATOMIC_LOAD(&slot->failures);
+            entry->last_status = (int32_t)_FOSSIL_ATOMIC_LOAD(&slot->last_status);
+            for (int32_t m = 0; m < FOSSIL_COMMAND_TRACE_METRICS; ++m) {
+                fossil_command_histogram_stats(&slot->metrics[m], &entry->metrics[m]);
+            }
+        }
+        ++count;
+    }
+
+    // Samples that found no free slot are reported as one "dropped" entry
+    uint64_t dropped = _FOSSIL_ATOMIC_LOAD(&fossil_command_trace_dropped);
+    if (dropped) {
+        if (entries && count < max_entries) {
+            fossil_command_trace_entry_t *entry = &entries[count];
+            memset(entry, 0, sizeof(*entry));
+            snprintf(entry->operation, sizeof(entry->operation), "%s", "dropped");
+            entry->calls = dropped;
+        }
+        ++count;
+    }
+    return count;
+} // end of func
+
+int32_t fossil_command_trace_dump(FILE *stream, fossil_command_trace_format_t format) {
+    static const char *metric_names[FOSSIL_COMMAND_TRACE_METRICS] = {"spawn_ns", "run_ns", "bytes"};
+    fossil_command_trace_entry_t *entries;
+    size_t count;
+
+    if (!stream) {
+        fprintf(stderr, "Error: Invalid trace stream.\n");
+        return -1;
+    }
+
+    entries = malloc((_FOSSIL_COMMAND_TRACE_SLOTS + 1) * sizeof(fossil_command_trace_entry_t));
+    if (!entries) {
+        fprintf(stderr, "Memory allocation error for trace snapshot.\n");
+        return -1;
+    }
+    count = fossil_command_trace_snapshot(entries, _FOSSIL_COMMAND_TRACE_SLOTS + 1);
+
+    if (format == FOSSIL_COMMAND_TRACE_CSV) {
+        fprintf(stream, "operation,name,calls,failures,last_status");
+        for (int32_t m = 0; m < FOSSIL_COMMAND_TRACE_METRICS; ++m) {
+            fprintf(stream, ",%s_count,%s_min,%s_max,%s_sum,%s_p50,%s_p90,%s_p99",
+                    metric_names[m], metric_names[m], metric_names[m], metric_names[m],
+                    metric_names[m], metric_names[m], metric_names[m]);
+        }
+        fprintf(stream, "\n");
+    } else {
+        fprintf(stream, "[");
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        const fossil_command_trace_entry_t *e = &entries[i];
+        if (format == FOSSIL_COMMAND_TRACE_CSV) {
+            // Tool names come from command lines, quote them for CSV
+            fprintf(stream, "%s,\"", e->operation);
+            for (const char *c = e->name; *c; ++c) {
+                fprintf(stream, *c == '"' ? "\"\"" : "%c", *c);
+            }
+            fprintf(stream, "\",%llu,%llu,%d", (unsigned long long)e->calls, (unsigned long long)e->failures, (int)e->last_status);
+            for (int32_t m = 0; m < FOSSIL_COMMAND_TRACE_METRICS; ++m) {
+                const fossil_command_trace_stats_t *st = &e->metrics[m];
+                fprintf(stream, ",%llu,%llu,%llu,%llu,%llu,%llu,%llu",
+                        (unsigned long long)st->count, (unsigned long long)st->min, (unsigned long long)st->max,
+                        (unsigned long long)st->sum, (unsigned long long)st->p50, (unsigned long long)st->p90,
+                        (unsigned long long)st->p99);
+            }
+            fprintf(stream, "\n");
+        } else {
+            fprintf(stream, "%s\n  {\"operation\": \"%s\", \"name\": \"", i ? "," : "", e->operation);
+            for (const char *c = e->name; *c; ++c) {
+                if (*c == '"' || *c == '\\') {
+                    fprintf(stream, "\\%c", *c);
+                } else if ((unsigned char)*c < 0x20) {
+                    fprintf(stream, "\\u%04x", (unsigned)(unsigned char)*c);
+                } else {
+                    fputc(*c, stream);
+                }
+            }
+            fprintf(stream, "\", \"calls\": %llu, \"failures\": %llu, \"last_status\": %d",
+                    (unsigned long long)e->calls, (unsigned long long)e->failures, (int)e->last_status);
+            for (int32_t m = 0; m < FOSSIL_COMMAND_TRACE_METRICS; ++m) {
+                const fossil_command_trace_stats_t *st = &e->metrics[m];
+                fprintf(stream, ", \"%s\": {\"count\": %llu, \"min\": %llu, \"max\": %llu, \"sum\": %llu, \"p50\": %llu, \"p90\": %llu, \"p99\": %llu}",
+                        metric_names[m], (unsigned long long)st->count, (unsigned long long)st->min,
+                        (unsigned long long)st->max, (unsigned long long)st->sum, (unsigned long long)st->p50,
+                        (unsigned long long)st->p90, (unsigned long long)st->p99);
+            }
+            fprintf(stream, "}");
+        }
+    }
+
+    if (format != FOSSIL_COMMAND_TRACE_CSV) {
+        fprintf(stream, "%s]\n", count ? "\n" : "");
+    }
+
+    free(entries);
+    return ferror(stream) ? -1 : 0;
+} // end of func
+
+void fossil_command_trace_reset(void) {
+    // Recording threads may race with the reset, a few samples can be lost
+    for (size_t i = 0; i < _FOSSIL_COMMAND_TRACE_SLOTS; ++i) {
+        _FOSSIL_ATOMIC_STORE(&fossil_command_trace_slots[i].ready, 0);
+        _FOSSIL_ATOMIC_STORE(&fossil_command_trace_slots[i].key, 0);
+    }
+    memset(fossil_command_trace_slots, 0, sizeof(fossil_command_trace_slots));
+    _FOSSIL_ATOMIC_STORE(&fossil_command_trace_dropped, 0);
+} // end of func
+
 // Function to run a command
 int32_t fossil_command(fossil_command_t process) {
+    int64_t start = _FOSSIL_COMMAND_TRACING() ? fossil_command_now_ns() : -1;
     int32_t result = system(process);
     if (result == -1) {
         perror("Error executing command");
     }
+    if (start >= 0) {
+        fossil_command_trace_record(FOSSIL_COMMAND_OP_COMMAND, process, -1, fossil_command_now_ns() - start, -1, result);
+    }
     return result;
 } // end of func
 
@@ -53,9 +524,275 @@ int32_t fossil_command_success(fossil_command_t process) {
     return result;
 } // end of func
 
+#ifndef _WIN32
+// Map a waitpid status to an exit code, signals are reported like the shell does
+static int32_t fossil_command_decode_status(int status) {
+    if (WIFEXITED(status)) {
+        return WEXITSTATUS(status);
+    }
+    if (WIFSIGNALED(status)) {
+        return 128 + WTERMSIG(status);
+    }
+    return FOSSIL_COMMAND_ERROR;
+} // end of func
+
+static int fossil_command_pipe_cloexec(int fds[2]) {
+#ifdef __linux__
+    return pipe2(fds, O_CLOEXEC);
+#else
+    if (pipe(fds) == -1) {
+        return -1;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return 0;
+#endif
+} // end of func
+
+// Runs in the forked child: apply the limits, wire stdout and exec the shell
+static void fossil_command_child_exec(fossil_command_t process, int out_fd, int cgroup_fd, const fossil_command_limits_t *limits) {
+    if (limits) {
+        if (limits->timeout_ms > 0 || limits->cancel) {
+            setpgid(0, 0);  // own group so the whole pipeline can be signalled
+        }
+        if (cgroup_fd >= 0) {
+            if (write(cgroup_fd, "0\n", 2) != 2) {
+                _exit(EXIT_FAILURE);
+            }
+            close(cgroup_fd);
+        }
+        if (limits->cpu_limit_sec > 0) {
+            struct rlimit rl = {(rlim_t)limits->cpu_limit_sec, (rlim_t)limits->cpu_limit_sec + 1};
+            setrlimit(RLIMIT_CPU, &rl);
+        }
+        if (limits->memory_limit_bytes > 0) {
+            struct rlimit rl = {(rlim_t)limits->memory_limit_bytes, (rlim_t)limits->memory_limit_bytes};
+            setrlimit(RLIMIT_AS, &rl);
+        }
+    }
+
+    if (out_fd == STDOUT_FILENO) {
+        fcntl(out_fd, F_SETFD, 0);  // already in place, only the close-on-exec flag must go
+    } else if (out_fd >= 0) {
+        if (dup2(out_fd, STDOUT_FILENO) == -1) {
+            _exit(EXIT_FAILURE);
+        }
+        close(out_fd);
+    }
+
+    execl("/bin/sh", "/bin/sh", "-c", process, (char *)NULL);
+    _exit(127);
+} // end of func
+
+static int fossil_command_pidfd_open(pid_t pid) {
+#if defined(__linux__) && defined(SYS_pidfd_open)
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    return -1;
+#endif
+} // end of func
+
+// Drain whatever is readable, keeping what fits in the output buffer
+static int32_t fossil_command_drain(int fd, char *output, size_t output_size, size_t *used) {
+    char scratch[4096];
+    for (;;) {
+        char *dst = scratch;
+        size_t room = sizeof(scratch);
+        if (output && *used + 1 < output_size) {
+            dst = output + *used;
+            room = output_size - 1 - *used;
+        }
+
+        ssize_t n = read(fd, dst, room);
+        if (n > 0) {
+            if (dst != scratch) {
+                *used += (size_t)n;
+            }
+            continue;
+        }
+        if (n == 0) {
+            return 0;  // EOF
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 1 : 0;
+    }
+} // end of func
+
+static int32_t fossil_command_run_limited(fossil_command_t process, char *output, size_t output_size, const fossil_command_limits_t *limits) {
+    int pipe_fd[2] = {-1, -1};
+    int cgroup_fd = -1;
+    int capture = output != NULL;
+
+    int64_t start = _FOSSIL_COMMAND_TRACING() ? fossil_command_now_ns() : -1;
+    int64_t spawned = -1;
+
+    if (!process) {
+        fprintf(stderr, "Error: Null command provided.\n");
+        return FOSSIL_COMMAND_ERROR;
+    }
+
+    if (capture && output_size > 0) {
+        output[0] = '\0';
+    }
+
+    if (limits && limits->cgroup_path) {
+        char procs[_FOSSIL_COMMAND_PATH_MAX];
+        snprintf(procs, sizeof(procs), "%s/cgroup.procs", limits->cgroup_path);
+        cgroup_fd = open(procs, O_WRONLY | O_CLOEXEC);
+        if (cgroup_fd == -1) {
+            perror("Error opening cgroup");
+            return FOSSIL_COMMAND_ERROR;
+        }
+    }
+
+    if (capture && fossil_command_pipe_cloexec(pipe_fd) == -1) {
+        perror("Error creating pipe");
+        if (cgroup_fd >= 0) {
+            close(cgroup_fd);
+        }
+        return FOSSIL_COMMAND_ERROR;
+    }
+
+    pid_t child_pid = fork();
+    if (child_pid == -1) {
+        perror("Error forking process");
+        if (capture) {
+            close(pipe_fd[0]);
+            close(pipe_fd[1]);
+        }
+        if (cgroup_fd >= 0) {
+            close(cgroup_fd);
+        }
+        return FOSSIL_COMMAND_ERROR;
+    }
+
+    if (child_pid == 0) {
+        if (capture) {
+            close(pipe_fd[0]);
+        }
+        fossil_command_child_exec(process, pipe_fd[1], cgroup_fd, limits);
+    }
+
+    if (start >= 0) {
+        spawned = fossil_command_now_ns() - start;
+    }
+    if (cgroup_fd >= 0) {
+        close(cgroup_fd);
+    }
+    if (capture) {
+        close(pipe_fd[1]);
+        fcntl(pipe_fd[0], F_SETFL, fcntl(pipe_fd[0], F_GETFL) | O_NONBLOCK);
+    }
+
+    int group_kill = limits && (limits->timeout_ms > 0 || limits->cancel);
+    if (group_kill) {
+        setpgid(child_pid, child_pid);  // also done by the child, whichever runs first wins the race
+    }
+
+    int pidfd = fossil_command_pidfd_open(child_pid);
+    int read_fd = capture ? pipe_fd[0] : -1;
+    int64_t grace = (limits && limits->kill_grace_ms > 0) ? limits->kill_grace_ms : _FOSSIL_COMMAND_DEFAULT_GRACE_MS;
+    int64_t deadline = (limits && limits->timeout_ms > 0) ? fossil_command_now_ms() + limits->timeout_ms : -1;
+    int32_t stopped = 0;  // FOSSIL_COMMAND_TIMEOUT or FOSSIL_COMMAND_CANCELLED once we started killing
+    int32_t term_sent = 0;
+    int32_t wait_failed = 0;
+    size_t used = 0;
+    int status = 0;
+
+    for (;;) {
+        int64_t now = fossil_command_now_ms();
+
+        if (!stopped && limits && limits->cancel && *limits->cancel) {
+            stopped = FOSSIL_COMMAND_CANCELLED;
+            deadline = now;
+        }
+        if (deadline >= 0 && now >= deadline) {
+            pid_t target = group_kill ? -child_pid : child_pid;
+            if (!stopped) {
+                stopped = FOSSIL_COMMAND_TIMEOUT;
+            }
+            if (!term_sent) {
+                kill(target, SIGTERM);  // be polite first
+                term_sent = 1;
+                deadline = now + grace;
+            } else {
+                kill(target, SIGKILL);
+                deadline = -1;
+            }
+        }
+
+        pid_t done = waitpid(child_pid, &status, WNOHANG);
+        if (done == child_pid) {
+            break;
+        }
+        if (done == -1 && errno != EINTR) {
+            perror("Error waiting for process");
+            wait_failed = 1;
+            break;
+        }
+
+        int timeout = -1;
+        if (deadline >= 0) {
+            timeout = (int)(deadline - now);
+        }
+        if (pidfd < 0 || (limits && limits->cancel && !stopped)) {
+            if (timeout < 0 || timeout > _FOSSIL_COMMAND_POLL_TICK_MS) {
+                timeout = _FOSSIL_COMMAND_POLL_TICK_MS;
+            }
+        }
+
+        struct pollfd fds[2];
+        nfds_t nfds = 0;
+        if (read_fd >= 0) {
+            fds[nfds].fd = read_fd;
+            fds[nfds++].events = POLLIN;
+        }
+        if (pidfd >= 0) {
+            fds[nfds].fd = pidfd;
+            fds[nfds++].events = POLLIN;
+        }
+
+        if (poll(fds, nfds, timeout) > 0 && read_fd >= 0 && fds[0].revents) {
+            if (!fossil_command_drain(read_fd, output, output_size, &used)) {
+                close(read_fd);
+                read_fd = -1;
+            }
+        }
+    }
+
+    if (read_fd >= 0) {
+        fossil_command_drain(read_fd, output, output_size, &used);
+        close(read_fd);
+    }
+    if (pidfd >= 0) {
+        close(pidfd);
+    }
+    if (capture && output_size > 0) {
+        output[used] = '\0';
+    }
+
+    int32_t result = wait_failed ? FOSSIL_COMMAND_ERROR : stopped ? stopped : fossil_command_decode_status(status);
+
+    if (start >= 0) {
+        fossil_command_trace_record(capture ? FOSSIL_COMMAND_OP_OUTPUT : FOSSIL_COMMAND_OP_COMMAND, process,
+                                    spawned, fossil_command_now_ns() - start, capture ? (int64_t)used : -1, result);
+    }
+    return result;
+} // end of func
+#endif
+
 // Function to get the output of a command
 int32_t fossil_command_output(fossil_command_t process, char *output, size_t output_size) {
+    return fossil_command_output_ex(process, output, output_size, NULL);
+} // end of func
+
+// Function to get the output of a command under a deadline and resource limits
+int32_t fossil_command_output_ex(fossil_command_t process, char *output, size_t output_size, const fossil_command_limits_t *limits) {
 #ifdef _WIN32
+    (void)limits;
     FILE *pipe = _popen(process, "r");
     if (!pipe) {
         perror("Error opening pipe");
@@ -78,98 +815,665 @@ int32_t fossil_command_output(fossil_command_t process, char *output, size_t out
 
     return status;
 #else
-    int32_t pipe_fd[2];
-    pid_t child_pid;
+    if (!output || output_size == 0) {
+        fprintf(stderr, "Error: Invalid output buffer.\n");
+        return FOSSIL_COMMAND_ERROR;
+    }
+    return fossil_command_run_limited(process, output, output_size, limits);
+#endif
+} // end of func
+
+// Function to run a command under a deadline and resource limits
+int32_t fossil_command_ex(fossil_command_t process, const fossil_command_limits_t *limits) {
+#ifdef _WIN32
+    (void)limits;
+    return fossil_command(process);
+#else
+    return fossil_command_run_limited(process, NULL, 0, limits);
+#endif
+} // end of func
+
+#ifndef _WIN32
+// Start one pipeline stage with its stdin/stdout redirected, returns 0 on success
+static int fossil_command_spawn_stage(pid_t *pid, const char *const *argv, int in_fd, int out_fd) {
+    char path[_FOSSIL_COMMAND_PATH_MAX];
+    posix_spawn_file_actions_t actions;
+    int err;
+
+    if (!argv || !argv[0] || !fossil_command_resolve(argv[0], path, sizeof(path))) {
+        return ENOENT;
+    }
+
+    posix_spawn_file_actions_init(&actions);
+    if (in_fd >= 0) {
+        posix_spawn_file_actions_adddup2(&actions, in_fd, STDIN_FILENO);
+    }
+    if (out_fd >= 0) {
+        posix_spawn_file_actions_adddup2(&actions, out_fd, STDOUT_FILENO);
+    }
+    // Every pipe end is close-on-exec, only the dup2'ed copies survive
+    err = posix_spawn(pid, path, &actions, NULL, (char *const *)argv, _FOSSIL_ENVIRON);
+    posix_spawn_file_actions_destroy(&actions);
+    return err;
+} // end of func
+#endif
+
+// Function to run a pipeline of commands without a shell
+int32_t fossil_command_pipeline(const char *const *stages[], int32_t num_stages, char *output, size_t output_size, int32_t *statuses, size_t pipe_size) {
+#ifdef _WIN32
+    (void)stages;
+    (void)num_stages;
+    (void)output;
+    (void)output_size;
+    (void)statuses;
+    (void)pipe_size;
+    fprintf(stderr, "Error: Command pipelines are not supported on this platform.\n");
+    return FOSSIL_COMMAND_ERROR;
+#else
+    int64_t start = _FOSSIL_COMMAND_TRACING() ? fossil_command_now_ns() : -1;
+    int64_t spawned = -1;
+    int capture = output != NULL;
+    int prev_read = -1;
+    int32_t reached = num_stages;  // stages from here on were never attempted
+    size_t used = 0;
+
+    if (!stages || num_stages <= 0 || (capture && output_size == 0)) {
+        fprintf(stderr, "Error: Invalid pipeline stages or output buffer.\n");
+        return FOSSIL_COMMAND_ERROR;
+    }
+    if (capture) {
+        output[0] = '\0';
+    }
+
+    pid_t *pids = calloc((size_t)num_stages, sizeof(pid_t));
+    if (!pids) {
+        fprintf(stderr, "Memory allocation error for pipeline.\n");
+        return FOSSIL_COMMAND_ERROR;
+    }
+    // Stages after a failed pipe are never reached, the reaper must skip them
+    for (int32_t i = 0; i < num_stages; ++i) {
+        pids[i] = -1;
+    }
+
+    for (int32_t i = 0; i < num_stages; ++i) {
+        int next[2] = {-1, -1};
+        int last = (i == num_stages - 1);
+
+        if ((!last || capture) && fossil_command_pipe_cloexec(next) == -1) {
+            perror("Error creating pipe");
+            reached = i;
+            break;
+        }
+#ifdef F_SETPIPE_SZ
+        if (pipe_size > 0 && !last) {
+            fcntl(next[1], F_SETPIPE_SZ, (int)pipe_size);  // best effort, capped by pipe-max-size
+        }
+#else
+        (void)pipe_size;
+#endif
+
+        int err = fossil_command_spawn_stage(&pids[i], stages[i], prev_read, next[1]);
+        if (err != 0) {
+            // Like the shell: a missing stage reports 127, its neighbours see EOF/EPIPE
+            fprintf(stderr, "Error spawning '%s': %s\n", stages[i] && stages[i][0] ? stages[i][0] : "(null)", strerror(err));
+            pids[i] = -1;
+        }
+
+        if (prev_read >= 0) {
+            close(prev_read);
+        }
+        if (next[1] >= 0) {
+            close(next[1]);
+        }
+        prev_read = next[0];
+    }
+
+    if (start >= 0) {
+        spawned = fossil_command_now_ns() - start;
+    }
+
+    if (prev_read >= 0) {
+        if (capture && reached == num_stages) {
+            fossil_command_drain(prev_read, output, output_size, &used);
+            output[used] = '\0';
+        }
+        close(prev_read);
+    }
 
-    // Create a pipe
-    if (pipe(pipe_fd) == -1) {
+    int32_t result = FOSSIL_COMMAND_ERROR;
+    for (int32_t i = 0; i < num_stages; ++i) {
+        int32_t code = 127;
+        if (i >= reached) {
+            code = FOSSIL_COMMAND_ERROR;
+        } else if (pids[i] != -1) {
+            int status = 0;
+            while (waitpid(pids[i], &status, 0) == -1 && errno == EINTR) {
+            }
+            code = fossil_command_decode_status(status);
+        }
+        if (statuses) {
+            statuses[i] = code;
+        }
+        result = code;
+    }
+    free(pids);
+
+    if (reached < num_stages) {
+        result = FOSSIL_COMMAND_ERROR;
+    }
+    if (start >= 0) {
+        fossil_command_trace_record(FOSSIL_COMMAND_OP_PIPELINE, stages[0] ? stages[0][0] : NULL,
+                                    spawned, fossil_command_now_ns() - start, capture ? (int64_t)used : -1, result);
+    }
+    return result;
+#endif
+} // end of func
+
+#ifndef _WIN32
+static int32_t fossil_command_send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 0;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 1;
+} // end of func
+
+// Append up to count bytes of session output to the caller buffer
+static void fossil_command_session_emit(const char *data, size_t count, char *output, size_t output_size, size_t *used) {
+    if (!output || *used + 1 >= output_size) {
+        return;
+    }
+    size_t room = output_size - 1 - *used;
+    size_t take = count < room ? count : room;
+    memcpy(output + *used, data, take);
+    *used += take;
+} // end of func
+#endif
+
+static void fossil_command_session_free(fossil_command_session_t *session) {
+    free(session->sentinel_prefix);
+    free(session->sentinel_suffix);
+    free(session);
+} // end of func
+
+fossil_command_session_t *fossil_command_session_open(const char *interpreter, const char *sentinel_prefix, const char *sentinel_suffix) {
+#ifdef _WIN32
+    (void)interpreter;
+    (void)sentinel_prefix;
+    (void)sentinel_suffix;
+    fprintf(stderr, "Error: Command sessions are not supported on this platform.\n");
+    return NULL;
+#else
+    int in_pair[2];
+    int out_pipe[2];
+
+    fossil_command_session_t *session = calloc(1, sizeof(fossil_command_session_t));
+    if (!session) {
+        fprintf(stderr, "Memory allocation error for command session.\n");
+        return NULL;
+    }
+
+    session->sentinel_prefix = fossil_command_strdup(sentinel_prefix ? sentinel_prefix : _FOSSIL_COMMAND_SESSION_PREFIX);
+    session->sentinel_suffix = fossil_command_strdup(sentinel_suffix ? sentinel_suffix : _FOSSIL_COMMAND_SESSION_SUFFIX);
+    if (!session->sentinel_prefix || !session->sentinel_suffix) {
+        fossil_command_session_free(session);
+        return NULL;
+    }
+
+    // A socket for stdin lets us write with MSG_NOSIGNAL if the interpreter died
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, in_pair) == -1) {
+        perror("Error creating session socket");
+        fossil_command_session_free(session);
+        return NULL;
+    }
+    if (pipe(out_pipe) == -1) {
         perror("Error creating pipe");
-        return -1;
+        close(in_pair[0]);
+        close(in_pair[1]);
+        fossil_command_session_free(session);
+        return NULL;
     }
+    fcntl(in_pair[0], F_SETFD, FD_CLOEXEC);
+    fcntl(out_pipe[0], F_SETFD, FD_CLOEXEC);
 
-    // Fork a child process
-    if ((child_pid = fork()) == -1) {
+    session->pid = fork();
+    if (session->pid == -1) {
         perror("Error forking process");
-        close(pipe_fd[0]);
-        close(pipe_fd[1]);
-        return -1;
+        close(in_pair[0]);
+        close(in_pair[1]);
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        fossil_command_session_free(session);
+        return NULL;
     }
 
-    if (child_pid == 0) {
-        // Child process
-        close(pipe_fd[0]);  // Close the read end of the pipe
+    if (session->pid == 0) {
+        setpgid(0, 0);  // own group so a timeout can stop whatever the interpreter started
+        if (dup2(in_pair[1], STDIN_FILENO) == -1 || dup2(out_pipe[1], STDOUT_FILENO) == -1) {
+            _exit(EXIT_FAILURE);
+        }
+        close(in_pair[1]);
+        close(out_pipe[1]);
+        const char *shell = interpreter ? interpreter : "/bin/sh";
+        execlp(shell, shell, (char *)NULL);
+        _exit(127);
+    }
+
+    setpgid(session->pid, session->pid);  // also done by the child, whichever runs first wins the race
+    close(in_pair[1]);
+    close(out_pipe[1]);
+    session->in_fd = in_pair[0];
+    session->out_fd = out_pipe[0];
+    session->alive = 1;
+    return session;
+#endif
+} // end of func
+
+static int32_t fossil_command_session_exchange(fossil_command_session_t *session, const char *command, char *output, size_t output_size, size_t *used) {
+    if (!session || !command) {
+        fprintf(stderr, "Error: Invalid session or command.\n");
+        return FOSSIL_COMMAND_ERROR;
+    }
+    if (output && output_size > 0) {
+        output[0] = '\0';
+    }
+#ifdef _WIN32
+    return FOSSIL_COMMAND_ERROR;
+#else
+    if (!session->alive) {
+        return FOSSIL_COMMAND_ERROR;
+    }
+
+    char marker[_FOSSIL_COMMAND_SESSION_MARKER];
+    int marker_len = snprintf(marker, sizeof(marker), "__fossil_%ld_%llu__:",
+                              (long)session->pid, (unsigned long long)++session->seq);
 
-        // Redirect stdout to the pipe
-        if (dup2(pipe_fd[1], STDOUT_FILENO) == -1) {
-            perror("Error redirecting stdout");
-            exit(EXIT_FAILURE);
+    // The marker written into the sentinel line does not carry the trailing ':'
+    if (!fossil_command_send_all(session->in_fd, command, strlen(command)) ||
+        !fossil_command_send_all(session->in_fd, "\n", 1) ||
+        !fossil_command_send_all(session->in_fd, session->sentinel_prefix, strlen(session->sentinel_prefix)) ||
+        !fossil_command_send_all(session->in_fd, marker, (size_t)marker_len - 1) ||
+        !fossil_command_send_all(session->in_fd, session->sentinel_suffix, strlen(session->sentinel_suffix)) ||
+        !fossil_command_send_all(session->in_fd, "\n", 1)) {
+        session->alive = 0;
+        return FOSSIL_COMMAND_ERROR;
+    }
+
+    int64_t deadline = session->timeout_ms > 0 ? fossil_command_now_ms() + session->timeout_ms : -1;
+    for (;;) {
+        char *hit = NULL;
+        if (session->len >= (size_t)marker_len) {
+            for (char *p = session->buffer; p + marker_len <= session->buffer + session->len; ++p) {
+                p = memchr(p, marker[0], (size_t)(session->buffer + session->len - p));
+                if (!p || p + marker_len > session->buffer + session->len) {
+                    break;
+                }
+                if (memcmp(p, marker, (size_t)marker_len) == 0) {
+                    hit = p;
+                    break;
+                }
+            }
         }
 
-        // Close the unused write end of the pipe
-        close(pipe_fd[1]);
+        if (hit) {
+            char *eol = memchr(hit, '\n', (size_t)(session->buffer + session->len - hit));
+            if (eol) {
+                fossil_command_session_emit(session->buffer, (size_t)(hit - session->buffer), output, output_size, used);
+                int32_t status = (int32_t)strtol(hit + marker_len, NULL, 10);
+                size_t rest = (size_t)(session->buffer + session->len - (eol + 1));
+                memmove(session->buffer, eol + 1, rest);
+                session->len = rest;
+                if (output && output_size > 0) {
+                    output[*used] = '\0';
+                }
+                return status;
+            }
+        } else if (session->len >= (size_t)marker_len) {
+            // Everything except a possible partial marker at the end is plain output
+            size_t keep = (size_t)marker_len - 1;
+            size_t flush = session->len - keep;
+            fossil_command_session_emit(session->buffer, flush, output, output_size, used);
+            memmove(session->buffer, session->buffer + flush, keep);
+            session->len = keep;
+        }
 
-        // Execute the command
-        execl("/bin/sh", "/bin/sh", "-c", process, (char *)NULL);
-        perror("Error executing command");
-        exit(EXIT_FAILURE);
-    } else {
-        // Parent process
-        close(pipe_fd[1]);  // Close the write end of the pipe
+        if (session->len == sizeof(session->buffer)) {
+            // Marker found but its status line never ended, the stream is garbage
+            session->alive = 0;
+            return FOSSIL_COMMAND_ERROR;
+        }
 
-        // Read the output from the pipe
-        size_t bytesRead = read(pipe_fd[0], output, output_size - 1);
-        if (bytesRead == (size_t)-1) {
-            perror("Error reading from pipe");
-            close(pipe_fd[0]);
-            waitpid(child_pid, NULL, 0);  // Wait for the child process to complete
-            return -1;
+        if (deadline >= 0) {
+            int64_t left = deadline - fossil_command_now_ms();
+            struct pollfd pfd = {session->out_fd, POLLIN, 0};
+            int ready = left > 0 ? poll(&pfd, 1, left > INT_MAX ? INT_MAX : (int)left) : 0;
+            if (ready < 0 && errno == EINTR) {
+                continue;
+            }
+            if (ready == 0) {
+                // The stream is out of step now, so the session cannot be reused
+                fossil_command_session_emit(session->buffer, session->len, output, output_size, used);
+                session->len = 0;
+                session->alive = 0;
+                kill(-session->pid, SIGKILL);
+                if (output && output_size > 0) {
+                    output[*used] = '\0';
+                }
+                return FOSSIL_COMMAND_TIMEOUT;
+            }
         }
 
-        // Null-terminate the output
-        output[bytesRead] = '\0';
+        ssize_t n = read(session->out_fd, session->buffer + session->len, sizeof(session->buffer) - session->len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            // The interpreter exited, e.g. the command called exit
+            fossil_command_session_emit(session->buffer, session->len, output, output_size, used);
+            session->len = 0;
+            session->alive = 0;
+            if (output && output_size > 0) {
+                output[*used] = '\0';
+            }
+            return FOSSIL_COMMAND_ERROR;
+        }
+        session->len += (size_t)n;
+    }
+#endif
+} // end of func
 
-        close(pipe_fd[0]);  // Close the read end of the pipe
+int32_t fossil_command_session_run(fossil_command_session_t *session, const char *command, char *output, size_t output_size) {
+    int64_t start = _FOSSIL_COMMAND_TRACING() ? fossil_command_now_ns() : -1;
+    size_t captured = 0;
+    int32_t result = fossil_command_session_exchange(session, command, output, output_size, &captured);
+    if (start >= 0) {
+        fossil_command_trace_record(FOSSIL_COMMAND_OP_SESSION, command, -1, fossil_command_now_ns() - start, (int64_t)captured, result);
+    }
+    return result;
+} // end of func
 
-        // Wait for the child process to complete
-        waitpid(child_pid, NULL, 0);
+void fossil_command_session_set_timeout(fossil_command_session_t *session, int64_t timeout_ms) {
+    if (session) {
+        session->timeout_ms = timeout_ms > 0 ? timeout_ms : 0;
+    }
+} // end of func
 
-        return 0;  // Success
+int32_t fossil_command_session_close(fossil_command_session_t *session) {
+    if (!session) {
+        return FOSSIL_COMMAND_ERROR;
+    }
+    int32_t result = FOSSIL_COMMAND_ERROR;
+#ifndef _WIN32
+    int status = 0;
+    int32_t stopped = 0;
+    int32_t term_sent = 0;
+    close(session->in_fd);  // EOF on stdin ends the interpreter
+    close(session->out_fd);
+
+    // An interpreter that ignores EOF is stopped like a command past its timeout
+    int64_t deadline = fossil_command_now_ms() + (session->timeout_ms > 0 ? session->timeout_ms : _FOSSIL_COMMAND_DEFAULT_GRACE_MS);
+    for (;;) {
+        pid_t done = waitpid(session->pid, &status, deadline >= 0 ? WNOHANG : 0);
+        if (done == session->pid) {
+            break;
+        }
+        if (done == -1 && errno != EINTR) {
+            status = -1;
+            break;
+        }
+        int64_t now = fossil_command_now_ms();
+        if (deadline >= 0 && now >= deadline) {
+            stopped = 1;
+            if (!term_sent) {
+                kill(-session->pid, SIGTERM);
+                term_sent = 1;
+                deadline = now + _FOSSIL_COMMAND_DEFAULT_GRACE_MS;
+            } else {
+                kill(-session->pid, SIGKILL);
+                deadline = -1;
+            }
+        } else if (deadline >= 0) {
+            poll(NULL, 0, _FOSSIL_COMMAND_POLL_TICK_MS);
+        }
+    }
+    if (stopped) {
+        result = FOSSIL_COMMAND_TIMEOUT;
+    } else if (status != -1 && WIFEXITED(status)) {
+        result = WEXITSTATUS(status);
     }
 #endif
+    fossil_command_session_free(session);
+    return result;
 } // end of func
 
-// Function to check if a command exists and is executable
-int32_t fossil_command_exists(fossil_command_t process) {
+static int32_t fossil_command_is_executable(const char *path) {
 #ifdef _WIN32
-    // On Windows, check if the command exists in the system path
-    const char* env_path = getenv("PATH");
-    if (env_path != NULL) {
-        char path_copy[1024];
-        strcpy(path_copy, env_path);
+    DWORD attrs = GetFileAttributesA(path);
+    return attrs != INVALID_FILE_ATTRIBUTES && !(attrs & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat info;
+    return stat(path, &info) == 0 && S_ISREG(info.st_mode) && access(path, X_OK) == 0;
+#endif
+} // end of func
+
+static time_t fossil_command_dir_mtime(const char *dir) {
+    struct stat info;
+    return stat(dir, &info) == 0 ? info.st_mtime : (time_t)0;
+} // end of func
+
+static void fossil_command_cache_flush_locked(void) {
+    for (size_t i = 0; i < _FOSSIL_COMMAND_CACHE_SLOTS; ++i) {
+        free(fossil_command_cache.slots[i].name);
+        free(fossil_command_cache.slots[i].path);
+    }
+    memset(fossil_command_cache.slots, 0, sizeof(fossil_command_cache.slots));
+    fossil_command_cache.count = 0;
+} // end of func
+
+static void fossil_command_cache_load_path_locked(const char *env) {
+    free(fossil_command_cache.path_env);
+    free(fossil_command_cache.path_split);
+    free(fossil_command_cache.dirs);
+    fossil_command_cache.path_env = fossil_command_strdup(env);
+    fossil_command_cache.path_split = fossil_command_strdup(env);
+    fossil_command_cache.dirs = NULL;
+    fossil_command_cache.num_dirs = 0;
+
+    if (!fossil_command_cache.path_env || !fossil_command_cache.path_split) {
+        return;
+    }
+
+    size_t count = 1;
+    for (const char *p = env; *p; ++p) {
+        count += (*p == _FOSSIL_PATH_SEPARATOR[0]);
+    }
+
+    fossil_command_cache.dirs = malloc(count * sizeof(fossil_command_path_dir_t));
+    if (!fossil_command_cache.dirs) {
+        return;
+    }
+
+    // Split in place instead of strtok so the cache stays re-entrant
+    char *start = fossil_command_cache.path_split;
+    for (;;) {
+        char *end = strchr(start, _FOSSIL_PATH_SEPARATOR[0]);
+        if (end) {
+            *end = '\0';
+        }
+        fossil_command_path_dir_t *entry = &fossil_command_cache.dirs[fossil_command_cache.num_dirs++];
+        entry->dir = (*start != '\0') ? start : ".";  // empty entry means the current directory
+        entry->mtime = fossil_command_dir_mtime(entry->dir);
+        if (!end) {
+            break;
+        }
+        start = end + 1;
+    }
+} // end of func
+
+// Drop the cache when PATH changed, or when a PATH directory was modified
+static void fossil_command_cache_validate_locked(void) {
+    const char *env = getenv("PATH");
+    int64_t now = fossil_command_now_ms();
+    if (!env) {
+        env = "";
+    }
+
+    if (!fossil_command_cache.path_env || strcmp(env, fossil_command_cache.path_env) != 0) {
+        fossil_command_cache_flush_locked();
+        fossil_command_cache_load_path_locked(env);
+        fossil_command_cache.checked_ms = now;
+        return;
+    }
+
+    if (now - fossil_command_cache.checked_ms < _FOSSIL_COMMAND_CACHE_RECHECK_MS) {
+        return;
+    }
+    fossil_command_cache.checked_ms = now;
 
-        char* token = strtok(path_copy, _FOSSIL_PATH_SEPARATOR);
-        while (token != NULL) {
-            char full_path[1024];
-            snprintf(full_path, sizeof(full_path), "%s\\%s", token, process);
-            if (GetFileAttributes(full_path) != INVALID_FILE_ATTRIBUTES) {
-                printf("Command '%s' exists and is executable.\n", process);
-                return 1;
+    int32_t stale = 0;
+    for (size_t i = 0; i < fossil_command_cache.num_dirs; ++i) {
+        time_t mtime = fossil_command_dir_mtime(fossil_command_cache.dirs[i].dir);
+        if (mtime != fossil_command_cache.dirs[i].mtime) {
+            fossil_command_cache.dirs[i].mtime = mtime;
+            stale = 1;
+        }
+    }
+    if (stale) {
+        fossil_command_cache_flush_locked();
+    }
+} // end of func
+
+static int32_t fossil_command_search_path_locked(const char *name, char *found, size_t found_size) {
+    for (size_t i = 0; i < fossil_command_cache.num_dirs; ++i) {
+        int len = snprintf(found, found_size, "%s" _FOSSIL_DIR_SEPARATOR "%s", fossil_command_cache.dirs[i].dir, name);
+        if (len < 0 || (size_t)len >= found_size) {
+            continue;
+        }
+        if (fossil_command_is_executable(found)) {
+            return 1;
+        }
+#ifdef _WIN32
+        // Try the executable extensions when the name does not carry one
+        if (!strchr(name, '.')) {
+            const char *exts[] = {".exe", ".com", ".bat", ".cmd"};
+            for (size_t j = 0; j < sizeof(exts) / sizeof(exts[0]); ++j) {
+                if ((size_t)len + strlen(exts[j]) < found_size) {
+                    strcpy(found + len, exts[j]);
+                    if (fossil_command_is_executable(found)) {
+                        return 1;
+                    }
+                }
             }
-            token = strtok(NULL, _FOSSIL_PATH_SEPARATOR);
         }
+#endif
     }
-    fprintf(stderr, "Command '%s' does not exist or is not executable.\n", process);
     return 0;
-#else
-    // On Unix-like systems, use the access function
-    if (access(process, X_OK) == 0) {
-        printf("Command '%s' exists and is executable.\n", process);
+} // end of func
+
+static fossil_command_cache_entry_t *fossil_command_cache_find_locked(uint64_t hash, const char *name) {
+    size_t mask = _FOSSIL_COMMAND_CACHE_SLOTS - 1;
+    for (size_t i = (size_t)hash & mask;; i = (i + 1) & mask) {
+        fossil_command_cache_entry_t *entry = &fossil_command_cache.slots[i];
+        if (!entry->name) {
+            return entry;  // empty slot, caller may insert here
+        }
+        if (entry->hash == hash && strcmp(entry->name, name) == 0) {
+            return entry;
+        }
+    }
+} // end of func
+
+static void fossil_command_cache_insert_locked(uint64_t hash, const char *name, const char *path) {
+    // Keep the load factor under 3/4 so probing stays short
+    if (fossil_command_cache.count >= (_FOSSIL_COMMAND_CACHE_SLOTS / 4) * 3) {
+        fossil_command_cache_flush_locked();
+    }
+
+    fossil_command_cache_entry_t *entry = fossil_command_cache_find_locked(hash, name);
+    char *name_copy = fossil_command_strdup(name);
+    char *path_copy = path ? fossil_command_strdup(path) : NULL;
+    if (!name_copy || (path && !path_copy)) {
+        free(name_copy);
+        free(path_copy);
+        return;
+    }
+
+    entry->hash = hash;
+    entry->name = name_copy;
+    entry->path = path_copy;
+    fossil_command_cache.count++;
+} // end of func
+
+static int32_t fossil_command_resolve_as(fossil_command_op_t op, const char *name, char *resolved, size_t resolved_size) {
+    if (!name || name[0] == '\0') {
+        return 0;
+    }
+
+    // Explicit paths are never searched for in PATH
+    if (strchr(name, '/') || strchr(name, _FOSSIL_DIR_SEPARATOR[0])) {
+        if (!fossil_command_is_executable(name)) {
+            return 0;
+        }
+        if (resolved && resolved_size > 0) {
+            snprintf(resolved, resolved_size, "%s", name);
+        }
         return 1;
+    }
+
+    int64_t start = _FOSSIL_COMMAND_TRACING() ? fossil_command_now_ns() : -1;
+    uint64_t hash = fossil_command_hash(name);
+    int32_t found;
+
+    _FOSSIL_COMMAND_CACHE_LOCK();
+    fossil_command_cache_validate_locked();
+
+    fossil_command_cache_entry_t *entry = fossil_command_cache_find_locked(hash, name);
+    if (entry->name) {
+        found = entry->path != NULL;
+        if (found && resolved && resolved_size > 0) {
+            snprintf(resolved, resolved_size, "%s", entry->path);
+        }
     } else {
-        fprintf(stderr, "Command '%s' does not exist or is not executable.\n", process);
-        return 0;
+        char candidate[_FOSSIL_COMMAND_PATH_MAX];
+        found = fossil_command_search_path_locked(name, candidate, sizeof(candidate));
+        fossil_command_cache_insert_locked(hash, name, found ? candidate : NULL);
+        if (found && resolved && resolved_size > 0) {
+            snprintf(resolved, resolved_size, "%s", candidate);
+        }
     }
-#endif
+    _FOSSIL_COMMAND_CACHE_UNLOCK();
+
+    if (start >= 0) {
+        fossil_command_trace_record(op, name, -1, fossil_command_now_ns() - start, -1, found ? 0 : 1);
+    }
+    return found;
+} // end of func
+
+int32_t fossil_command_resolve(const char *name, char *resolved, size_t resolved_size) {
+    return fossil_command_resolve_as(FOSSIL_COMMAND_OP_RESOLVE, name, resolved, resolved_size);
+} // end of func
+
+void fossil_command_cache_clear(void) {
+    _FOSSIL_COMMAND_CACHE_LOCK();
+    fossil_command_cache_flush_locked();
+    _FOSSIL_COMMAND_CACHE_UNLOCK();
+} // end of func
+
+// Function to check if a command exists and is executable
+int32_t fossil_command_exists(fossil_command_t process) {
+    if (fossil_command_resolve_as(FOSSIL_COMMAND_OP_EXISTS, process, NULL, 0)) {
+        printf("Command '%s' exists and is executable.\n", process);
+        return 1;
+    }
+    fprintf(stderr, "Command '%s' does not exist or is not executable.\n", process);
+    return 0;
 } // end of function
 
 // Function to concatenate strings safely
@@ -27,9 +27,21 @@ typedef enum {
     COPTION_TYPE_STRING,
     COPTION_TYPE_BOOL,
     COPTION_TYPE_COMBO,
-    COPTION_TYPE_FEATURE
+    COPTION_TYPE_FEATURE,
+    COPTION_TYPE_INT64,
+    COPTION_TYPE_DOUBLE,
+    COPTION_TYPE_SIZE,     // Byte count with an optional K/M/G/T suffix (powers of 1024)
+    COPTION_TYPE_DURATION  // Time span such as "250ms" or "1h30m", stored in nanoseconds
 } fossil_option_type_t;
 
+// Results reported by the value parsers and the option table builder
+enum {
+    FOSSIL_ARG_OK = 0,
+    FOSSIL_ARG_ERROR_INVALID = -1,  // Malformed value or invalid argument
+    FOSSIL_ARG_ERROR_RANGE = -2,    // Value does not fit the option type
+    FOSSIL_ARG_ERROR_NOMEM = -3     // Allocation failed or the arena is too small
+};
+
 // Feature values
 typedef enum {
     FEATURE_ENABLE,
@@ -50,6 +62,10 @@ typedef union {
     int32_t bool_val;
     int32_t combo_val;
     fossil_option_feature_t feature_val;
+    int64_t int64_val;
+    double double_val;
+    uint64_t size_val;
+    int64_t duration_val;
 } fossil_option_value_t;
 
 // Option structure
@@ -60,6 +76,7 @@ typedef struct {
     void* extra_data; // Used for choices in COPTION_TYPE_COMBO
     int32_t num_choices;  // Used for choices in COPTION_TYPE_COMBO
     int32_t parsed;       // Flag to indicate if the option is parsed
+    const char* description;  // Help text shown by the usage output, may be NULL
 } fossil_option_t;
 
 // Command line structure
@@ -68,6 +85,65 @@ typedef struct {
     char** argv;
 } fossil_command_line_t;
 
+// Declaration of one option for fossil_arg_build_options
+typedef struct {
+    const char* name;
+    fossil_option_type_t type;
+    fossil_option_value_t value;       // Default value
+    const char* const* choice_names;   // Used for COPTION_TYPE_COMBO
+    const int32_t* choice_values;      // Used for COPTION_TYPE_COMBO
+    int32_t num_choices;
+    const char* description;           // Help text, may be NULL
+} fossil_option_spec_t;
+
+// Subcommand registry, a trie over command names. Registering and
+// dispatching may happen from several threads at once.
+typedef struct fossil_arg_commands fossil_arg_commands_t;
+
+// Handler of a subcommand. cmd holds the arguments after the command path,
+// with argv[0] set to the last command word like a program name.
+typedef int32_t (*fossil_arg_handler_t)(fossil_command_line_t* cmd, fossil_option_t* options, int32_t num_options, void* user_data);
+
+// Immutable option set built once and shared by concurrent parses
+typedef struct fossil_arg_schema fossil_arg_schema_t;
+
+// Outcome of fossil_arg_parse_into: a presence bit and a value per option
+typedef struct {
+    int32_t num_options;
+    int32_t error;                  // FOSSIL_ARG_OK or the first error of the parse
+    int32_t error_option;           // Option the error refers to, -1 when none
+    fossil_option_value_t* values;  // Schema defaults overridden by the arguments
+    uint64_t* present;              // Bit i is set when option i was given
+} fossil_arg_result_t;
+
+// Shells fossil_arg_completion_script can write for
+enum {
+    FOSSIL_ARG_SHELL_BASH = 0,
+    FOSSIL_ARG_SHELL_ZSH = 1,
+    FOSSIL_ARG_SHELL_FISH = 2,
+    FOSSIL_ARG_SHELL_DYNAMIC = 0x100  // Script asks the program's --fossil-complete mode instead of embedding the options
+};
+
+// Sorted prefix index answering completion queries for an option table
+typedef struct fossil_arg_completion fossil_arg_completion_t;
+
+// Caller-provided memory for fossil_arg_build_options
+typedef struct {
+    void* base;    // Should be aligned like memory from malloc
+    size_t size;
+    size_t used;
+} fossil_arg_arena_t;
+
+// Argument source for fossil_arg_parse_stream, returns NULL after the last argument
+typedef const char* (*fossil_arg_next_t)(void* context);
+
+// Sources read by fossil_arg_resolve, each one overrides the one before
+typedef struct {
+    const char* config_path;  // INI/TOML-style file, NULL or a missing file is skipped
+    const char* section;      // Section read besides the top-level keys, may be NULL
+    const char* env_prefix;   // Option "dry-run" reads <prefix>DRY_RUN, NULL skips the environment
+} fossil_arg_layers_t;
+
 /**
  * Print the usage information for command-line argument parsing.
  *
@@ -77,6 +153,23 @@ typedef struct {
  */
 void fossil_arg_parse_usage(const char* program_name, fossil_option_t* options, int32_t num_options);
 
+/**
+ * Render the usage text into a caller buffer: one line per option with the
+ * descriptions and defaults aligned in a second column and word wrapped.
+ * Like snprintf the result is always terminated when size is non-zero and
+ * the full length is returned, so a short buffer can be retried.
+ *
+ * @param program_name The name of the program.
+ * @param options      Array of fossil_option_t structures representing available options.
+ * @param num_options  The number of options in the array.
+ * @param width        Line width to wrap at, 0 for 80 columns.
+ * @param buffer       Destination, may be NULL when size is 0.
+ * @param size         Size of the buffer in bytes.
+ * @return             Length of the complete text, excluding the terminator.
+ */
+size_t fossil_arg_format_usage(const char* program_name, const fossil_option_t* options, int32_t num_options,
+                               int32_t width, char* buffer, size_t size);
+
 /**
  * Check if a specific option is present in the parsed command-line arguments.
  *
@@ -90,14 +183,161 @@ int32_t fossil_arg_parse_has(fossil_option_t* options, int32_t num_options, cons
 /**
  * Parse the command-line arguments based on the provided options.
  *
+ * Options are written -name value, --name value, -name=value or
+ * --name=value. Single letter options can be bundled (-vx, -j8), --no-name
+ * clears a flag or disables a feature, and "--" ends option processing.
+ *
+ * An argument of the form @file is replaced by the whitespace separated
+ * arguments stored in that file (quotes group, backslash escapes). Only
+ * arguments in option or positional position are expanded: the value of an
+ * option (--user @alice) is always taken literally. The file is mapped and
+ * split in place, so STRING values point into it until
+ * fossil_arg_release_response_files() is called.
+ *
  * @param cmd          Pointer to the fossil_command_line_t structure representing parsed command-line arguments.
  * @param options      Array of fossil_option_t structures representing available options.
  * @param num_options  The number of options in the array.
  */
 void fossil_arg_parse(fossil_command_line_t* cmd, fossil_option_t* options, int32_t num_options);
 
+/**
+ * Parse arguments pulled one at a time from a callback instead of an argv
+ * array, so large argument sets never need to be materialised. Unlike
+ * fossil_arg_parse the first argument is not skipped as a program name.
+ * Response files are expanded the same way as in fossil_arg_parse.
+ *
+ * @param next         Callback returning the next argument or NULL at the end.
+ * @param context      User pointer handed to the callback.
+ * @param options      Array of fossil_option_t structures representing available options.
+ * @param num_options  The number of options in the array.
+ */
+void fossil_arg_parse_stream(fossil_arg_next_t next, void* context, fossil_option_t* options, int32_t num_options);
+
+/**
+ * Create a schema from option declarations. The schema copies the
+ * declarations into one block and indexes the names once; it is never
+ * modified afterwards, so any number of threads can parse against it.
+ *
+ * @param specs        Array of option declarations.
+ * @param num_specs    The number of declarations.
+ * @return             The schema, or NULL if the declarations are invalid or memory runs out.
+ */
+fossil_arg_schema_t* fossil_arg_schema_create(const fossil_option_spec_t* specs, int32_t num_specs);
+
+/**
+ * Destroy a schema. No parse may be using it.
+ *
+ * @param schema       The schema, may be NULL.
+ */
+void fossil_arg_schema_free(fossil_arg_schema_t* schema);
+
+/**
+ * Position of an option in a schema, which is also its position in a result.
+ *
+ * @param schema       The schema.
+ * @param name         The option name.
+ * @return             The option index, or -1 if the schema has no such option.
+ */
+int32_t fossil_arg_schema_find(const fossil_arg_schema_t* schema, const char* name);
+
+/**
+ * Options of a schema, for usage output and the like.
+ *
+ * @param schema       The schema.
+ * @param num_options  Receives the number of options, may be NULL.
+ * @return             The read-only option table.
+ */
+const fossil_option_t* fossil_arg_schema_options(const fossil_arg_schema_t* schema, int32_t* num_options);
+
+/**
+ * Usage text of a schema, rendered once per program name and width and then
+ * served from a cache, see fossil_arg_format_usage.
+ *
+ * @param schema       The schema.
+ * @param program_name The name of the program.
+ * @param width        Line width to wrap at, 0 for 80 columns.
+ * @param buffer       Destination, may be NULL when size is 0.
+ * @param size         Size of the buffer in bytes.
+ * @return             Length of the complete text, excluding the terminator.
+ */
+size_t fossil_arg_schema_usage(const fossil_arg_schema_t* schema, const char* program_name, int32_t width, char* buffer, size_t size);
+
+/**
+ * Allocate a result sized for a schema, in a single allocation. A result
+ * can be reused for any number of parses but only by one thread at a time.
+ *
+ * @param schema       The schema.
+ * @return             The result, or NULL on allocation failure.
+ */
+fossil_arg_result_t* fossil_arg_result_create(const fossil_arg_schema_t* schema);
+
+/**
+ * Release a result.
+ *
+ * @param result       The result, may be NULL.
+ */
+void fossil_arg_result_free(fossil_arg_result_t* result);
+
+/**
+ * Check whether an option was given in the last parse into a result.
+ *
+ * @param result       The result.
+ * @param index        The option index from fossil_arg_schema_find.
+ * @return             1 if the option was given, 0 otherwise.
+ */
+int32_t fossil_arg_result_has(const fossil_arg_result_t* result, int32_t index);
+
+/**
+ * Parse a command line into a result without touching the schema, taking
+ * locks or printing. The syntax is that of fossil_arg_parse, except that
+ * @file arguments are not expanded and unknown options are errors.
+ *
+ * @param schema       The shared schema.
+ * @param cmd          The command line, argv[0] being the program name.
+ * @param result       Receives defaults, given values and presence bits.
+ * @return             FOSSIL_ARG_OK or the first error, also stored in the result.
+ */
+int32_t fossil_arg_parse_into(const fossil_arg_schema_t* schema, const fossil_command_line_t* cmd, fossil_arg_result_t* result);
+
+/**
+ * Resolve options from layered sources with a single precedence rule: the
+ * values already in the options are defaults, then the config file, then
+ * the environment, then the command line. The config file is tokenised once
+ * and cached until it changes on disk; STRING values point into it or into
+ * the environment.
+ *
+ * @param cmd          Command line applied last, may be NULL.
+ * @param options      Array of fossil_option_t structures representing available options.
+ * @param num_options  The number of options in the array.
+ * @param layers       Config file and environment settings, may be NULL.
+ * @return             FOSSIL_ARG_OK, or the error of the first bad config or environment value.
+ */
+int32_t fossil_arg_resolve(fossil_command_line_t* cmd, fossil_option_t* options, int32_t num_options, const fossil_arg_layers_t* layers);
+
+/**
+ * Release every response and config file loaded by the parser. STRING
+ * values taken from those files are no longer valid afterwards.
+ */
+void fossil_arg_release_response_files(void);
+
+/**
+ * Convert the text of an option value according to the option type.
+ *
+ * Numbers are parsed without consulting the locale and are checked for
+ * overflow. Booleans accept true/false, yes/no, on/off and 1/0, COMBO values
+ * are matched against the option choices and STRING values point at text.
+ *
+ * @param option The option the value belongs to.
+ * @param text   The NUL-terminated text to convert.
+ * @param value  Where to store the converted value.
+ * @return       FOSSIL_ARG_OK, FOSSIL_ARG_ERROR_INVALID or FOSSIL_ARG_ERROR_RANGE.
+ */
+int32_t fossil_arg_parse_value(const fossil_option_t* option, const char* text, fossil_option_value_t* value);
+
 /**
  * Check for unrecognized command-line arguments and print an error message if found.
+ * Response files are expanded as in fossil_arg_parse, so the options they
+ * hold are checked too.
  *
  * @param cmd          Pointer to the fossil_command_line_t structure representing parsed command-line arguments.
  * @param options      Array of fossil_option_t structures representing available options.
@@ -121,28 +361,189 @@ void fossil_arg_print_parsed_options(fossil_option_t* options, int32_t num_optio
  */
 void fossil_arg_reset_parsed_flags(fossil_option_t* options, int32_t num_options);
 
+/**
+ * Upper bound of the bytes fossil_arg_build_options needs for a table,
+ * including the padding an arena may insert to align its start.
+ *
+ * @param specs        Array of option declarations.
+ * @param num_options  The number of declarations in the array.
+ * @return             Size in bytes, 0 if the declarations are invalid.
+ */
+size_t fossil_arg_options_size(const fossil_option_spec_t* specs, int32_t num_options);
+
+/**
+ * Build an option table in one contiguous block: the fossil_option_t array,
+ * then the combo choices, then copies of every name, so the table does not
+ * reference the declarations afterwards. The block comes from the arena
+ * when one is given, otherwise from a single allocation that is released
+ * with fossil_arg_free_options.
+ *
+ * @param specs        Array of option declarations.
+ * @param num_options  The number of declarations in the array.
+ * @param arena        Memory to carve the block from, or NULL to allocate it.
+ * @param options      Receives the option table.
+ * @return             FOSSIL_ARG_OK, FOSSIL_ARG_ERROR_INVALID or FOSSIL_ARG_ERROR_NOMEM.
+ */
+int32_t fossil_arg_build_options(const fossil_option_spec_t* specs, int32_t num_options, fossil_arg_arena_t* arena, fossil_option_t** options);
+
+/**
+ * Release an option table allocated by fossil_arg_build_options,
+ * fossil_arg_create_options, fossil_arg_create_combo_options or
+ * fossil_arg_create_fossil_combo_choice_ts.
+ * Tables built in an arena are released with the arena.
+ *
+ * @param options      The table to release, may be NULL.
+ */
+void fossil_arg_free_options(void* options);
+
+/**
+ * Generate a completion script for a program. Static scripts embed every
+ * option, COMBO choice and FEATURE value; with FOSSIL_ARG_SHELL_DYNAMIC the
+ * script instead runs `program --fossil-complete <previous> <current>`,
+ * which fossil_arg_completion_request answers.
+ *
+ * @param program_name Name the program is invoked by, letters, digits, '.', '_' and '-' only.
+ * @param options      Array of fossil_option_t structures representing available options.
+ * @param num_options  The number of options in the array.
+ * @param shell        FOSSIL_ARG_SHELL_BASH, _ZSH or _FISH, optionally with FOSSIL_ARG_SHELL_DYNAMIC.
+ * @param buffer       Destination, may be NULL when size is 0.
+ * @param size         Size of the buffer in bytes.
+ * @return             Length of the complete script, 0 for an unknown shell or unsafe program name.
+ */
+size_t fossil_arg_completion_script(const char* program_name, const fossil_option_t* options, int32_t num_options,
+                                    int32_t shell, char* buffer, size_t size);
+
+/**
+ * Build the completion index of an option table. The index refers to the
+ * names and choices of the table, which must outlive it.
+ *
+ * @param options      Array of fossil_option_t structures representing available options.
+ * @param num_options  The number of options in the array.
+ * @return             The index, or NULL on allocation failure.
+ */
+fossil_arg_completion_t* fossil_arg_completion_create(const fossil_option_t* options, int32_t num_options);
+
+/**
+ * Destroy a completion index.
+ *
+ * @param completion   The index, may be NULL.
+ */
+void fossil_arg_completion_free(fossil_arg_completion_t* completion);
+
+/**
+ * Complete the word being typed. After an option that takes a COMBO or
+ * FEATURE value the matching values are offered, otherwise the options
+ * whose name starts with the word, found by binary search.
+ *
+ * @param completion   The index.
+ * @param previous     The word before the cursor, may be NULL.
+ * @param current      The partial word at the cursor, may be NULL.
+ * @param buffer       Receives the candidates, one per line.
+ * @param size         Size of the buffer in bytes.
+ * @return             Length of the complete candidate list.
+ */
+size_t fossil_arg_complete(const fossil_arg_completion_t* completion, const char* previous, const char* current,
+                           char* buffer, size_t size);
+
+/**
+ * Fast path for dynamic completion scripts, meant to be called first thing
+ * in main. When argv[1] is --fossil-complete the candidates for argv[2]
+ * (previous word) and argv[3] (current word) are written to stdout.
+ *
+ * @param completion   The index.
+ * @param cmd          The program's command line.
+ * @return             1 if the request was answered and the program should exit, 0 otherwise.
+ */
+int32_t fossil_arg_completion_request(const fossil_arg_completion_t* completion, const fossil_command_line_t* cmd);
+
+/**
+ * Create an empty subcommand registry.
+ *
+ * @return             The registry, or NULL on allocation failure.
+ */
+fossil_arg_commands_t* fossil_arg_commands_create(void);
+
+/**
+ * Register a subcommand. The path is a space separated list of words, so
+ * "remote add" is reached by `tool remote add`; an empty path is the
+ * handler used when no subcommand is given. The option declarations are
+ * only turned into a table the first time the command is dispatched, and
+ * must stay valid until then.
+ *
+ * @param commands     The registry.
+ * @param path         Command words separated by spaces.
+ * @param handler      Function called when the command is dispatched.
+ * @param specs        Option declarations of the command, may be NULL.
+ * @param num_specs    The number of declarations.
+ * @param user_data    Pointer handed to the handler.
+ * @return             FOSSIL_ARG_OK, FOSSIL_ARG_ERROR_INVALID for a duplicate or empty command, or FOSSIL_ARG_ERROR_NOMEM.
+ */
+int32_t fossil_arg_commands_register(fossil_arg_commands_t* commands, const char* path, fossil_arg_handler_t handler,
+                                     const fossil_option_spec_t* specs, int32_t num_specs, void* user_data);
+
+/**
+ * Route a command line to the deepest registered command matching its
+ * leading words, walking the trie one character at a time. The command's
+ * options are parsed from the remaining arguments before the handler runs,
+ * every dispatch starting again from the declared defaults.
+ *
+ * Threading: the lookup holds the registry's lock, so concurrent dispatches
+ * and registrations are safe. Each call parses into its own copy of the
+ * option table, which the handler receives and which is valid only for the
+ * duration of the call; handlers run unlocked and may dispatch or register.
+ *
+ * @param commands     The registry.
+ * @param cmd          The full command line, argv[0] being the program name.
+ * @return             The handler's result, FOSSIL_ARG_ERROR_INVALID if no command matches, or FOSSIL_ARG_ERROR_NOMEM.
+ */
+int32_t fossil_arg_commands_dispatch(fossil_arg_commands_t* commands, fossil_command_line_t* cmd);
+
+/**
+ * Destroy a registry along with the option tables it built.
+ *
+ * @param commands     The registry, may be NULL.
+ */
+void fossil_arg_commands_free(fossil_arg_commands_t* commands);
+
 /**
  * Create an array of fossil_combo_choice_t structures for combo-box style options.
  *
  * @param names        Array of names for the combo choices.
  * @param values       Array of values associated with each choice.
  * @param num_choices  The number of combo choices in the arrays.
- * @return             Pointer to the created array of fossil_combo_choice_t structures.
+ * @return             Pointer to the created array, terminated by a choice with a NULL name, or NULL on allocation failure.
  */
 fossil_combo_choice_t* fossil_arg_create_fossil_combo_choice_ts(const char* names[], const int32_t values[], int32_t num_choices);
 
 /**
  * Create an array of fossil_option_t structures for command-line argument parsing.
+ * COMBO options get no choices; use fossil_arg_create_combo_options or
+ * fossil_arg_build_options for those.
  *
  * @param names        Array of names for the options.
  * @param types        Array of fossil_option_type_t indicating the types of the options.
  * @param values       Array of fossil_option_value_t representing default values for the options.
  * @param extra_data   Array of pointers to extra data associated with each option (can be NULL).
  * @param num_options  The number of options in the arrays.
- * @return             Pointer to the created array of fossil_option_t structures.
+ * @return             Pointer to the created array of fossil_option_t structures, or NULL on allocation failure.
  */
 fossil_option_t* fossil_arg_create_options(const char* names[], fossil_option_type_t types[], fossil_option_value_t values[], void* extra_data[], int32_t num_options);
 
+/**
+ * Create an array of fossil_option_t structures like fossil_arg_create_options,
+ * with the choice count of every COMBO option given explicitly.
+ *
+ * @param names        Array of names for the options.
+ * @param types        Array of fossil_option_type_t indicating the types of the options.
+ * @param values       Array of fossil_option_value_t representing default values for the options.
+ * @param extra_data   Array of pointers to extra data associated with each option (can be NULL).
+ * @param num_choices  Number of choices in the extra data of each COMBO option (can be NULL,
+ *                     leaving every COMBO without choices). Other entries are ignored.
+ * @param num_options  The number of options in the arrays.
+ * @return             Pointer to the created array of fossil_option_t structures, or NULL on allocation failure.
+ */
+fossil_option_t* fossil_arg_create_combo_options(const char* names[], fossil_option_type_t types[], fossil_option_value_t values[], void* extra_data[], const int32_t num_choices[], int32_t num_options);
+
 #ifdef __cplusplus
 }
 #endif
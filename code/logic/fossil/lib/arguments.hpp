@@ -0,0 +1,474 @@
+/*
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop high-
+ * performance, cross-platform applications and libraries. The code contained
+ * herein is subject to the terms and conditions defined in the project license.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ *
+ * Copyright (C) 2024 Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef FOSSIL_LIB_ARGS_HPP
+#define FOSSIL_LIB_ARGS_HPP
+
+#include "arguments.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace fossil::lib {
+
+// Option declaration usable in a constexpr table
+struct option_spec {
+    const char* name;
+    fossil_option_type_t type;
+    fossil_option_value_t value{};                     // Default value
+    const fossil_combo_choice_t* choices = nullptr;    // Used for COPTION_TYPE_COMBO
+    int32_t num_choices = 0;
+    const char* description = nullptr;
+};
+
+// Reasons a parse stopped early
+enum class parse_error {
+    none,
+    unknown_option,
+    missing_value,
+    bad_value
+};
+
+namespace detail {
+
+constexpr std::size_t length(const char* str) noexcept {
+    std::size_t len = 0;
+    while (str[len] != '\0') {
+        ++len;
+    }
+    return len;
+}
+
+constexpr bool equals(const char* a, const char* b, std::size_t len) noexcept {
+    for (std::size_t i = 0; i < len; ++i) {
+        if (a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr uint64_t fnv1a(const char* str, std::size_t len) noexcept {
+    uint64_t hash = 14695981039346656037ULL;
+    for (std::size_t i = 0; i < len; ++i) {
+        hash ^= static_cast<unsigned char>(str[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Final mixer of MurmurHash3, spreads a displaced hash over every slot bit
+constexpr uint64_t mix(uint64_t hash, uint32_t displacement) noexcept {
+    hash += (static_cast<uint64_t>(displacement) + 1) * 0x9E3779B97F4A7C15ULL;
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+constexpr std::size_t slot_count(std::size_t n) noexcept {
+    std::size_t slots = 1;
+    while (slots < n) {
+        slots <<= 1;
+    }
+    return slots;
+}
+
+// String literal usable as a template argument, for get<"name">()
+template <std::size_t N>
+struct fixed_string {
+    char text[N]{};
+
+    consteval fixed_string(const char (&str)[N]) {
+        for (std::size_t i = 0; i < N; ++i) {
+            text[i] = str[i];
+        }
+    }
+};
+
+template <fossil_option_type_t Type>
+struct option_traits;
+
+template <>
+struct option_traits<COPTION_TYPE_INT> {
+    using type = int32_t;
+    static constexpr type get(const fossil_option_value_t& v) noexcept { return v.int_val; }
+};
+
+template <>
+struct option_traits<COPTION_TYPE_STRING> {
+    using type = const char*;
+    static constexpr type get(const fossil_option_value_t& v) noexcept { return v.str_val; }
+};
+
+template <>
+struct option_traits<COPTION_TYPE_BOOL> {
+    using type = bool;
+    static constexpr type get(const fossil_option_value_t& v) noexcept { return v.bool_val != 0; }
+};
+
+template <>
+struct option_traits<COPTION_TYPE_COMBO> {
+    using type = int32_t;
+    static constexpr type get(const fossil_option_value_t& v) noexcept { return v.combo_val; }
+};
+
+template <>
+struct option_traits<COPTION_TYPE_FEATURE> {
+    using type = fossil_option_feature_t;
+    static constexpr type get(const fossil_option_value_t& v) noexcept { return v.feature_val; }
+};
+
+template <>
+struct option_traits<COPTION_TYPE_INT64> {
+    using type = int64_t;
+    static constexpr type get(const fossil_option_value_t& v) noexcept { return v.int64_val; }
+};
+
+template <>
+struct option_traits<COPTION_TYPE_DOUBLE> {
+    using type = double;
+    static constexpr type get(const fossil_option_value_t& v) noexcept { return v.double_val; }
+};
+
+template <>
+struct option_traits<COPTION_TYPE_SIZE> {
+    using type = uint64_t;
+    static constexpr type get(const fossil_option_value_t& v) noexcept { return v.size_val; }
+};
+
+template <>
+struct option_traits<COPTION_TYPE_DURATION> {
+    using type = int64_t;   // Nanoseconds
+    static constexpr type get(const fossil_option_value_t& v) noexcept { return v.duration_val; }
+};
+
+} // namespace detail
+
+/**
+ * Option table with a perfect hash computed at compile time.
+ *
+ * Names are split into buckets by hash and every bucket gets a displacement
+ * chosen so that all names land in distinct slots (hash and displace), so a
+ * lookup is one hash, one slot read and one name comparison.
+ */
+template <std::size_t N>
+struct option_schema {
+    static_assert(N > 0, "an option schema needs at least one option");
+
+    static constexpr std::size_t num_options = N;
+    static constexpr std::size_t num_slots = detail::slot_count(N);
+    static constexpr std::size_t num_buckets = N / 2 + 1;
+
+    std::array<option_spec, N> options{};
+    std::array<std::size_t, N> lengths{};
+    std::array<uint64_t, N> hashes{};
+    std::array<uint32_t, num_buckets> displacements{};
+    std::array<int32_t, num_slots> slots{};
+
+    constexpr int32_t find(const char* name, std::size_t len) const noexcept {
+        uint64_t hash = detail::fnv1a(name, len);
+        uint32_t displacement = displacements[hash % num_buckets];
+        int32_t index = slots[detail::mix(hash, displacement) & (num_slots - 1)];
+        if (index < 0 || hashes[index] != hash || lengths[index] != len || !detail::equals(options[index].name, name, len)) {
+            return -1;
+        }
+        return index;
+    }
+
+    template <detail::fixed_string Name>
+    consteval std::size_t index() const {
+        constexpr std::size_t len = sizeof(Name.text) - 1;
+        for (std::size_t i = 0; i < N; ++i) {
+            if (lengths[i] == len && detail::equals(options[i].name, Name.text, len)) {
+                return i;
+            }
+        }
+        throw "unknown option name";
+    }
+
+    // Plain C view of the table, for fossil_arg_parse_usage and friends
+    std::array<fossil_option_t, N> to_options() const noexcept {
+        std::array<fossil_option_t, N> out{};
+        for (std::size_t i = 0; i < N; ++i) {
+            out[i].name = options[i].name;
+            out[i].type = options[i].type;
+            out[i].value = options[i].value;
+            out[i].extra_data = const_cast<fossil_combo_choice_t*>(options[i].choices);
+            out[i].num_choices = options[i].num_choices;
+            out[i].parsed = 0;
+            out[i].description = options[i].description;
+        }
+        return out;
+    }
+};
+
+/**
+ * Build an option schema and its perfect hash at compile time.
+ *
+ * Duplicate names are rejected during compilation.
+ */
+template <std::size_t N>
+consteval option_schema<N> make_schema(const option_spec (&specs)[N]) {
+    using schema_t = option_schema<N>;
+    schema_t schema{};
+    std::array<std::size_t, N> bucket_of{};
+    std::array<std::size_t, schema_t::num_buckets> bucket_size{};
+    std::array<bool, schema_t::num_buckets> placed{};
+
+    for (std::size_t i = 0; i < N; ++i) {
+        schema.options[i] = specs[i];
+        schema.lengths[i] = detail::length(specs[i].name);
+        schema.hashes[i] = detail::fnv1a(specs[i].name, schema.lengths[i]);
+        bucket_of[i] = schema.hashes[i] % schema_t::num_buckets;
+        ++bucket_size[bucket_of[i]];
+        for (std::size_t j = 0; j < i; ++j) {
+            if (schema.lengths[j] == schema.lengths[i] && detail::equals(specs[j].name, specs[i].name, schema.lengths[i])) {
+                throw "duplicate option name";
+            }
+        }
+    }
+    for (auto& slot : schema.slots) {
+        slot = -1;
+    }
+
+    // Place the largest buckets first while the table is still empty
+    for (std::size_t round = 0; round < schema_t::num_buckets; ++round) {
+        std::size_t bucket = schema_t::num_buckets;
+        for (std::size_t b = 0; b < schema_t::num_buckets; ++b) {
+            if (!placed[b] && (bucket == schema_t::num_buckets || bucket_size[b] > bucket_size[bucket])) {
+                bucket = b;
+            }
+        }
+        placed[bucket] = true;
+        if (bucket_size[bucket] == 0) {
+            continue;
+        }
+
+        for (uint32_t displacement = 0;; ++displacement) {
+            if (displacement == (1u << 20)) {
+                throw "no perfect hash found for the option names";
+            }
+            std::array<std::size_t, N> taken{};
+            std::size_t count = 0;
+            bool fits = true;
+            for (std::size_t i = 0; i < N && fits; ++i) {
+                if (bucket_of[i] != bucket) {
+                    continue;
+                }
+                std::size_t slot = detail::mix(schema.hashes[i], displacement) & (schema_t::num_slots - 1);
+                fits = schema.slots[slot] == -1;
+                for (std::size_t k = 0; k < count && fits; ++k) {
+                    fits = taken[k] != slot;
+                }
+                taken[count++] = slot;
+            }
+            if (!fits) {
+                continue;
+            }
+
+            count = 0;
+            for (std::size_t i = 0; i < N; ++i) {
+                if (bucket_of[i] == bucket) {
+                    schema.slots[taken[count++]] = static_cast<int32_t>(i);
+                }
+            }
+            schema.displacements[bucket] = displacement;
+            break;
+        }
+    }
+    return schema;
+}
+
+/**
+ * Result of parsing a command line against a compile-time schema.
+ *
+ * Values live inline next to a bitset of parsed options, string values point
+ * into argv, so parsing never touches the heap.
+ */
+template <const auto& Schema>
+class parsed_options {
+public:
+    static constexpr std::size_t num_options = Schema.num_options;
+
+    constexpr parsed_options() noexcept {
+        for (std::size_t i = 0; i < num_options; ++i) {
+            values_[i] = Schema.options[i].value;
+        }
+    }
+
+    // Typed value of an option, defaulted when it was not given
+    template <detail::fixed_string Name>
+    constexpr auto get() const noexcept {
+        constexpr std::size_t index = Schema.template index<Name>();
+        return detail::option_traits<Schema.options[index].type>::get(values_[index]);
+    }
+
+    template <detail::fixed_string Name>
+    constexpr bool has() const noexcept {
+        constexpr std::size_t index = Schema.template index<Name>();
+        return is_parsed(index);
+    }
+
+    constexpr bool is_parsed(std::size_t index) const noexcept {
+        return (parsed_[index / 64] >> (index % 64)) & 1u;
+    }
+
+    constexpr parse_error error() const noexcept { return error_; }
+    constexpr int error_index() const noexcept { return error_index_; }
+    constexpr explicit operator bool() const noexcept { return error_ == parse_error::none; }
+
+    /**
+     * Parse a command line with the grammar of fossil_arg_parse, argv[0] is
+     * skipped: -name value, --name value, -name=value, --name=value,
+     * --no-name for flags and features, bundled single letter options
+     * (-abc, -j8, -j 8) and "--" ending the options.
+     *
+     * Parsing stops at the first error, which is reported through error()
+     * together with the position of the offending argument.
+     */
+    static parsed_options parse(int argc, char** argv) noexcept {
+        parsed_options result;
+        for (int i = 1; i < argc; ++i) {
+            const char* arg = argv[i];
+            if (arg[0] != '-' || arg[1] == '\0') {
+                continue;  // positional, or a lone "-"
+            }
+            const bool is_long = arg[1] == '-';
+            if (is_long && arg[2] == '\0') {
+                break;  // "--", everything after it is positional
+            }
+
+            const char* name = arg + 1 + is_long;
+            std::size_t len = detail::length(name);
+            std::size_t name_len = 0;
+            while (name_len < len && name[name_len] != '=') {
+                ++name_len;
+            }
+            const char* inline_value = name_len < len ? name + name_len + 1 : nullptr;
+
+            int32_t index = Schema.find(name, name_len);
+            if (index >= 0) {
+                // Flags take no value unless given with '='
+                if (Schema.options[index].type == COPTION_TYPE_BOOL && !inline_value) {
+                    result.values_[index].bool_val = 1;
+                    result.mark(index);
+                } else if (!result.take(index, inline_value, argc, argv, i)) {
+                    return result;
+                }
+                continue;
+            }
+
+            if (is_long && !inline_value && name_len > 3 && detail::equals(name, "no-", 3)) {
+                index = Schema.find(name + 3, name_len - 3);
+                if (index >= 0 && Schema.options[index].type == COPTION_TYPE_BOOL) {
+                    result.values_[index].bool_val = 0;
+                    result.mark(index);
+                    continue;
+                }
+                if (index >= 0 && Schema.options[index].type == COPTION_TYPE_FEATURE) {
+                    result.values_[index].feature_val = FEATURE_DISABLE;
+                    result.mark(index);
+                    continue;
+                }
+            }
+
+            if (!is_long && len > 1 && Schema.find(name, 1) >= 0) {
+                // Flags until the first option that takes a value, which gets
+                // the rest of the argument or the next argument
+                for (const char* p = name; *p; ++p) {
+                    int32_t flag = Schema.find(p, 1);
+                    if (flag < 0) {
+                        return result.fail(parse_error::unknown_option, i);
+                    }
+                    if (Schema.options[flag].type == COPTION_TYPE_BOOL) {
+                        result.values_[flag].bool_val = 1;
+                        result.mark(flag);
+                        continue;
+                    }
+                    if (!result.take(flag, p[1] ? p + 1 : nullptr, argc, argv, i)) {
+                        return result;
+                    }
+                    break;
+                }
+                continue;
+            }
+            return result.fail(parse_error::unknown_option, i);
+        }
+        return result;
+    }
+
+private:
+    constexpr void mark(int32_t index) noexcept {
+        parsed_[index / 64] |= uint64_t{1} << (index % 64);
+    }
+
+    // Store the inline value, or the next argument when there is none
+    bool take(int32_t index, const char* text, int argc, char** argv, int& i) noexcept {
+        if (!text) {
+            if (i + 1 >= argc) {
+                fail(parse_error::missing_value, i);
+                return false;
+            }
+            text = argv[++i];
+        }
+        if (!assign(Schema.options[index], text, values_[index])) {
+            fail(parse_error::bad_value, i);
+            return false;
+        }
+        mark(index);
+        return true;
+    }
+
+    static bool assign(const option_spec& spec, const char* text, fossil_option_value_t& value) noexcept {
+        if (spec.type == COPTION_TYPE_STRING) {
+            value.str_val = const_cast<char*>(text);
+            return true;
+        }
+        fossil_option_t option{};
+        option.type = spec.type;
+        option.extra_data = const_cast<fossil_combo_choice_t*>(spec.choices);
+        option.num_choices = spec.num_choices;
+        return fossil_arg_parse_value(&option, text, &value) == FOSSIL_ARG_OK;
+    }
+
+    parsed_options fail(parse_error error, int index) noexcept {
+        error_ = error;
+        error_index_ = index;
+        return *this;
+    }
+
+    std::array<fossil_option_value_t, num_options> values_{};
+    std::array<uint64_t, (num_options + 63) / 64> parsed_{};
+    parse_error error_ = parse_error::none;
+    int error_index_ = 0;
+};
+
+/**
+ * Parse a command line against a compile-time schema.
+ *
+ * @param argc Number of arguments.
+ * @param argv Argument vector, argv[0] is the program name.
+ * @return     The parsed values; check error() or operator bool for failures.
+ */
+template <const auto& Schema>
+parsed_options<Schema> parse(int argc, char** argv) noexcept {
+    return parsed_options<Schema>::parse(argc, argv);
+}
+
+} // namespace fossil::lib
+
+#endif /* FOSSIL_LIB_ARGS_HPP */
@@ -16,6 +16,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -24,6 +25,61 @@ extern "C" {
 // Define a typedef for char* to make the code more readable
 typedef char* fossil_command_t;
 
+// Results reported by the limited command runners besides the exit status
+enum {
+    FOSSIL_COMMAND_ERROR     = -1,
+    FOSSIL_COMMAND_TIMEOUT   = -2,
+    FOSSIL_COMMAND_CANCELLED = -3
+};
+
+// Deadline, cancellation and resource limits applied to a spawned command
+typedef struct {
+    int64_t timeout_ms;              // Kill the command after this long, 0 for no deadline
+    int64_t kill_grace_ms;           // Delay between SIGTERM and SIGKILL once the deadline passed
+    int64_t cpu_limit_sec;           // RLIMIT_CPU for the child, 0 for unlimited
+    int64_t memory_limit_bytes;      // RLIMIT_AS for the child, 0 for unlimited
+    const char *cgroup_path;         // Existing cgroup v2 directory to run the child in (can be NULL)
+    const volatile int32_t *cancel;  // Set to non-zero from another thread to stop the command (can be NULL)
+} fossil_command_limits_t;
+
+// Long-lived interpreter that runs many commands without a fork+exec each
+typedef struct fossil_command_session fossil_command_session_t;
+
+// Metrics recorded for every traced command
+typedef enum {
+    FOSSIL_COMMAND_TRACE_SPAWN,      // Time until the child process was started, in nanoseconds
+    FOSSIL_COMMAND_TRACE_RUN,        // Wall time of the whole call, in nanoseconds
+    FOSSIL_COMMAND_TRACE_BYTES,      // Bytes of output captured
+    FOSSIL_COMMAND_TRACE_METRICS
+} fossil_command_trace_metric_t;
+
+// Output formats for fossil_command_trace_dump
+typedef enum {
+    FOSSIL_COMMAND_TRACE_JSON,
+    FOSSIL_COMMAND_TRACE_CSV
+} fossil_command_trace_format_t;
+
+// Summary of one metric histogram
+typedef struct {
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+} fossil_command_trace_stats_t;
+
+// Snapshot of everything recorded for one operation and tool name
+typedef struct {
+    char operation[16];              // "command", "output", "exists", "session", "pipeline", "resolve" or "dropped"
+    char name[64];                   // First word of the command line
+    uint64_t calls;
+    uint64_t failures;               // Calls that did not finish with status 0
+    int32_t last_status;
+    fossil_command_trace_stats_t metrics[FOSSIL_COMMAND_TRACE_METRICS];
+} fossil_command_trace_entry_t;
+
 /**
  * Execute a command and return the result.
  *
@@ -50,6 +106,112 @@ int32_t fossil_command_success(fossil_command_t process);
  */
 int32_t fossil_command_output(fossil_command_t process, char * output, size_t output_size);
 
+/**
+ * Execute a command under a deadline and resource limits.
+ *
+ * The command runs in its own process group. When the deadline passes or the
+ * cancel flag is raised the group gets SIGTERM, followed by SIGKILL once the
+ * grace period is over. Limits are only enforced on POSIX systems.
+ *
+ * @param process The command to be executed.
+ * @param limits  The limits to apply (can be NULL for none).
+ * @return        The exit status of the command, FOSSIL_COMMAND_TIMEOUT,
+ *                FOSSIL_COMMAND_CANCELLED or FOSSIL_COMMAND_ERROR.
+ */
+int32_t fossil_command_ex(fossil_command_t process, const fossil_command_limits_t *limits);
+
+/**
+ * Retrieve the output of a command executed under a deadline and resource limits.
+ *
+ * Output that does not fit in the buffer is drained and discarded so the
+ * child never blocks on a full pipe.
+ *
+ * @param process     The command to retrieve output from.
+ * @param output      Buffer to store the output.
+ * @param output_size Size of the output buffer.
+ * @param limits      The limits to apply (can be NULL for none).
+ * @return            The exit status of the command, FOSSIL_COMMAND_TIMEOUT,
+ *                    FOSSIL_COMMAND_CANCELLED or FOSSIL_COMMAND_ERROR.
+ */
+int32_t fossil_command_output_ex(fossil_command_t process, char * output, size_t output_size, const fossil_command_limits_t *limits);
+
+/**
+ * Run a pipeline of commands (stage1 | stage2 | ...) without a shell.
+ *
+ * Every stage is a NULL-terminated argv vector whose first element is looked
+ * up through fossil_command_resolve. The stages are connected with
+ * close-on-exec pipes and started with posix_spawn, so no shell is involved
+ * and no argument needs quoting.
+ *
+ * @param stages      Array of NULL-terminated argv vectors, one per stage.
+ * @param num_stages  The number of stages.
+ * @param output      Buffer to store the output of the last stage (can be NULL
+ *                    to leave its stdout untouched).
+ * @param output_size Size of the output buffer.
+ * @param statuses    Array receiving the exit status of every stage (can be NULL).
+ * @param pipe_size   Capacity requested for the pipes between stages, 0 keeps
+ *                    the system default (Linux only).
+ * @return            The exit status of the last stage, or FOSSIL_COMMAND_ERROR.
+ */
+int32_t fossil_command_pipeline(const char *const *stages[], int32_t num_stages, char * output, size_t output_size, int32_t *statuses, size_t pipe_size);
+
+/**
+ * Start a persistent interpreter session.
+ *
+ * Commands written to the session are followed by a sentinel line which makes
+ * the interpreter print a per-command marker and the exit status, so the
+ * output of each command can be framed without restarting the interpreter.
+ * Commands must be complete statements and must not read from stdin.
+ *
+ * The sentinel line is sentinel_prefix, the marker and sentinel_suffix written
+ * verbatim; run by the interpreter it must print the marker, ':', the status
+ * of the previous command and a newline. Passing NULL for both gives
+ * `printf '<marker>:%d\n' "$?"` for POSIX sh.
+ *
+ * @param interpreter     The interpreter to run (NULL for "/bin/sh").
+ * @param sentinel_prefix Text written before the marker (NULL for POSIX sh).
+ * @param sentinel_suffix Text written after the marker (NULL for POSIX sh).
+ * @return                The session, or NULL on failure.
+ */
+fossil_command_session_t *fossil_command_session_open(const char *interpreter, const char *sentinel_prefix, const char *sentinel_suffix);
+
+/**
+ * Bound how long a session waits for each command and for the interpreter to exit.
+ *
+ * A command still running at the deadline makes fossil_command_session_run
+ * return FOSSIL_COMMAND_TIMEOUT with the output read so far; the interpreter
+ * and everything it started are killed and the session can only be closed.
+ *
+ * @param session    The session.
+ * @param timeout_ms Deadline in milliseconds, 0 for none (the default).
+ */
+void fossil_command_session_set_timeout(fossil_command_session_t *session, int64_t timeout_ms);
+
+/**
+ * Run a command in a persistent interpreter session.
+ *
+ * @param session     The session to run the command in.
+ * @param command     The command to be executed.
+ * @param output      Buffer to store the output (can be NULL to discard it).
+ * @param output_size Size of the output buffer.
+ * @return            The exit status of the command, FOSSIL_COMMAND_TIMEOUT past
+ *                    the session timeout, or FOSSIL_COMMAND_ERROR if the
+ *                    interpreter went away.
+ */
+int32_t fossil_command_session_run(fossil_command_session_t *session, const char *command, char *output, size_t output_size);
+
+/**
+ * Stop the interpreter and release a persistent session.
+ *
+ * An interpreter still running after the session timeout, or 2 seconds when
+ * none was set, gets SIGTERM and then SIGKILL.
+ *
+ * @param session The session to close (can be NULL).
+ * @return        The exit status of the interpreter, or FOSSIL_COMMAND_TIMEOUT
+ *                if it had to be killed.
+ */
+int32_t fossil_command_session_close(fossil_command_session_t *session);
+
 /**
  * Check if a command exists.
  *
@@ -58,6 +220,26 @@ int32_t fossil_command_output(fossil_command_t process, char * output, size_t ou
  */
 int32_t fossil_command_exists(fossil_command_t process);
 
+/**
+ * Resolve a command name to the full path of the executable.
+ *
+ * Names containing a path separator are checked directly, other names are
+ * searched for in every directory listed in PATH. Lookups are memoised in a
+ * process-wide cache which is dropped whenever PATH changes or one of the
+ * PATH directories is modified, so repeated lookups cost a single hash probe.
+ *
+ * @param name          The command name to resolve.
+ * @param resolved      Buffer to store the resolved path (can be NULL).
+ * @param resolved_size Size of the resolved buffer.
+ * @return              1 if the command was found, 0 otherwise.
+ */
+int32_t fossil_command_resolve(const char *name, char *resolved, size_t resolved_size);
+
+/**
+ * Drop every entry from the command resolution cache.
+ */
+void fossil_command_cache_clear(void);
+
 /**
  * Erase a command and check if it exists.
  *
@@ -66,6 +248,44 @@ int32_t fossil_command_exists(fossil_command_t process);
  */
 int32_t fossil_command_erase_exists(fossil_command_t path);
 
+/**
+ * Enable or disable the built-in command tracing.
+ *
+ * While enabled, every call of the command module records its latency,
+ * captured bytes and exit status into lock-free log-linear histograms keyed
+ * by operation and tool name. Tracing is disabled by default.
+ *
+ * @param enable Non-zero to enable tracing, 0 to disable it.
+ */
+void fossil_command_trace_enable(int32_t enable);
+
+/**
+ * Copy the current trace data into a caller buffer.
+ *
+ * The tracer keeps a fixed number of operation and tool slots. Samples that
+ * find the table full are counted instead, and reported as a final entry
+ * with operation "dropped" whose calls field holds the number of lost samples.
+ *
+ * @param entries     Array to store the entries in.
+ * @param max_entries Number of entries the array can hold.
+ * @return            The number of traced entries, which may exceed max_entries.
+ */
+size_t fossil_command_trace_snapshot(fossil_command_trace_entry_t *entries, size_t max_entries);
+
+/**
+ * Write the current trace data to a stream.
+ *
+ * @param stream The stream to write to.
+ * @param format FOSSIL_COMMAND_TRACE_JSON or FOSSIL_COMMAND_TRACE_CSV.
+ * @return       0 on success, -1 on failure.
+ */
+int32_t fossil_command_trace_dump(FILE *stream, fossil_command_trace_format_t format);
+
+/**
+ * Discard all recorded trace data.
+ */
+void fossil_command_trace_reset(void);
+
 /**
  * Safely concatenate two strings into a destination buffer.
  *
@@ -23,17 +23,193 @@ extern "C" {
 #endif
 
 enum {
-    _FOSSIL_HOSTSYS_SIZE = 256
+    _FOSSIL_HOSTSYS_SIZE = 256,
+    _FOSSIL_HOSTSYS_CACHES = 8,
+    _FOSSIL_HOSTSYS_MAX_CPUS = 1024,
+    _FOSSIL_HOSTSYS_STALENESS = 100000000   // default age limit of the dynamic fields, in ns
 };
 
+// Kind of a cache level
+typedef enum {
+    FOSSIL_HOSTSYS_CACHE_DATA,
+    FOSSIL_HOSTSYS_CACHE_INSTRUCTION,
+    FOSSIL_HOSTSYS_CACHE_UNIFIED
+} fossil_hostsys_cache_type_t;
+
+// One cache as seen from a single CPU
+typedef struct {
+    int32_t level;
+    fossil_hostsys_cache_type_t type;
+    int64_t size;          // in bytes
+    int32_t line_size;     // in bytes
+    int32_t ways;
+    int32_t shared_cpus;   // logical CPUs sharing one instance
+} fossil_hostsys_cache_t;
+
+// Placement of one online logical CPU
+typedef struct {
+    int32_t cpu;           // logical CPU number used by the kernel
+    int32_t core;          // dense physical core index, shared by SMT siblings
+    int32_t package;       // physical package (socket) id
+    int32_t numa_node;     // NUMA node, 0 without NUMA
+    int32_t smt_index;     // position among the siblings of its core
+    int32_t l2_domain;     // dense index of the L2 sharing set, -1 if unknown
+    int32_t l3_domain;     // dense index of the L3 sharing set, -1 if unknown
+} fossil_hostsys_cpu_t;
+
+// Structure to represent the CPU topology
+typedef struct {
+    int32_t num_cpus;      // online logical CPUs
+    int32_t num_cores;     // physical cores
+    int32_t num_packages;
+    int32_t num_numa_nodes;
+    int32_t num_l2_domains;
+    int32_t num_l3_domains;
+    int32_t threads_per_core;
+    int32_t num_caches;
+    fossil_hostsys_cache_t caches[_FOSSIL_HOSTSYS_CACHES];
+    fossil_hostsys_cpu_t *cpus;  // num_cpus records ordered by CPU number
+} fossil_hostsys_topology_t;
+
+// CPU feature flags, combined into the bitmask from fossil_hostsys_features
+typedef enum {
+    FOSSIL_HOSTSYS_FEATURE_SSE2        = 1 << 0,
+    FOSSIL_HOSTSYS_FEATURE_SSE3        = 1 << 1,
+    FOSSIL_HOSTSYS_FEATURE_SSSE3       = 1 << 2,
+    FOSSIL_HOSTSYS_FEATURE_SSE41       = 1 << 3,
+    FOSSIL_HOSTSYS_FEATURE_SSE42       = 1 << 4,
+    FOSSIL_HOSTSYS_FEATURE_POPCNT      = 1 << 5,
+    FOSSIL_HOSTSYS_FEATURE_AES         = 1 << 6,
+    FOSSIL_HOSTSYS_FEATURE_PCLMUL      = 1 << 7,
+    FOSSIL_HOSTSYS_FEATURE_AVX         = 1 << 8,
+    FOSSIL_HOSTSYS_FEATURE_F16C        = 1 << 9,
+    FOSSIL_HOSTSYS_FEATURE_FMA         = 1 << 10,
+    FOSSIL_HOSTSYS_FEATURE_AVX2        = 1 << 11,
+    FOSSIL_HOSTSYS_FEATURE_BMI1        = 1 << 12,
+    FOSSIL_HOSTSYS_FEATURE_BMI2        = 1 << 13,
+    FOSSIL_HOSTSYS_FEATURE_SHA         = 1 << 14,
+    FOSSIL_HOSTSYS_FEATURE_AVX512F     = 1 << 15,
+    FOSSIL_HOSTSYS_FEATURE_AVX512DQ    = 1 << 16,
+    FOSSIL_HOSTSYS_FEATURE_AVX512BW    = 1 << 17,
+    FOSSIL_HOSTSYS_FEATURE_AVX512VL    = 1 << 18,
+    FOSSIL_HOSTSYS_FEATURE_AVX512VNNI  = 1 << 19,
+    FOSSIL_HOSTSYS_FEATURE_NEON        = 1 << 20,
+    FOSSIL_HOSTSYS_FEATURE_ARM_AES     = 1 << 21,
+    FOSSIL_HOSTSYS_FEATURE_ARM_SHA2    = 1 << 22,
+    FOSSIL_HOSTSYS_FEATURE_ARM_CRC32   = 1 << 23,
+    FOSSIL_HOSTSYS_FEATURE_ARM_ATOMICS = 1 << 24,
+    FOSSIL_HOSTSYS_FEATURE_ARM_DOTPROD = 1 << 25,
+    FOSSIL_HOSTSYS_FEATURE_SVE         = 1 << 26,
+    FOSSIL_HOSTSYS_FEATURE_SVE2        = 1 << 27
+} fossil_hostsys_feature_t;
+
+// Resource limits that apply to this process
+typedef struct {
+    int32_t affinity_cpus;     // CPUs in the process affinity mask (the main thread's on Linux)
+    double cpu_quota;          // cgroup CPU bandwidth in CPUs, 0 when unlimited
+    int64_t memory_max;        // cgroup hard memory limit in bytes, 0 when unlimited
+    int64_t memory_high;       // cgroup throttling threshold in bytes, 0 when unlimited
+    int32_t effective_cpus;    // CPUs worth of work the process can run at once
+    int64_t effective_memory;  // bytes usable before being throttled or killed
+} fossil_hostsys_limits_t;
+
+// One published telemetry sample; rates and fractions cover the last interval
+typedef struct {
+    uint64_t sequence;         // samples published so far, 0 before the first
+    int64_t timestamp;         // monotonic time of the sample, in ns
+    int32_t num_cpus;          // entries in the per-CPU array, indexed by CPU number
+    double cpu_busy;           // busy fraction of all CPUs, 0 to 1
+    double cpu_iowait;         // fraction of all CPUs idle while waiting for I/O
+    int64_t memory_total;      // in bytes
+    int64_t memory_available;  // in bytes
+    int64_t swap_used;         // in bytes
+    double disk_read_rate;     // bytes per second across physical disks
+    double disk_write_rate;    // bytes per second across physical disks
+    double net_receive_rate;   // bytes per second across interfaces except loopback
+    double net_transmit_rate;  // bytes per second across interfaces except loopback
+    double cpu_pressure;       // PSI "some" avg10, percent of time stalled, 0 without PSI
+    double memory_pressure;
+    double io_pressure;
+} fossil_hostsys_sample_t;
+
+// Background thread publishing fossil_hostsys_sample_t snapshots
+typedef struct fossil_hostsys_sampler fossil_hostsys_sampler_t;
+
+// Resource use of the calling process
+typedef struct {
+    int64_t timestamp;             // monotonic time of the reading, in ns
+    int64_t rss;                   // resident set size, in bytes
+    int64_t pss;                   // proportional set size in bytes, 0 unless requested or unavailable
+    int64_t virtual_size;          // in bytes
+    int64_t minor_faults;
+    int64_t major_faults;
+    int64_t voluntary_switches;
+    int64_t involuntary_switches;
+    double user_time;              // processor time in user mode, in seconds
+    double system_time;            // processor time in the kernel, in seconds
+    int32_t open_fds;              // open descriptors, or handles on Windows
+    int32_t threads;
+} fossil_hostsys_process_t;
+
+// Set of logical CPUs by CPU number
+typedef struct {
+    uint64_t bits[_FOSSIL_HOSTSYS_MAX_CPUS / 64];
+} fossil_hostsys_cpuset_t;
+
+// Groups of CPUs selectable with fossil_hostsys_cpuset_domain
+typedef enum {
+    FOSSIL_HOSTSYS_DOMAIN_CPU,
+    FOSSIL_HOSTSYS_DOMAIN_CORE,
+    FOSSIL_HOSTSYS_DOMAIN_PACKAGE,
+    FOSSIL_HOSTSYS_DOMAIN_NUMA,
+    FOSSIL_HOSTSYS_DOMAIN_L2,
+    FOSSIL_HOSTSYS_DOMAIN_L3
+} fossil_hostsys_domain_t;
+
+// Worker placement policies for fossil_hostsys_place
+typedef enum {
+    FOSSIL_HOSTSYS_PLACE_COMPACT,   // fill each core's SMT siblings, then the next core, then the next package
+    FOSSIL_HOSTSYS_PLACE_SCATTER,   // spread over packages, then cores, before doubling up on siblings
+    FOSSIL_HOSTSYS_PLACE_PHYSICAL   // one worker per physical core, never two on siblings
+} fossil_hostsys_policy_t;
+
+// Thread started by fossil_hostsys_thread_start
+typedef struct fossil_hostsys_thread fossil_hostsys_thread_t;
+typedef void* (*fossil_hostsys_routine_t)(void *arg);
+
+// Interval timer started by fossil_hostsys_timer_start
+typedef struct {
+    uint64_t start;   // in ticks
+} fossil_hostsys_timer_t;
+
+// Runs the statement or block that follows and stores its duration in ns into
+// elapsed_ns. Leaving the block with break, goto or return skips the store.
+#define FOSSIL_HOSTSYS_TIMED(elapsed_ns) \
+    for (fossil_hostsys_timer_t _fossil_hostsys_timer = { fossil_hostsys_ticks() }, *_fossil_hostsys_timing = &_fossil_hostsys_timer; \
+         _fossil_hostsys_timing; \
+         (elapsed_ns) = fossil_hostsys_timer_elapsed_ns(&_fossil_hostsys_timer), _fossil_hostsys_timing = NULL)
+
 // Structure to represent a host system
 typedef struct {
     char os_name[_FOSSIL_HOSTSYS_SIZE];
     char os_version[_FOSSIL_HOSTSYS_SIZE];
     char cpu_model[_FOSSIL_HOSTSYS_SIZE];
     int32_t cpu_cores;
+    int32_t physical_cores;
+    int32_t cpu_sockets;
+    int32_t numa_nodes;
+    int64_t l1_cache;      // L1 data cache per core, in bytes
+    int64_t l2_cache;      // in bytes
+    int64_t l3_cache;      // in bytes
+    uint64_t cpu_features; // fossil_hostsys_feature_t bits usable on this machine
     int64_t total_memory;
     int64_t free_memory;
+    int64_t available_memory;  // free plus reclaimable page cache, in MB
+    double load_average;       // one-minute load average, 0 where the OS keeps none
+    int32_t effective_cpus;    // cpu_cores narrowed by affinity and cgroup quota
+    int64_t effective_memory;  // total_memory narrowed by cgroup limits, in MB
+    int64_t timer_frequency;   // ticks per second of fossil_hostsys_ticks
+    bool invariant_tsc;        // the cycle counter runs at a constant rate across power states
     bool is_big_endian;
 } fossil_hostsystem_t;
 
@@ -44,11 +220,378 @@ typedef struct {
  * version, CPU model, number of CPU cores, total memory, and free memory. The information
  * is stored in the provided fossil_hostsystem_t structure.
  * 
+ * Fields that cannot change while the process runs are gathered on the first call
+ * and cached. Free memory, available memory, the load average and the effective
+ * CPUs and memory are refreshed when older than the bound set with
+ * fossil_hostsys_set_staleness, 100 ms by default;
+ * otherwise the call only copies the cached snapshot. The effective CPUs and
+ * memory walk the cgroup tree, so they are re-read at most once a second.
+ * 
  * @param info Pointer to the fossil_hostsystem_t structure where the system information will be stored.
  * @return Returns true if the system information was successfully retrieved, otherwise false.
  */
 bool fossil_hostsys_get(fossil_hostsystem_t *info);
 
+/**
+ * @brief Discovers the CPU topology below a sysfs CPU directory.
+ * 
+ * This function reads the online CPUs, their SMT siblings, packages, NUMA nodes
+ * and cache sharing sets from a directory laid out like /sys/devices/system/cpu.
+ * Each sharing set is read once, from its first CPU. Where sysfs is unavailable
+ * a flat topology with one core per logical CPU is reported.
+ * 
+ * @param root Directory to read, or NULL for /sys/devices/system/cpu.
+ * @param topology Pointer to the structure receiving the topology; release it with fossil_hostsys_topology_free.
+ * @return Returns true if the topology was discovered, otherwise false.
+ */
+bool fossil_hostsys_topology_load(const char *root, fossil_hostsys_topology_t *topology);
+
+/**
+ * @brief Releases the per-CPU records of a loaded topology.
+ * 
+ * @param topology Pointer to the topology to release.
+ */
+void fossil_hostsys_topology_free(fossil_hostsys_topology_t *topology);
+
+/**
+ * @brief Returns the topology of this machine.
+ * 
+ * The topology is discovered on first use and shared for the lifetime of the
+ * process, so later calls cost a single load.
+ * 
+ * @return Pointer to the process-wide topology, never NULL.
+ */
+const fossil_hostsys_topology_t* fossil_hostsys_topology(void);
+
+/**
+ * @brief Looks up the record of a logical CPU.
+ * 
+ * @param topology Pointer to the topology to search.
+ * @param cpu Logical CPU number.
+ * @return Pointer to the record, or NULL if the CPU is not online.
+ */
+const fossil_hostsys_cpu_t* fossil_hostsys_topology_cpu(const fossil_hostsys_topology_t *topology, int32_t cpu);
+
+/**
+ * @brief Returns the CPU features usable by this process.
+ * 
+ * On x86 the flags come from CPUID, and the AVX and AVX-512 families are only
+ * reported when XGETBV shows the operating system saves their registers. On ARM
+ * they come from getauxval(AT_HWCAP) or the platform equivalent. Detection runs
+ * once; later calls return the cached mask.
+ * 
+ * @return Bitmask of fossil_hostsys_feature_t values.
+ */
+uint64_t fossil_hostsys_features(void);
+
+/**
+ * @brief Checks for a set of CPU features.
+ * 
+ * @param features One or more fossil_hostsys_feature_t values combined with |.
+ * @return Returns true if every requested feature is usable, otherwise false.
+ */
+bool fossil_hostsys_has_features(uint64_t features);
+
+/**
+ * @brief Returns the lower-case name of a single CPU feature, such as "avx2".
+ * 
+ * @param feature One fossil_hostsys_feature_t value.
+ * @return The name, or NULL if the value is not a single known feature.
+ */
+const char* fossil_hostsys_feature_name(uint64_t feature);
+
+/**
+ * @brief Writes the names of the features in a mask, separated by spaces.
+ * 
+ * @param features Bitmask of fossil_hostsys_feature_t values.
+ * @param buffer Destination, may be NULL when size is 0; always terminated when size is not 0.
+ * @param size Size of the buffer in bytes.
+ * @return Length of the complete text, which may exceed the buffer.
+ */
+size_t fossil_hostsys_feature_string(uint64_t features, char *buffer, size_t size);
+
+/**
+ * @brief Reads the CPU and memory limits that apply to this process.
+ * 
+ * The CPU count starts from the scheduler affinity mask and is narrowed by the
+ * cgroup CPU quota, rounded up. Memory starts from physical memory and is
+ * narrowed by memory.max and memory.high. Without a directory the process's own
+ * cgroups are read from /proc/self/cgroup, v2 or v1, including every ancestor up
+ * to the mount point, so a limit set on an enclosing group also counts.
+ * 
+ * On Linux the affinity is read with sched_getaffinity on the process id, which
+ * returns the main thread's mask: other threads pinning themselves leave it
+ * alone, but a main thread that pins itself narrows the count.
+ * 
+ * @param cgroup_dir A single cgroup directory to read, or NULL for the process's own.
+ * @param limits Pointer to the structure receiving the limits.
+ * @return Returns true if the limits were read, otherwise false.
+ */
+bool fossil_hostsys_limits_load(const char *cgroup_dir, fossil_hostsys_limits_t *limits);
+
+/**
+ * @brief Sets how old the dynamic fields returned by fossil_hostsys_get may be.
+ * 
+ * @param nanoseconds Maximum age of free memory and load average; 0 refreshes them on every call,
+ *                    _FOSSIL_HOSTSYS_STALENESS restores the default.
+ */
+void fossil_hostsys_set_staleness(int64_t nanoseconds);
+
+/**
+ * @brief Starts a background sampler.
+ * 
+ * The sampler thread reads /proc/stat, /proc/meminfo, /proc/diskstats,
+ * /proc/net/dev and the /proc/pressure files through descriptors opened once, parsing
+ * into buffers allocated here, and publishes a sample every interval. Samples are
+ * published under a sequence lock, so any number of threads can read without
+ * blocking the sampler or each other. Outside Linux only memory and timing are
+ * sampled.
+ * 
+ * @param interval Time between samples in nanoseconds, at least one millisecond.
+ * @return The sampler, or NULL if it could not be started.
+ */
+fossil_hostsys_sampler_t* fossil_hostsys_sampler_start(int64_t interval);
+
+/**
+ * @brief Stops a sampler and releases it.
+ * 
+ * @param sampler The sampler, may be NULL.
+ */
+void fossil_hostsys_sampler_stop(fossil_hostsys_sampler_t *sampler);
+
+/**
+ * @brief Copies the latest sample.
+ * 
+ * @param sampler The sampler.
+ * @param sample Pointer to the structure receiving the sample.
+ * @param cpu_busy Receives the busy fraction of each CPU by CPU number, may be NULL.
+ * @param capacity Number of entries cpu_busy can hold.
+ * @return Returns true if a sample has been published, otherwise false.
+ */
+bool fossil_hostsys_sampler_read(const fossil_hostsys_sampler_t *sampler, fossil_hostsys_sample_t *sample,
+                                 float *cpu_busy, int32_t capacity);
+
+/**
+ * @brief Reads the resource use of the calling process.
+ * 
+ * Meant to be cheap enough to call every second: on Linux it is one pread of
+ * /proc/self/statm and /proc/self/stat through descriptors kept open, one
+ * getrusage and one stat of /proc/self/fd. PSS makes the kernel walk every
+ * mapping through /proc/self/smaps_rollup, so it is only read on request.
+ * 
+ * @param process Pointer to the structure receiving the metrics.
+ * @param include_pss Whether to also read the proportional set size.
+ * @return Returns true if the metrics were read, otherwise false.
+ */
+bool fossil_hostsys_process_get(fossil_hostsys_process_t *process, bool include_pss);
+
+/**
+ * @brief Empties a CPU set.
+ * 
+ * @param set Pointer to the set.
+ */
+void fossil_hostsys_cpuset_clear(fossil_hostsys_cpuset_t *set);
+
+/**
+ * @brief Adds a CPU to a set.
+ * 
+ * @param set Pointer to the set.
+ * @param cpu Logical CPU number, ignored outside 0 to _FOSSIL_HOSTSYS_MAX_CPUS - 1.
+ */
+void fossil_hostsys_cpuset_add(fossil_hostsys_cpuset_t *set, int32_t cpu);
+
+/**
+ * @brief Checks whether a CPU is in a set.
+ * 
+ * @param set Pointer to the set.
+ * @param cpu Logical CPU number.
+ * @return Returns true if the CPU is in the set, otherwise false.
+ */
+bool fossil_hostsys_cpuset_has(const fossil_hostsys_cpuset_t *set, int32_t cpu);
+
+/**
+ * @brief Counts the CPUs in a set.
+ * 
+ * @param set Pointer to the set.
+ * @return The number of CPUs.
+ */
+int32_t fossil_hostsys_cpuset_count(const fossil_hostsys_cpuset_t *set);
+
+/**
+ * @brief Selects the CPUs of one core, package, NUMA node or cache domain.
+ * 
+ * @param topology Pointer to the topology, such as fossil_hostsys_topology().
+ * @param domain Kind of group.
+ * @param id CPU number, dense core index, package id, NUMA node or dense cache domain index.
+ * @param set Pointer to the set receiving the CPUs.
+ * @return Returns true if the group has at least one online CPU, otherwise false.
+ */
+bool fossil_hostsys_cpuset_domain(const fossil_hostsys_topology_t *topology, fossil_hostsys_domain_t domain,
+                                  int32_t id, fossil_hostsys_cpuset_t *set);
+
+/**
+ * @brief Chooses the CPU for one worker of a pool.
+ * 
+ * Workers are numbered from 0; numbers beyond the CPUs the policy can use wrap
+ * around, so a pool larger than the machine doubles up evenly.
+ * 
+ * @param topology Pointer to the topology, such as fossil_hostsys_topology().
+ * @param policy Placement policy.
+ * @param worker Index of the worker.
+ * @param allowed CPUs the pool may use, such as the affinity read at startup, or NULL for all.
+ * @param set Pointer to the set receiving the chosen CPU.
+ * @return Returns true if a CPU was chosen, otherwise false.
+ */
+bool fossil_hostsys_place(const fossil_hostsys_topology_t *topology, fossil_hostsys_policy_t policy,
+                          int32_t worker, const fossil_hostsys_cpuset_t *allowed, fossil_hostsys_cpuset_t *set);
+
+/**
+ * @brief Reads the CPUs the calling thread may run on.
+ * 
+ * Windows reports the process mask; platforms without affinity report every
+ * online CPU.
+ * 
+ * @param set Pointer to the set receiving the affinity.
+ * @return Returns true if the affinity was read, otherwise false.
+ */
+bool fossil_hostsys_affinity_self(fossil_hostsys_cpuset_t *set);
+
+/**
+ * @brief Pins the calling thread to a set of CPUs.
+ * 
+ * macOS offers no hard affinity, so there the call always fails. Windows
+ * supports the first 64 CPUs of the thread's processor group.
+ * 
+ * @param set Pointer to the CPUs to run on.
+ * @return Returns true if the thread was pinned, otherwise false.
+ */
+bool fossil_hostsys_pin_self(const fossil_hostsys_cpuset_t *set);
+
+/**
+ * @brief Returns the CPU the calling thread is running on.
+ * 
+ * @return The logical CPU number, or -1 if unknown.
+ */
+int32_t fossil_hostsys_current_cpu(void);
+
+/**
+ * @brief Starts a thread already pinned to a set of CPUs.
+ * 
+ * On Linux and Windows the affinity is applied before the thread runs, so it
+ * never starts on another CPU and migrates. Elsewhere the thread starts unpinned.
+ * 
+ * @param set Pointer to the CPUs to run on, or NULL to leave the thread unpinned.
+ * @param routine Function the thread runs.
+ * @param arg Argument passed to the routine.
+ * @return The thread, to be passed to fossil_hostsys_thread_join, or NULL on failure.
+ */
+fossil_hostsys_thread_t* fossil_hostsys_thread_start(const fossil_hostsys_cpuset_t *set, fossil_hostsys_routine_t routine, void *arg);
+
+/**
+ * @brief Waits for a thread started by fossil_hostsys_thread_start and releases it.
+ * 
+ * @param thread The thread.
+ * @return The value returned by its routine.
+ */
+void* fossil_hostsys_thread_join(fossil_hostsys_thread_t *thread);
+
+/**
+ * @brief Reads the timestamp counter.
+ * 
+ * This is the cycle counter (rdtsc on x86, cntvct_el0 on ARM64) when it runs
+ * at a constant rate, and the monotonic clock in nanoseconds otherwise. Reads
+ * are not serialising, so neighbouring instructions may be reordered around
+ * them.
+ * 
+ * @return The counter value, in ticks of fossil_hostsys_timer_frequency.
+ */
+uint64_t fossil_hostsys_ticks(void);
+
+/**
+ * @brief Converts a tick count to nanoseconds.
+ * 
+ * @param ticks Difference between two fossil_hostsys_ticks readings.
+ * @return The span in nanoseconds.
+ */
+int64_t fossil_hostsys_ticks_to_ns(uint64_t ticks);
+
+/**
+ * @brief Returns the monotonic time derived from the counter.
+ * 
+ * @return Nanoseconds on the CLOCK_MONOTONIC timeline.
+ */
+int64_t fossil_hostsys_now_ns(void);
+
+/**
+ * @brief Returns the rate of fossil_hostsys_ticks.
+ * 
+ * The first call calibrates the counter, which can take a few milliseconds
+ * when the hardware does not report its rate.
+ * 
+ * @return Ticks per second.
+ */
+int64_t fossil_hostsys_timer_frequency(void);
+
+/**
+ * @brief Checks whether the cycle counter runs at a constant rate.
+ * 
+ * On x86 this is the invariant TSC bit, or a TSC the Linux kernel uses as its
+ * clocksource; the ARM64 generic timer always qualifies.
+ * 
+ * @return Returns true if fossil_hostsys_ticks reads the cycle counter, otherwise false.
+ */
+bool fossil_hostsys_invariant_tsc(void);
+
+/**
+ * @brief Starts an interval timer.
+ * 
+ * @param timer Pointer to the timer.
+ */
+void fossil_hostsys_timer_start(fossil_hostsys_timer_t *timer);
+
+/**
+ * @brief Returns the time since the timer was started.
+ * 
+ * @param timer Pointer to the timer.
+ * @return Elapsed nanoseconds.
+ */
+int64_t fossil_hostsys_timer_elapsed_ns(const fossil_hostsys_timer_t *timer);
+
+/**
+ * @brief Returns the time since the timer was started and restarts it.
+ * 
+ * @param timer Pointer to the timer.
+ * @return Elapsed nanoseconds.
+ */
+int64_t fossil_hostsys_timer_lap_ns(fossil_hostsys_timer_t *timer);
+
+/**
+ * @brief Writes a JSON description of the host.
+ * 
+ * The object holds the fingerprint, the OS with its kernel, cpufreq governor and
+ * transparent huge page mode, the CPU model and features, the caches, the
+ * per-CPU topology, the NUMA nodes, memory in bytes and the resource limits.
+ * Settings the platform does not expose are null. Output is truncated like
+ * snprintf, so a call with size 0 measures the report.
+ * 
+ * @param buffer Destination, may be NULL when size is 0.
+ * @param size Size of the buffer in bytes.
+ * @return Length of the complete report, excluding the terminator.
+ */
+size_t fossil_hostsys_report_json(char *buffer, size_t size);
+
+/**
+ * @brief Hashes the hardware into a fingerprint that is stable across boots.
+ * 
+ * Covers the CPU model and features, the CPU, core, package and NUMA node
+ * counts, the caches and the installed memory to the nearest GiB. Kernel
+ * settings, limits and load are left out, so the value changes only with the
+ * hardware.
+ * 
+ * @return 64-bit FNV-1a hash.
+ */
+uint64_t fossil_hostsys_fingerprint(void);
+
 /**
  * @brief Prints the system information to the standard output.
  * 
@@ -11,26 +11,74 @@
  * Copyright (C) 2024 Fossil Logic. All rights reserved.
  * -----------------------------------------------------------------------------
  */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include "fossil/lib/hostsys.h"
 #include <stdio.h>
 #include <string.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <time.h>
 
 #ifdef _WIN32
     #include <windows.h>
     #include <tchar.h>
     #include <lmcons.h>
+    #include <psapi.h>
+    #include <tlhelp32.h>
 #elif __linux__
     #include <sys/utsname.h>
     #include <unistd.h>
-    #include <sys/sysinfo.h>
+    #include <fcntl.h>
+    #include <dirent.h>
+    #include <sched.h>
+    #include <sys/stat.h>
 #elif __APPLE__
     #include <sys/utsname.h>
     #include <unistd.h>
     #include <sys/types.h>
     #include <sys/sysctl.h>
     #include <mach/mach.h>
+    #include <libproc.h>
+#endif
+
+#ifndef _WIN32
+    #include <pthread.h>
+    #include <errno.h>
+    #include <sys/resource.h>
+#endif
+
+// Sequence counter access for the telemetry seqlock
+#ifdef _MSC_VER
+    #define _FOSSIL_HOSTSYS_SEQ_LOAD(p)     ((uint64_t)InterlockedOr64((volatile LONG64*)(p), 0))
+    #define _FOSSIL_HOSTSYS_SEQ_STORE(p, v) InterlockedExchange64((volatile LONG64*)(p), (LONG64)(v))
+    #define _FOSSIL_HOSTSYS_FENCE()         MemoryBarrier()
+#else
+    #define _FOSSIL_HOSTSYS_SEQ_LOAD(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define _FOSSIL_HOSTSYS_SEQ_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+    #define _FOSSIL_HOSTSYS_FENCE()         __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define _FOSSIL_HOSTSYS_X86 1
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__arm__)
+    #define _FOSSIL_HOSTSYS_ARM 1
+    #ifdef __linux__
+        #include <sys/auxv.h>
+    #endif
 #endif
 
+static size_t fossil_hostsys_align(size_t size, size_t alignment) {
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
 static bool fossil_hostsys_get_endian(fossil_hostsystem_t *info) {
     unsigned int num = 1;
     char *endian_check = (char*)&num;
@@ -70,11 +118,25 @@ static bool fossil_hostsys_get_windows(fossil_hostsystem_t *info) {
     }
 
     info->total_memory = memInfo.ullTotalPhys / (1024 * 1024);  // in MB
-    info->free_memory = memInfo.ullAvailPhys / (1024 * 1024);  // in MB
 
     return true;
 }
 
+static bool fossil_hostsys_refresh_windows(fossil_hostsystem_t *info) {
+    MEMORYSTATUSEX memInfo;
+
+    memInfo.dwLength = sizeof(MEMORYSTATUSEX);
+    if (!GlobalMemoryStatusEx(&memInfo)) {
+        fprintf(stderr, "Error getting memory information\n");
+        return false;
+    }
+
+    info->free_memory = memInfo.ullAvailPhys / (1024 * 1024);  // in MB
+    info->available_memory = info->free_memory;
+    info->load_average = 0.0;  // Windows keeps no load average
+    return true;
+}
+
 #elif defined(__linux__)
 static bool fossil_hostsys_get_linux(fossil_hostsystem_t *info) {
     struct utsname unameData;
@@ -99,6 +161,7 @@ static bool fossil_hostsys_get_linux(fossil_hostsystem_t *info) {
                 if (pos) {
                     strncpy(info->cpu_model, pos + 2, sizeof(info->cpu_model) - 1);
                     info->cpu_model[sizeof(info->cpu_model) - 1] = '\0'; // Ensure null-termination
+                    info->cpu_model[strcspn(info->cpu_model, "\n")] = '\0';
                     break;
                 }
             }
@@ -115,14 +178,41 @@ static bool fossil_hostsys_get_linux(fossil_hostsystem_t *info) {
     long page_size = sysconf(_SC_PAGE_SIZE);
     info->total_memory = pages * page_size / (1024 * 1024);  // in MB
 
-    struct sysinfo memInfo;
-    if (sysinfo(&memInfo) == 0) {
-        info->free_memory = memInfo.freeram / (1024 * 1024);  // in MB
-    } else {
+    return true;
+}
+
+// Kept open so a refresh is one pread per file instead of open, read and close
+static int fossil_hostsys_meminfo_fd = -1;
+static int fossil_hostsys_loadavg_fd = -1;
+
+static int64_t fossil_hostsys_meminfo_field(const char *text, const char *name) {
+    const char *line = strstr(text, name);
+    return line ? (int64_t)strtoll(line + strlen(name), NULL, 10) : 0;  // in kB
+}
+
+static bool fossil_hostsys_refresh_linux(fossil_hostsystem_t *info) {
+    char text[4096];   // MemFree and MemAvailable are on the first lines
+
+    if (fossil_hostsys_meminfo_fd < 0) {
+        fossil_hostsys_meminfo_fd = open("/proc/meminfo", O_RDONLY | O_CLOEXEC);
+    }
+    ssize_t length = fossil_hostsys_meminfo_fd < 0 ? -1 : pread(fossil_hostsys_meminfo_fd, text, sizeof(text) - 1, 0);
+    if (length <= 0) {
         fprintf(stderr, "Error getting memory information\n");
         return false;
     }
+    text[length] = '\0';
+    info->free_memory = fossil_hostsys_meminfo_field(text, "MemFree:") / 1024;  // in MB
+    info->available_memory = fossil_hostsys_meminfo_field(text, "MemAvailable:") / 1024;  // in MB
 
+    if (fossil_hostsys_loadavg_fd < 0) {
+        fossil_hostsys_loadavg_fd = open("/proc/loadavg", O_RDONLY | O_CLOEXEC);
+    }
+    length = fossil_hostsys_loadavg_fd < 0 ? -1 : pread(fossil_hostsys_loadavg_fd, text, 64, 0);
+    if (length > 0) {
+        text[length] = '\0';
+        info->load_average = strtod(text, NULL);
+    }
     return true;
 }
 
@@ -164,6 +254,10 @@ static bool fossil_hostsys_get_macos(fossil_hostsystem_t *info) {
     }
     info->total_memory /= (1024 * 1024); // Convert to MB
 
+    return true;
+}
+
+static bool fossil_hostsys_refresh_macos(fossil_hostsystem_t *info) {
     // Get free memory using mach API
     mach_port_t host_port = mach_host_self();
     mach_msg_type_number_t count = HOST_VM_INFO_COUNT;
@@ -175,29 +269,2388 @@ static bool fossil_hostsys_get_macos(fossil_hostsystem_t *info) {
         return false;
     }
     info->free_memory = (vm_stats.free_count * vm_page_size) / (1024 * 1024); // Convert to MB
+    info->available_memory = ((int64_t)(vm_stats.free_count + vm_stats.inactive_count) * vm_page_size) / (1024 * 1024);
 
+    double load[1];
+    if (getloadavg(load, 1) == 1) {
+        info->load_average = load[0];
+    }
     return true;
 }
 #endif
 
-bool fossil_hostsys_get(fossil_hostsystem_t *info) {
+// * * * * * * * * * * * * * * * * * * * * * * * *
+// * CPU topology
+// * * * * * * * * * * * * * * * * * * * * * * * *
+
+static int32_t fossil_hostsys_online_cpus(void) {
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetNativeSystemInfo(&si);
+    return (int32_t)si.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int32_t)count : 1;
+#else
+    return 1;
+#endif
+}
+
+// One core per logical CPU, for systems without sysfs
+static bool fossil_hostsys_topology_flat(fossil_hostsys_topology_t *topology) {
+    int32_t count = fossil_hostsys_online_cpus();
+    int32_t threads = 1;
+
+    memset(topology, 0, sizeof(*topology));
+#ifdef __APPLE__
+    int32_t value = 0;
+    int64_t size = 0;
+    size_t len = sizeof(value);
+    if (sysctlbyname("hw.physicalcpu", &value, &len, NULL, 0) == 0 && value > 0 && count % value == 0) {
+        threads = count / value;
+    }
+    static const char *const names[] = {"hw.l1dcachesize", "hw.l2cachesize", "hw.l3cachesize"};
+    for (int32_t level = 0; level < 3; ++level) {
+        len = sizeof(size);
+        if (sysctlbyname(names[level], &size, &len, NULL, 0) == 0 && size > 0) {
+            fossil_hostsys_cache_t *cache = &topology->caches[topology->num_caches++];
+            cache->level = level + 1;
+            cache->type = level == 0 ? FOSSIL_HOSTSYS_CACHE_DATA : FOSSIL_HOSTSYS_CACHE_UNIFIED;
+            cache->size = size;
+        }
+    }
+#endif
+
+    topology->cpus = malloc((size_t)count * sizeof(fossil_hostsys_cpu_t));
+    if (!topology->cpus) {
+        return false;
+    }
+    for (int32_t i = 0; i < count; ++i) {
+        fossil_hostsys_cpu_t *cpu = &topology->cpus[i];
+        cpu->cpu = i;
+        cpu->core = i / threads;
+        cpu->package = 0;
+        cpu->numa_node = 0;
+        cpu->smt_index = i % threads;
+        cpu->l2_domain = -1;
+        cpu->l3_domain = -1;
+    }
+    topology->num_cpus = count;
+    topology->num_cores = (count + threads - 1) / threads;
+    topology->num_packages = 1;
+    topology->num_numa_nodes = 1;
+    topology->threads_per_core = threads;
+    return true;
+}
+
+#ifdef __linux__
+enum {
+    _FOSSIL_HOSTSYS_PATH = 512,
+    _FOSSIL_HOSTSYS_LIST = 16384   // cpu lists of very large machines
+};
+
+// Reads a small text file such as a sysfs attribute, without the trailing newline
+static int32_t fossil_hostsys_read_text(const char *path, char *buffer, size_t size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t length = read(fd, buffer, size - 1);
+    close(fd);
+    if (length < 0) {
+        return -1;
+    }
+    while (length > 0 && (buffer[length - 1] == '\n' || buffer[length - 1] == ' ')) {
+        --length;
+    }
+    buffer[length] = '\0';
+    return (int32_t)length;
+}
+
+static int32_t fossil_hostsys_read_cpu_attr(const char *root, int32_t cpu, const char *attribute, char *buffer, size_t size) {
+    char path[_FOSSIL_HOSTSYS_PATH];
+    if (snprintf(path, sizeof(path), "%s/cpu%d/%s", root, (int)cpu, attribute) >= (int)sizeof(path)) {
+        return -1;
+    }
+    return fossil_hostsys_read_text(path, buffer, size);
+}
+
+// Expands a kernel cpu list such as "0-3,8,10-11" in ascending order. Stores
+// at most max entries and returns how many the list holds.
+static int32_t fossil_hostsys_parse_cpu_list(const char *text, int32_t *cpus, int32_t max) {
+    int32_t count = 0;
+    const char *p = text;
+    while (*p) {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0) {
+            break;
+        }
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            if (end == p + 1 || last < first) {
+                break;
+            }
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            if (count < max) {
+                cpus[count] = (int32_t)cpu;
+            }
+            ++count;
+        }
+        if (*p != ',') {
+            break;
+        }
+        ++p;
+    }
+    return count;
+}
+
+// Sizes such as "32K" or "8M", in bytes
+static int64_t fossil_hostsys_parse_size(const char *text) {
+    char *end;
+    long long size = strtoll(text, &end, 10);
+    switch (*end) {
+        case 'K': return (int64_t)size << 10;
+        case 'M': return (int64_t)size << 20;
+        case 'G': return (int64_t)size << 30;
+        default:  return (int64_t)size;
+    }
+}
+
+// Groups the CPUs into the sets named by a per-CPU list attribute, reading it
+// once per set from its first member that is not yet grouped. The dense set
+// index is stored in the int32_t member of fossil_hostsys_cpu_t at field.
+static int32_t fossil_hostsys_group_cpus(const char *root, const char *attribute, fossil_hostsys_topology_t *topology,
+                                         const int32_t *index_of, int32_t max_cpu, int32_t *scratch, size_t field, char *text) {
+    int32_t sets = 0;
+    for (int32_t i = 0; i < topology->num_cpus; ++i) {
+        int32_t *slot = (int32_t*)((char*)&topology->cpus[i] + field);
+        if (*slot != -1) {
+            continue;
+        }
+        int32_t members = 0;
+        if (fossil_hostsys_read_cpu_attr(root, topology->cpus[i].cpu, attribute, text, _FOSSIL_HOSTSYS_LIST) > 0) {
+            members = fossil_hostsys_parse_cpu_list(text, scratch, max_cpu + 1);
+            members = members > max_cpu + 1 ? max_cpu + 1 : members;
+        }
+        for (int32_t m = 0; m < members; ++m) {
+            if (scratch[m] <= max_cpu && index_of[scratch[m]] != -1) {
+                *(int32_t*)((char*)&topology->cpus[index_of[scratch[m]]] + field) = sets;
+            }
+        }
+        *slot = sets;   // also when the attribute is missing or leaves the CPU out
+        ++sets;
+    }
+    return sets;
+}
+
+static int32_t fossil_hostsys_read_node(const char *root, int32_t cpu) {
+    char path[_FOSSIL_HOSTSYS_PATH];
+    int32_t node = 0;
+    snprintf(path, sizeof(path), "%s/cpu%d", root, (int)cpu);
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return 0;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+            node = (int32_t)atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+static int32_t fossil_hostsys_count_distinct(const fossil_hostsys_topology_t *topology, size_t field, int32_t *scratch) {
+    int32_t distinct = 0;
+    for (int32_t i = 0; i < topology->num_cpus; ++i) {
+        int32_t value = *(const int32_t*)((const char*)&topology->cpus[i] + field);
+        int32_t seen = 0;
+        for (int32_t d = 0; d < distinct && !seen; ++d) {
+            seen = scratch[d] == value;
+        }
+        if (!seen) {
+            scratch[distinct++] = value;
+        }
+    }
+    return distinct;
+}
+
+static bool fossil_hostsys_topology_sysfs(const char *root, fossil_hostsys_topology_t *topology) {
+    char *text = malloc(_FOSSIL_HOSTSYS_LIST);
+    char attribute[64];
+    int32_t *online = NULL;
+    int32_t *index_of = NULL;
     bool result = false;
 
-    #ifdef _WIN32
-        result = fossil_hostsys_get_windows(info);
-    #elif __linux__
-        result = fossil_hostsys_get_linux(info);
-    #elif __APPLE__
-        result = fossil_hostsys_get_macos(info);
-    #else
-        fprintf(stderr, "Unsupported platform\n");
-    #endif
+    memset(topology, 0, sizeof(*topology));
+    if (!text) {
+        return false;
+    }
+    char path[_FOSSIL_HOSTSYS_PATH];
+    snprintf(path, sizeof(path), "%s/online", root);
+    int32_t count = 0;
+    if (fossil_hostsys_read_text(path, text, _FOSSIL_HOSTSYS_LIST) > 0) {
+        count = fossil_hostsys_parse_cpu_list(text, NULL, 0);
+    }
+    if (count <= 0) {
+        goto done;
+    }
+    online = malloc((size_t)count * sizeof(int32_t));
+    topology->cpus = malloc((size_t)count * sizeof(fossil_hostsys_cpu_t));
+    if (!online || !topology->cpus) {
+        goto done;
+    }
+    fossil_hostsys_parse_cpu_list(text, online, count);
 
-    if (result) {
-        return fossil_hostsys_get_endian(info);
-    } else {
+    int32_t max_cpu = online[count - 1];
+    index_of = malloc(2 * ((size_t)max_cpu + 1) * sizeof(int32_t));
+    if (!index_of) {
+        goto done;
+    }
+    int32_t *scratch = index_of + max_cpu + 1;
+    for (int32_t c = 0; c <= max_cpu; ++c) {
+        index_of[c] = -1;
+    }
+
+    topology->num_cpus = count;
+    for (int32_t i = 0; i < count; ++i) {
+        fossil_hostsys_cpu_t *cpu = &topology->cpus[i];
+        index_of[online[i]] = i;
+        cpu->cpu = online[i];
+        cpu->core = -1;
+        cpu->package = 0;
+        cpu->smt_index = 0;
+        cpu->l2_domain = -1;
+        cpu->l3_domain = -1;
+        if (fossil_hostsys_read_cpu_attr(root, cpu->cpu, "topology/physical_package_id", attribute, sizeof(attribute)) > 0) {
+            cpu->package = (int32_t)atoi(attribute);
+        }
+        cpu->numa_node = fossil_hostsys_read_node(root, cpu->cpu);
+    }
+
+    // SMT siblings; core_cpus_list replaced thread_siblings_list in newer kernels
+    const char *siblings = "topology/core_cpus_list";
+    if (fossil_hostsys_read_cpu_attr(root, online[0], siblings, text, _FOSSIL_HOSTSYS_LIST) < 0) {
+        siblings = "topology/thread_siblings_list";
+    }
+    topology->num_cores = fossil_hostsys_group_cpus(root, siblings, topology, index_of, max_cpu, scratch,
+                                                    offsetof(fossil_hostsys_cpu_t, core), text);
+    memset(scratch, 0, (size_t)topology->num_cores * sizeof(int32_t));
+    for (int32_t i = 0; i < count; ++i) {
+        fossil_hostsys_cpu_t *cpu = &topology->cpus[i];
+        cpu->smt_index = scratch[cpu->core]++;
+        if (cpu->smt_index + 1 > topology->threads_per_core) {
+            topology->threads_per_core = cpu->smt_index + 1;
+        }
+    }
+
+    // Caches as seen from the first CPU, plus the L2 and L3 sharing sets
+    for (int32_t k = 0; k < _FOSSIL_HOSTSYS_CACHES; ++k) {
+        snprintf(attribute, sizeof(attribute), "cache/index%d/level", (int)k);
+        if (fossil_hostsys_read_cpu_attr(root, online[0], attribute, text, _FOSSIL_HOSTSYS_LIST) <= 0) {
+            break;
+        }
+        fossil_hostsys_cache_t *cache = &topology->caches[topology->num_caches++];
+        memset(cache, 0, sizeof(*cache));
+        cache->level = (int32_t)atoi(text);
+        cache->type = FOSSIL_HOSTSYS_CACHE_UNIFIED;
+        snprintf(attribute, sizeof(attribute), "cache/index%d/type", (int)k);
+        if (fossil_hostsys_read_cpu_attr(root, online[0], attribute, text, _FOSSIL_HOSTSYS_LIST) > 0) {
+            cache->type = strcmp(text, "Data") == 0 ? FOSSIL_HOSTSYS_CACHE_DATA
+                        : strcmp(text, "Instruction") == 0 ? FOSSIL_HOSTSYS_CACHE_INSTRUCTION
+                        : FOSSIL_HOSTSYS_CACHE_UNIFIED;
+        }
+        snprintf(attribute, sizeof(attribute), "cache/index%d/size", (int)k);
+        if (fossil_hostsys_read_cpu_attr(root, online[0], attribute, text, _FOSSIL_HOSTSYS_LIST) > 0) {
+            cache->size = fossil_hostsys_parse_size(text);
+        }
+        snprintf(attribute, sizeof(attribute), "cache/index%d/coherency_line_size", (int)k);
+        if (fossil_hostsys_read_cpu_attr(root, online[0], attribute, text, _FOSSIL_HOSTSYS_LIST) > 0) {
+            cache->line_size = (int32_t)atoi(text);
+        }
+        snprintf(attribute, sizeof(attribute), "cache/index%d/ways_of_associativity", (int)k);
+        if (fossil_hostsys_read_cpu_attr(root, online[0], attribute, text, _FOSSIL_HOSTSYS_LIST) > 0) {
+            cache->ways = (int32_t)atoi(text);
+        }
+        snprintf(attribute, sizeof(attribute), "cache/index%d/shared_cpu_list", (int)k);
+        if (fossil_hostsys_read_cpu_attr(root, online[0], attribute, text, _FOSSIL_HOSTSYS_LIST) > 0) {
+            cache->shared_cpus = fossil_hostsys_parse_cpu_list(text, NULL, 0);
+        }
+
+        if (cache->type != FOSSIL_HOSTSYS_CACHE_INSTRUCTION && cache->level == 2 && topology->num_l2_domains == 0) {
+            topology->num_l2_domains = fossil_hostsys_group_cpus(root, attribute, topology, index_of, max_cpu, scratch,
+                                                                 offsetof(fossil_hostsys_cpu_t, l2_domain), text);
+        } else if (cache->type != FOSSIL_HOSTSYS_CACHE_INSTRUCTION && cache->level == 3 && topology->num_l3_domains == 0) {
+            topology->num_l3_domains = fossil_hostsys_group_cpus(root, attribute, topology, index_of, max_cpu, scratch,
+                                                                 offsetof(fossil_hostsys_cpu_t, l3_domain), text);
+        }
+    }
+
+    topology->num_packages = fossil_hostsys_count_distinct(topology, offsetof(fossil_hostsys_cpu_t, package), scratch);
+    topology->num_numa_nodes = fossil_hostsys_count_distinct(topology, offsetof(fossil_hostsys_cpu_t, numa_node), scratch);
+    result = true;
+
+done:
+    if (!result) {
+        free(topology->cpus);
+        memset(topology, 0, sizeof(*topology));
+    }
+    free(index_of);
+    free(online);
+    free(text);
+    return result;
+}
+#endif
+
+bool fossil_hostsys_topology_load(const char *root, fossil_hostsys_topology_t *topology) {
+    if (!topology) {
         return false;
     }
+#ifdef __linux__
+    if (fossil_hostsys_topology_sysfs(root ? root : "/sys/devices/system/cpu", topology)) {
+        return true;
+    }
+    fossil_hostsys_topology_flat(topology);
+    return false;
+#else
+    if (root) {
+        memset(topology, 0, sizeof(*topology));
+        return false;   // no sysfs to read
+    }
+    return fossil_hostsys_topology_flat(topology);
+#endif
+}
+
+void fossil_hostsys_topology_free(fossil_hostsys_topology_t *topology) {
+    if (topology) {
+        free(topology->cpus);
+        topology->cpus = NULL;
+        topology->num_cpus = 0;
+    }
+}
+
+static fossil_hostsys_topology_t fossil_hostsys_machine_topology;
+
+#ifdef _WIN32
+static INIT_ONCE fossil_hostsys_topology_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK fossil_hostsys_topology_init(PINIT_ONCE once, PVOID parameter, PVOID *context) {
+    (void)once;
+    (void)parameter;
+    (void)context;
+    fossil_hostsys_topology_load(NULL, &fossil_hostsys_machine_topology);
+    return TRUE;
+}
+#else
+static pthread_once_t fossil_hostsys_topology_once = PTHREAD_ONCE_INIT;
+
+static void fossil_hostsys_topology_init(void) {
+    fossil_hostsys_topology_load(NULL, &fossil_hostsys_machine_topology);
+}
+#endif
+
+const fossil_hostsys_topology_t* fossil_hostsys_topology(void) {
+#ifdef _WIN32
+    InitOnceExecuteOnce(&fossil_hostsys_topology_once, fossil_hostsys_topology_init, NULL, NULL);
+#else
+    pthread_once(&fossil_hostsys_topology_once, fossil_hostsys_topology_init);
+#endif
+    return &fossil_hostsys_machine_topology;
+}
+
+const fossil_hostsys_cpu_t* fossil_hostsys_topology_cpu(const fossil_hostsys_topology_t *topology, int32_t cpu) {
+    if (!topology || !topology->cpus) {
+        return NULL;
+    }
+    int32_t low = 0;
+    int32_t high = topology->num_cpus;
+    while (low < high) {
+        int32_t mid = low + (high - low) / 2;
+        if (topology->cpus[mid].cpu < cpu) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return (low < topology->num_cpus && topology->cpus[low].cpu == cpu) ? &topology->cpus[low] : NULL;
+}
+
+static void fossil_hostsys_get_topology(fossil_hostsystem_t *info) {
+    const fossil_hostsys_topology_t *topology = fossil_hostsys_topology();
+
+    info->physical_cores = topology->num_cores;
+    info->cpu_sockets = topology->num_packages;
+    info->numa_nodes = topology->num_numa_nodes;
+    for (int32_t i = 0; i < topology->num_caches; ++i) {
+        const fossil_hostsys_cache_t *cache = &topology->caches[i];
+        if (cache->type == FOSSIL_HOSTSYS_CACHE_INSTRUCTION) {
+            continue;
+        }
+        if (cache->level == 1 && !info->l1_cache) {
+            info->l1_cache = cache->size;
+        } else if (cache->level == 2 && !info->l2_cache) {
+            info->l2_cache = cache->size;
+        } else if (cache->level == 3 && !info->l3_cache) {
+            info->l3_cache = cache->size;
+        }
+    }
+}
+
+// * * * * * * * * * * * * * * * * * * * * * * * *
+// * CPU features
+// * * * * * * * * * * * * * * * * * * * * * * * *
+
+#ifdef _FOSSIL_HOSTSYS_X86
+static void fossil_hostsys_cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4]) {
+#ifdef _MSC_VER
+    int out[4];
+    __cpuidex(out, (int)leaf, (int)subleaf);
+    for (int i = 0; i < 4; ++i) {
+        regs[i] = (uint32_t)out[i];
+    }
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Register state the operating system saves on context switches (XCR0)
+static uint64_t fossil_hostsys_xgetbv(void) {
+#ifdef _MSC_VER
+    return (uint64_t)_xgetbv(0);
+#else
+    uint32_t low, high;
+    __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    return ((uint64_t)high << 32) | low;
+#endif
+}
+
+static uint64_t fossil_hostsys_detect_features(void) {
+    uint32_t regs[4];
+    uint64_t features = 0;
+
+    fossil_hostsys_cpuid(0, 0, regs);
+    uint32_t max_leaf = regs[0];
+    if (max_leaf < 1) {
+        return 0;
+    }
+
+    fossil_hostsys_cpuid(1, 0, regs);
+    uint32_t ecx = regs[2];
+    uint32_t edx = regs[3];
+    if (edx & (1u << 26)) features |= FOSSIL_HOSTSYS_FEATURE_SSE2;
+    if (ecx & (1u << 0))  features |= FOSSIL_HOSTSYS_FEATURE_SSE3;
+    if (ecx & (1u << 1))  features |= FOSSIL_HOSTSYS_FEATURE_PCLMUL;
+    if (ecx & (1u << 9))  features |= FOSSIL_HOSTSYS_FEATURE_SSSE3;
+    if (ecx & (1u << 19)) features |= FOSSIL_HOSTSYS_FEATURE_SSE41;
+    if (ecx & (1u << 20)) features |= FOSSIL_HOSTSYS_FEATURE_SSE42;
+    if (ecx & (1u << 23)) features |= FOSSIL_HOSTSYS_FEATURE_POPCNT;
+    if (ecx & (1u << 25)) features |= FOSSIL_HOSTSYS_FEATURE_AES;
+
+    // AVX needs OSXSAVE and the OS saving XMM and YMM state; AVX-512 also the
+    // opmask and both halves of the ZMM registers
+    bool os_avx = false;
+    bool os_avx512 = false;
+    if ((ecx & (1u << 27)) && (ecx & (1u << 28))) {
+        uint64_t xcr0 = fossil_hostsys_xgetbv();
+        os_avx = (xcr0 & 0x6) == 0x6;
+        os_avx512 = os_avx && (xcr0 & 0xE0) == 0xE0;
+    }
+    if (os_avx) {
+        features |= FOSSIL_HOSTSYS_FEATURE_AVX;
+        if (ecx & (1u << 29)) features |= FOSSIL_HOSTSYS_FEATURE_F16C;
+        if (ecx & (1u << 12)) features |= FOSSIL_HOSTSYS_FEATURE_FMA;
+    }
+
+    if (max_leaf >= 7) {
+        fossil_hostsys_cpuid(7, 0, regs);
+        uint32_t ebx = regs[1];
+        ecx = regs[2];
+        if (ebx & (1u << 3))  features |= FOSSIL_HOSTSYS_FEATURE_BMI1;
+        if (ebx & (1u << 8))  features |= FOSSIL_HOSTSYS_FEATURE_BMI2;
+        if (ebx & (1u << 29)) features |= FOSSIL_HOSTSYS_FEATURE_SHA;
+        if (os_avx && (ebx & (1u << 5))) features |= FOSSIL_HOSTSYS_FEATURE_AVX2;
+        if (os_avx512 && (ebx & (1u << 16))) {
+            features |= FOSSIL_HOSTSYS_FEATURE_AVX512F;
+            if (ebx & (1u << 17)) features |= FOSSIL_HOSTSYS_FEATURE_AVX512DQ;
+            if (ebx & (1u << 30)) features |= FOSSIL_HOSTSYS_FEATURE_AVX512BW;
+            if (ebx & (1u << 31)) features |= FOSSIL_HOSTSYS_FEATURE_AVX512VL;
+            if (ecx & (1u << 11)) features |= FOSSIL_HOSTSYS_FEATURE_AVX512VNNI;
+        }
+    }
+    return features;
+}
+
+#elif defined(_FOSSIL_HOSTSYS_ARM)
+// Bits of AT_HWCAP and AT_HWCAP2, spelled out so older headers suffice
+enum {
+    _FOSSIL_HOSTSYS_HWCAP_ASIMD   = 1 << 1,
+    _FOSSIL_HOSTSYS_HWCAP_AES     = 1 << 3,
+    _FOSSIL_HOSTSYS_HWCAP_SHA2    = 1 << 6,
+    _FOSSIL_HOSTSYS_HWCAP_CRC32   = 1 << 7,
+    _FOSSIL_HOSTSYS_HWCAP_ATOMICS = 1 << 8,
+    _FOSSIL_HOSTSYS_HWCAP_ASIMDDP = 1 << 20,
+    _FOSSIL_HOSTSYS_HWCAP_SVE     = 1 << 22,
+    _FOSSIL_HOSTSYS_HWCAP2_SVE2   = 1 << 1,
+    _FOSSIL_HOSTSYS_HWCAP_NEON32  = 1 << 12,   // 32-bit ARM
+    _FOSSIL_HOSTSYS_HWCAP2_AES32  = 1 << 0,
+    _FOSSIL_HOSTSYS_HWCAP2_SHA232 = 1 << 3,
+    _FOSSIL_HOSTSYS_HWCAP2_CRC32  = 1 << 4
+};
+
+#ifdef __APPLE__
+static bool fossil_hostsys_sysctl_flag(const char *name) {
+    int32_t value = 0;
+    size_t len = sizeof(value);
+    return sysctlbyname(name, &value, &len, NULL, 0) == 0 && value != 0;
+}
+#endif
+
+static uint64_t fossil_hostsys_detect_features(void) {
+    uint64_t features = 0;
+#if defined(__linux__) && defined(__aarch64__)
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    unsigned long hwcap2 = getauxval(AT_HWCAP2);
+    if (hwcap & _FOSSIL_HOSTSYS_HWCAP_ASIMD)   features |= FOSSIL_HOSTSYS_FEATURE_NEON;
+    if (hwcap & _FOSSIL_HOSTSYS_HWCAP_AES)     features |= FOSSIL_HOSTSYS_FEATURE_ARM_AES;
+    if (hwcap & _FOSSIL_HOSTSYS_HWCAP_SHA2)    features |= FOSSIL_HOSTSYS_FEATURE_ARM_SHA2;
+    if (hwcap & _FOSSIL_HOSTSYS_HWCAP_CRC32)   features |= FOSSIL_HOSTSYS_FEATURE_ARM_CRC32;
+    if (hwcap & _FOSSIL_HOSTSYS_HWCAP_ATOMICS) features |= FOSSIL_HOSTSYS_FEATURE_ARM_ATOMICS;
+    if (hwcap & _FOSSIL_HOSTSYS_HWCAP_ASIMDDP) features |= FOSSIL_HOSTSYS_FEATURE_ARM_DOTPROD;
+    if (hwcap & _FOSSIL_HOSTSYS_HWCAP_SVE)     features |= FOSSIL_HOSTSYS_FEATURE_SVE;
+    if (hwcap2 & _FOSSIL_HOSTSYS_HWCAP2_SVE2)  features |= FOSSIL_HOSTSYS_FEATURE_SVE2;
+#elif defined(__linux__)
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    unsigned long hwcap2 = getauxval(AT_HWCAP2);
+    if (hwcap & _FOSSIL_HOSTSYS_HWCAP_NEON32)   features |= FOSSIL_HOSTSYS_FEATURE_NEON;
+    if (hwcap2 & _FOSSIL_HOSTSYS_HWCAP2_AES32)  features |= FOSSIL_HOSTSYS_FEATURE_ARM_AES;
+    if (hwcap2 & _FOSSIL_HOSTSYS_HWCAP2_SHA232) features |= FOSSIL_HOSTSYS_FEATURE_ARM_SHA2;
+    if (hwcap2 & _FOSSIL_HOSTSYS_HWCAP2_CRC32)  features |= FOSSIL_HOSTSYS_FEATURE_ARM_CRC32;
+#elif defined(__APPLE__)
+    // Every Apple silicon core has the ARMv8 crypto and CRC extensions
+    features |= FOSSIL_HOSTSYS_FEATURE_NEON | FOSSIL_HOSTSYS_FEATURE_ARM_AES |
+                FOSSIL_HOSTSYS_FEATURE_ARM_SHA2 | FOSSIL_HOSTSYS_FEATURE_ARM_CRC32;
+    if (fossil_hostsys_sysctl_flag("hw.optional.armv8_1_atomics")) features |= FOSSIL_HOSTSYS_FEATURE_ARM_ATOMICS;
+    if (fossil_hostsys_sysctl_flag("hw.optional.arm.FEAT_DotProd")) features |= FOSSIL_HOSTSYS_FEATURE_ARM_DOTPROD;
+#elif defined(_WIN32)
+    features |= FOSSIL_HOSTSYS_FEATURE_NEON;
+    if (IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE)) {
+        features |= FOSSIL_HOSTSYS_FEATURE_ARM_AES | FOSSIL_HOSTSYS_FEATURE_ARM_SHA2;
+    }
+    if (IsProcessorFeaturePresent(PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE)) features |= FOSSIL_HOSTSYS_FEATURE_ARM_CRC32;
+#elif defined(__aarch64__)
+    features |= FOSSIL_HOSTSYS_FEATURE_NEON;   // mandatory in ARMv8-A
+#endif
+    return features;
+}
+
+#else
+static uint64_t fossil_hostsys_detect_features(void) {
+    return 0;
+}
+#endif
+
+static uint64_t fossil_hostsys_cpu_features;
+
+#ifdef _WIN32
+static INIT_ONCE fossil_hostsys_features_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK fossil_hostsys_features_init(PINIT_ONCE once, PVOID parameter, PVOID *context) {
+    (void)once;
+    (void)parameter;
+    (void)context;
+    fossil_hostsys_cpu_features = fossil_hostsys_detect_features();
+    return TRUE;
+}
+#else
+static pthread_once_t fossil_hostsys_features_once = PTHREAD_ONCE_INIT;
+
+static void fossil_hostsys_features_init(void) {
+    fossil_hostsys_cpu_features = fossil_hostsys_detect_features();
+}
+#endif
+
+uint64_t fossil_hostsys_features(void) {
+#ifdef _WIN32
+    InitOnceExecuteOnce(&fossil_hostsys_features_once, fossil_hostsys_features_init, NULL, NULL);
+#else
+    pthread_once(&fossil_hostsys_features_once, fossil_hostsys_features_init);
+#endif
+    return fossil_hostsys_cpu_features;
+}
+
+bool fossil_hostsys_has_features(uint64_t features) {
+    return (fossil_hostsys_features() & features) == features;
+}
+
+static const struct {
+    uint64_t feature;
+    const char *name;
+} fossil_hostsys_feature_names[] = {
+    {FOSSIL_HOSTSYS_FEATURE_SSE2, "sse2"},
+    {FOSSIL_HOSTSYS_FEATURE_SSE3, "sse3"},
+    {FOSSIL_HOSTSYS_FEATURE_SSSE3, "ssse3"},
+    {FOSSIL_HOSTSYS_FEATURE_SSE41, "sse4.1"},
+    {FOSSIL_HOSTSYS_FEATURE_SSE42, "sse4.2"},
+    {FOSSIL_HOSTSYS_FEATURE_POPCNT, "popcnt"},
+    {FOSSIL_HOSTSYS_FEATURE_AES, "aes"},
+    {FOSSIL_HOSTSYS_FEATURE_PCLMUL, "pclmul"},
+    {FOSSIL_HOSTSYS_FEATURE_AVX, "avx"},
+    {FOSSIL_HOSTSYS_FEATURE_F16C, "f16c"},
+    {FOSSIL_HOSTSYS_FEATURE_FMA, "fma"},
+    {FOSSIL_HOSTSYS_FEATURE_AVX2, "avx2"},
+    {FOSSIL_HOSTSYS_FEATURE_BMI1, "bmi1"},
+    {FOSSIL_HOSTSYS_FEATURE_BMI2, "bmi2"},
+    {FOSSIL_HOSTSYS_FEATURE_SHA, "sha"},
+    {FOSSIL_HOSTSYS_FEATURE_AVX512F, "avx512f"},
+    {FOSSIL_HOSTSYS_FEATURE_AVX512DQ, "avx512dq"},
+    {FOSSIL_HOSTSYS_FEATURE_AVX512BW, "avx512bw"},
+    {FOSSIL_HOSTSYS_FEATURE_AVX512VL, "avx512vl"},
+    {FOSSIL_HOSTSYS_FEATURE_AVX512VNNI, "avx512vnni"},
+    {FOSSIL_HOSTSYS_FEATURE_NEON, "neon"},
+    {FOSSIL_HOSTSYS_FEATURE_ARM_AES, "arm-aes"},
+    {FOSSIL_HOSTSYS_FEATURE_ARM_SHA2, "arm-sha2"},
+    {FOSSIL_HOSTSYS_FEATURE_ARM_CRC32, "arm-crc32"},
+    {FOSSIL_HOSTSYS_FEATURE_ARM_ATOMICS, "arm-atomics"},
+    {FOSSIL_HOSTSYS_FEATURE_ARM_DOTPROD, "arm-dotprod"},
+    {FOSSIL_HOSTSYS_FEATURE_SVE, "sve"},
+    {FOSSIL_HOSTSYS_FEATURE_SVE2, "sve2"}
+};
+
+const char* fossil_hostsys_feature_name(uint64_t feature) {
+    for (size_t i = 0; i < sizeof(fossil_hostsys_feature_names) / sizeof(fossil_hostsys_feature_names[0]); ++i) {
+        if (fossil_hostsys_feature_names[i].feature == feature) {
+            return fossil_hostsys_feature_names[i].name;
+        }
+    }
+    return NULL;
+}
+
+size_t fossil_hostsys_feature_string(uint64_t features, char *buffer, size_t size) {
+    size_t length = 0;
+    for (size_t i = 0; i < sizeof(fossil_hostsys_feature_names) / sizeof(fossil_hostsys_feature_names[0]); ++i) {
+        if (!(features & fossil_hostsys_feature_names[i].feature)) {
+            continue;
+        }
+        const char *name = fossil_hostsys_feature_names[i].name;
+        size_t name_length = strlen(name);
+        if (length > 0) {
+            if (length + 1 < size) {
+                buffer[length] = ' ';
+            }
+            ++length;
+        }
+        if (length < size) {
+            size_t room = size - 1 - length;
+            memcpy(buffer + length, name, name_length < room ? name_length : room);
+        }
+        length += name_length;
+    }
+    if (size > 0) {
+        buffer[length < size ? length : size - 1] = '\0';
+    }
+    return length;
+}
+
+// * * * * * * * * * * * * * * * * * * * * * * * *
+// * Effective resources
+// * * * * * * * * * * * * * * * * * * * * * * * *
+
+static int64_t fossil_hostsys_physical_memory(void) {
+#ifdef _WIN32
+    MEMORYSTATUSEX memInfo;
+    memInfo.dwLength = sizeof(MEMORYSTATUSEX);
+    return GlobalMemoryStatusEx(&memInfo) ? (int64_t)memInfo.ullTotalPhys : 0;
+#elif defined(__APPLE__)
+    int64_t size = 0;
+    size_t len = sizeof(size);
+    return sysctlbyname("hw.memsize", &size, &len, NULL, 0) == 0 ? size : 0;
+#elif defined(_SC_PHYS_PAGES)
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGE_SIZE);
+    return (pages > 0 && page_size > 0) ? (int64_t)pages * page_size : 0;
+#else
+    return 0;
+#endif
+}
+
+static int32_t fossil_hostsys_affinity_cpus(void) {
+#ifdef __linux__
+    for (int cpus = 1024; cpus <= (1 << 20); cpus *= 2) {
+        cpu_set_t *set = CPU_ALLOC(cpus);
+        size_t size = CPU_ALLOC_SIZE(cpus);
+        if (!set) {
+            break;
+        }
+        // The main thread's mask, so threads that pin themselves do not narrow it for
+        // everyone; a main thread that pins itself does narrow it
+        if (sched_getaffinity(getpid(), size, set) == 0) {
+            int32_t count = (int32_t)CPU_COUNT_S(size, set);
+            CPU_FREE(set);
+            return count;
+        }
+        CPU_FREE(set);
+        if (errno != EINVAL) {
+            break;   // EINVAL means the kernel's mask is larger than ours
+        }
+    }
+#elif defined(_WIN32)
+    DWORD_PTR process_mask, system_mask;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) {
+        int32_t count = 0;
+        for (; process_mask; process_mask &= process_mask - 1) {
+            ++count;
+        }
+        return count;
+    }
+#endif
+    return fossil_hostsys_online_cpus();
+}
+
+#ifdef __linux__
+// Numbers such as memory.max; "max" and v1's page-rounded LLONG_MAX are no limit
+static int64_t fossil_hostsys_parse_limit(const char *text) {
+    if (strncmp(text, "max", 3) == 0) {
+        return 0;
+    }
+    char *end;
+    long long value = strtoll(text, &end, 10);
+    return (end == text || value <= 0 || value >= (1LL << 62)) ? 0 : (int64_t)value;
+}
+
+static void fossil_hostsys_narrow(int64_t *limit, int64_t value) {
+    if (value > 0 && (*limit == 0 || value < *limit)) {
+        *limit = value;
+    }
+}
+
+static void fossil_hostsys_narrow_quota(double *quota, double value) {
+    if (value > 0 && (*quota == 0 || value < *quota)) {
+        *quota = value;
+    }
+}
+
+// Limits set in one cgroup directory, v2 and v1 file names alike
+static void fossil_hostsys_read_cgroup(const char *dir, fossil_hostsys_limits_t *limits) {
+    char path[_FOSSIL_HOSTSYS_PATH];
+    char text[128];
+
+    snprintf(path, sizeof(path), "%s/cpu.max", dir);
+    if (fossil_hostsys_read_text(path, text, sizeof(text)) > 0 && strncmp(text, "max", 3) != 0) {
+        char *end;
+        double quota = strtod(text, &end);
+        double period = strtod(end, NULL);
+        if (quota > 0 && period > 0) {
+            fossil_hostsys_narrow_quota(&limits->cpu_quota, quota / period);
+        }
+    }
+    snprintf(path, sizeof(path), "%s/cpu.cfs_quota_us", dir);
+    if (fossil_hostsys_read_text(path, text, sizeof(text)) > 0) {
+        double quota = strtod(text, NULL);
+        snprintf(path, sizeof(path), "%s/cpu.cfs_period_us", dir);
+        if (quota > 0 && fossil_hostsys_read_text(path, text, sizeof(text)) > 0 && strtod(text, NULL) > 0) {
+            fossil_hostsys_narrow_quota(&limits->cpu_quota, quota / strtod(text, NULL));
+        }
+    }
+
+    static const char *const memory_max_files[] = {"memory.max", "memory.limit_in_bytes"};
+    for (size_t i = 0; i < 2; ++i) {
+        snprintf(path, sizeof(path), "%s/%s", dir, memory_max_files[i]);
+        if (fossil_hostsys_read_text(path, text, sizeof(text)) > 0) {
+            fossil_hostsys_narrow(&limits->memory_max, fossil_hostsys_parse_limit(text));
+        }
+    }
+    snprintf(path, sizeof(path), "%s/memory.high", dir);
+    if (fossil_hostsys_read_text(path, text, sizeof(text)) > 0) {
+        fossil_hostsys_narrow(&limits->memory_high, fossil_hostsys_parse_limit(text));
+    }
+}
+
+// Reads a cgroup and its ancestors up to the mount point
+static void fossil_hostsys_read_cgroup_tree(const char *mount, const char *group, fossil_hostsys_limits_t *limits) {
+    char dir[_FOSSIL_HOSTSYS_PATH];
+    if (snprintf(dir, sizeof(dir), "%s%s", mount, strcmp(group, "/") == 0 ? "" : group) >= (int)sizeof(dir)) {
+        return;
+    }
+    size_t mount_length = strlen(mount);
+    for (;;) {
+        fossil_hostsys_read_cgroup(dir, limits);
+        char *slash = strrchr(dir, '/');
+        if (!slash || (size_t)(slash - dir) < mount_length) {
+            break;
+        }
+        *slash = '\0';
+    }
+}
+
+static bool fossil_hostsys_controller_listed(const char *controllers, size_t length, const char *name) {
+    size_t name_length = strlen(name);
+    const char *end = controllers + length;
+    for (const char *p = controllers; p < end;) {
+        const char *comma = memchr(p, ',', (size_t)(end - p));
+        size_t token = (size_t)((comma ? comma : end) - p);
+        if (token == name_length && memcmp(p, name, name_length) == 0) {
+            return true;
+        }
+        p += token + 1;
+    }
+    return false;
+}
+
+static void fossil_hostsys_read_own_cgroups(fossil_hostsys_limits_t *limits) {
+    char text[4096];
+    if (fossil_hostsys_read_text("/proc/self/cgroup", text, sizeof(text)) <= 0) {
+        return;
+    }
+
+    // Lines are "id:controllers:path"; id 0 with no controllers is cgroup v2
+    for (char *line = text; line && *line;) {
+        char *next = strchr(line, '\n');
+        if (next) {
+            *next++ = '\0';
+        }
+        char *first = strchr(line, ':');
+        char *second = first ? strchr(first + 1, ':') : NULL;
+        if (second) {
+            const char *controllers = first + 1;
+            size_t length = (size_t)(second - controllers);
+            const char *group = second + 1;
+            if (length == 0) {
+                const char *mount = access("/sys/fs/cgroup/cgroup.controllers", F_OK) == 0 ? "/sys/fs/cgroup" : "/sys/fs/cgroup/unified";
+                fossil_hostsys_read_cgroup_tree(mount, group, limits);
+            } else {
+                if (fossil_hostsys_controller_listed(controllers, length, "cpu")) {
+                    const char *mount = access("/sys/fs/cgroup/cpu", F_OK) == 0 ? "/sys/fs/cgroup/cpu" : "/sys/fs/cgroup/cpu,cpuacct";
+                    fossil_hostsys_read_cgroup_tree(mount, group, limits);
+                }
+                if (fossil_hostsys_controller_listed(controllers, length, "memory")) {
+                    fossil_hostsys_read_cgroup_tree("/sys/fs/cgroup/memory", group, limits);
+                }
+            }
+        }
+        line = next;
+    }
+}
+#endif
+
+bool fossil_hostsys_limits_load(const char *cgroup_dir, fossil_hostsys_limits_t *limits) {
+    if (!limits) {
+        return false;
+    }
+    memset(limits, 0, sizeof(*limits));
+    limits->affinity_cpus = fossil_hostsys_affinity_cpus();
+
+#ifdef __linux__
+    if (cgroup_dir) {
+        if (access(cgroup_dir, F_OK) != 0) {
+            return false;
+        }
+        fossil_hostsys_read_cgroup(cgroup_dir, limits);
+    } else {
+        fossil_hostsys_read_own_cgroups(limits);
+    }
+#else
+    if (cgroup_dir) {
+        return false;
+    }
+#endif
+
+    limits->effective_cpus = limits->affinity_cpus > 0 ? limits->affinity_cpus : 1;
+    if (limits->cpu_quota > 0) {
+        double quota = limits->cpu_quota;
+        int32_t quota_cpus = (int32_t)quota;
+        quota_cpus += (double)quota_cpus < quota;   // round up, a fraction still runs
+        if (quota_cpus < 1) {
+            quota_cpus = 1;
+        }
+        if (quota_cpus < limits->effective_cpus) {
+            limits->effective_cpus = quota_cpus;
+        }
+    }
+
+    limits->effective_memory = fossil_hostsys_physical_memory();
+    int64_t caps[2] = {limits->memory_max, limits->memory_high};
+    for (size_t i = 0; i < 2; ++i) {
+        if (caps[i] > 0 && (limits->effective_memory == 0 || caps[i] < limits->effective_memory)) {
+            limits->effective_memory = caps[i];
+        }
+    }
+    return true;
+}
+
+// * * * * * * * * * * * * * * * * * * * * * * * *
+// * Timing
+// * * * * * * * * * * * * * * * * * * * * * * * *
+
+enum {
+    _FOSSIL_HOSTSYS_CALIBRATION = 5000000   // span of the counter calibration, in ns
+};
+
+#if defined(_FOSSIL_HOSTSYS_X86) || defined(__aarch64__)
+    #define _FOSSIL_HOSTSYS_COUNTER 1
+#endif
+
+static int64_t fossil_hostsys_monotonic_ns(void) {
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (int64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);   // served by the vDSO on Linux
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+#endif
+}
+
+#ifdef _FOSSIL_HOSTSYS_COUNTER
+static uint64_t fossil_hostsys_counter(void) {
+#if defined(_FOSSIL_HOSTSYS_X86) && defined(_MSC_VER)
+    return __rdtsc();
+#elif defined(_FOSSIL_HOSTSYS_X86)
+    return __builtin_ia32_rdtsc();
+#else
+    uint64_t value;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#endif
+}
+#endif
+
+// Calibration, filled once
+static bool fossil_hostsys_clock_counter = false;   // ticks come from the counter rather than the monotonic clock
+static bool fossil_hostsys_clock_invariant = false;
+static int64_t fossil_hostsys_clock_frequency = 1000000000;
+static uint64_t fossil_hostsys_clock_base_ticks;
+static int64_t fossil_hostsys_clock_base_ns;
+
+#ifdef _FOSSIL_HOSTSYS_COUNTER
+static int64_t fossil_hostsys_counter_rate(void) {
+#ifdef _FOSSIL_HOSTSYS_X86
+    uint32_t regs[4];
+    fossil_hostsys_cpuid(0x80000000, 0, regs);
+    if (regs[0] >= 0x80000007) {
+        fossil_hostsys_cpuid(0x80000007, 0, regs);
+        fossil_hostsys_clock_invariant = (regs[3] >> 8) & 1;
+    }
+#ifdef __linux__
+    // Hypervisors often hide the CPUID bit; the kernel only picks a TSC it trusts
+    char source[32];
+    if (!fossil_hostsys_clock_invariant &&
+        fossil_hostsys_read_text("/sys/devices/system/clocksource/clocksource0/current_clocksource", source, sizeof(source)) > 0) {
+        fossil_hostsys_clock_invariant = strncmp(source, "tsc", 3) == 0;
+    }
+#endif
+    if (!fossil_hostsys_clock_invariant) {
+        return 0;
+    }
+    // Leaf 0x15 gives the exact rate on recent Intel parts
+    fossil_hostsys_cpuid(0, 0, regs);
+    if (regs[0] >= 0x15) {
+        fossil_hostsys_cpuid(0x15, 0, regs);
+        if (regs[0] && regs[1] && regs[2]) {
+            return (int64_t)((uint64_t)regs[2] * regs[1] / regs[0]);
+        }
+    }
+    return -1;
+#else
+    // The generic timer runs at a fixed rate the firmware publishes
+    uint64_t rate;
+    __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(rate));
+    fossil_hostsys_clock_invariant = true;
+    return rate ? (int64_t)rate : -1;
+#endif
+}
+#endif
+
+static uint64_t fossil_hostsys_read_ticks(void) {
+#ifdef _FOSSIL_HOSTSYS_COUNTER
+    if (fossil_hostsys_clock_counter) {
+        return fossil_hostsys_counter();
+    }
+#endif
+    return (uint64_t)fossil_hostsys_monotonic_ns();
+}
+
+// Pairs a tick reading with the monotonic time, keeping the tightest of a few brackets
+static void fossil_hostsys_clock_pair(uint64_t *ticks, int64_t *ns) {
+    int64_t best = INT64_MAX;
+    for (int attempt = 0; attempt < 5; ++attempt) {
+        int64_t before = fossil_hostsys_monotonic_ns();
+        uint64_t reading = fossil_hostsys_read_ticks();
+        int64_t after = fossil_hostsys_monotonic_ns();
+        if (after - before < best) {
+            best = after - before;
+            *ticks = reading;
+            *ns = before + (after - before) / 2;
+        }
+    }
+}
+
+static void fossil_hostsys_clock_calibrate(void) {
+#ifdef _FOSSIL_HOSTSYS_COUNTER
+    int64_t rate = fossil_hostsys_counter_rate();
+    if (rate != 0) {
+        fossil_hostsys_clock_counter = true;
+    }
+    if (rate < 0) {
+        // Measure the rate against the monotonic clock
+        uint64_t start, now;
+        int64_t start_ns, now_ns;
+        fossil_hostsys_clock_pair(&start, &start_ns);
+        while (fossil_hostsys_monotonic_ns() - start_ns < _FOSSIL_HOSTSYS_CALIBRATION) {
+        }
+        fossil_hostsys_clock_pair(&now, &now_ns);
+        rate = (int64_t)((double)(now - start) * 1e9 / (double)(now_ns - start_ns));
+    }
+    if (rate > 0) {
+        fossil_hostsys_clock_frequency = rate;
+    } else {
+        fossil_hostsys_clock_counter = false;
+    }
+#endif
+    fossil_hostsys_clock_pair(&fossil_hostsys_clock_base_ticks, &fossil_hostsys_clock_base_ns);
+}
+
+#ifdef _WIN32
+static INIT_ONCE fossil_hostsys_clock_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK fossil_hostsys_clock_init(PINIT_ONCE once, PVOID parameter, PVOID *context) {
+    (void)once;
+    (void)parameter;
+    (void)context;
+    fossil_hostsys_clock_calibrate();
+    return TRUE;
+}
+
+    #define _FOSSIL_HOSTSYS_CLOCK_ONCE() InitOnceExecuteOnce(&fossil_hostsys_clock_once, fossil_hostsys_clock_init, NULL, NULL)
+#else
+static pthread_once_t fossil_hostsys_clock_once = PTHREAD_ONCE_INIT;
+
+    #define _FOSSIL_HOSTSYS_CLOCK_ONCE() pthread_once(&fossil_hostsys_clock_once, fossil_hostsys_clock_calibrate)
+#endif
+
+uint64_t fossil_hostsys_ticks(void) {
+    _FOSSIL_HOSTSYS_CLOCK_ONCE();
+    return fossil_hostsys_read_ticks();
+}
+
+int64_t fossil_hostsys_ticks_to_ns(uint64_t ticks) {
+    _FOSSIL_HOSTSYS_CLOCK_ONCE();
+    // Whole seconds, then the remainder rounded to the nearest ns; exact for rates up to 18 GHz
+    uint64_t rate = (uint64_t)fossil_hostsys_clock_frequency;
+    return (int64_t)(ticks / rate * 1000000000 + ((ticks % rate) * 1000000000 + rate / 2) / rate);
+}
+
+int64_t fossil_hostsys_now_ns(void) {
+    _FOSSIL_HOSTSYS_CLOCK_ONCE();
+    return fossil_hostsys_clock_base_ns + fossil_hostsys_ticks_to_ns(fossil_hostsys_read_ticks() - fossil_hostsys_clock_base_ticks);
+}
+
+int64_t fossil_hostsys_timer_frequency(void) {
+    _FOSSIL_HOSTSYS_CLOCK_ONCE();
+    return fossil_hostsys_clock_frequency;
+}
+
+bool fossil_hostsys_invariant_tsc(void) {
+    _FOSSIL_HOSTSYS_CLOCK_ONCE();
+    return fossil_hostsys_clock_invariant;
+}
+
+void fossil_hostsys_timer_start(fossil_hostsys_timer_t *timer) {
+    timer->start = fossil_hostsys_ticks();
+}
+
+int64_t fossil_hostsys_timer_elapsed_ns(const fossil_hostsys_timer_t *timer) {
+    return fossil_hostsys_ticks_to_ns(fossil_hostsys_ticks() - timer->start);
+}
+
+int64_t fossil_hostsys_timer_lap_ns(fossil_hostsys_timer_t *timer) {
+    uint64_t now = fossil_hostsys_ticks();
+    int64_t elapsed = fossil_hostsys_ticks_to_ns(now - timer->start);
+    timer->start = now;
+    return elapsed;
+}
+
+// * * * * * * * * * * * * * * * * * * * * * * * *
+// * Cached snapshot
+// * * * * * * * * * * * * * * * * * * * * * * * *
+
+enum {
+    _FOSSIL_HOSTSYS_LIMITS_STALENESS = 1000000000   // age limit of the affinity and cgroup limits, in ns
+};
+
+static fossil_hostsystem_t fossil_hostsys_snapshot;
+static bool fossil_hostsys_snapshot_loaded = false;
+static bool fossil_hostsys_snapshot_fresh = false;
+static bool fossil_hostsys_limits_fresh = false;
+static int64_t fossil_hostsys_refreshed_at;
+static int64_t fossil_hostsys_limits_at;
+static int64_t fossil_hostsys_staleness = _FOSSIL_HOSTSYS_STALENESS;
+
+#ifdef _WIN32
+static SRWLOCK fossil_hostsys_snapshot_lock = SRWLOCK_INIT;
+    #define _FOSSIL_HOSTSYS_LOCK()   AcquireSRWLockExclusive(&fossil_hostsys_snapshot_lock)
+    #define _FOSSIL_HOSTSYS_UNLOCK() ReleaseSRWLockExclusive(&fossil_hostsys_snapshot_lock)
+#else
+static pthread_mutex_t fossil_hostsys_snapshot_lock = PTHREAD_MUTEX_INITIALIZER;
+    #define _FOSSIL_HOSTSYS_LOCK()   pthread_mutex_lock(&fossil_hostsys_snapshot_lock)
+    #define _FOSSIL_HOSTSYS_UNLOCK() pthread_mutex_unlock(&fossil_hostsys_snapshot_lock)
+#endif
+
+// Fields that do not change while the process runs
+static bool fossil_hostsys_load_static(fossil_hostsystem_t *info) {
+    bool result = false;
+
+    #ifdef _WIN32
+        result = fossil_hostsys_get_windows(info);
+    #elif __linux__
+        result = fossil_hostsys_get_linux(info);
+    #elif __APPLE__
+        result = fossil_hostsys_get_macos(info);
+    #else
+        fprintf(stderr, "Unsupported platform\n");
+    #endif
+
+    if (result) {
+        fossil_hostsys_get_topology(info);
+        info->cpu_features = fossil_hostsys_features();
+        info->timer_frequency = fossil_hostsys_timer_frequency();
+        info->invariant_tsc = fossil_hostsys_invariant_tsc();
+        return fossil_hostsys_get_endian(info);
+    } else {
+        return false;
+    }
+}
+
+static bool fossil_hostsys_refresh(fossil_hostsystem_t *info, int64_t now) {
+    // Affinity and cgroup limits can change while the process runs, but walking
+    // the cgroup tree costs far more than the counters, so they age on their own clock
+    if (!fossil_hostsys_limits_fresh || now - fossil_hostsys_limits_at > _FOSSIL_HOSTSYS_LIMITS_STALENESS) {
+        fossil_hostsys_limits_t limits;
+        fossil_hostsys_limits_fresh = fossil_hostsys_limits_load(NULL, &limits);
+        fossil_hostsys_limits_at = now;
+        info->effective_cpus = limits.effective_cpus;
+        info->effective_memory = limits.effective_memory / (1024 * 1024);  // in MB
+    }
+
+    #ifdef _WIN32
+        return fossil_hostsys_refresh_windows(info);
+    #elif __linux__
+        return fossil_hostsys_refresh_linux(info);
+    #elif __APPLE__
+        return fossil_hostsys_refresh_macos(info);
+    #else
+        return false;
+    #endif
+}
+
+bool fossil_hostsys_get(fossil_hostsystem_t *info) {
+    bool result = true;
+
+    if (!info) {
+        return false;
+    }
+
+    _FOSSIL_HOSTSYS_LOCK();
+    if (!fossil_hostsys_snapshot_loaded) {
+        fossil_hostsys_snapshot_loaded = fossil_hostsys_load_static(&fossil_hostsys_snapshot);
+        result = fossil_hostsys_snapshot_loaded;
+    }
+    if (result) {
+        int64_t now = fossil_hostsys_monotonic_ns();
+        if (!fossil_hostsys_snapshot_fresh || now - fossil_hostsys_refreshed_at > fossil_hostsys_staleness) {
+            result = fossil_hostsys_refresh(&fossil_hostsys_snapshot, now);
+            fossil_hostsys_snapshot_fresh = result;
+            fossil_hostsys_refreshed_at = now;
+        }
+    }
+    memcpy(info, &fossil_hostsys_snapshot, sizeof(*info));
+    _FOSSIL_HOSTSYS_UNLOCK();
+    return result;
+}
+
+void fossil_hostsys_set_staleness(int64_t nanoseconds) {
+    _FOSSIL_HOSTSYS_LOCK();
+    fossil_hostsys_staleness = nanoseconds > 0 ? nanoseconds : 0;
+    _FOSSIL_HOSTSYS_UNLOCK();
+}
+
+// * * * * * * * * * * * * * * * * * * * * * * * *
+// * Telemetry sampler
+// * * * * * * * * * * * * * * * * * * * * * * * *
+
+enum {
+    _FOSSIL_HOSTSYS_SOURCE_STAT,
+    _FOSSIL_HOSTSYS_SOURCE_MEMINFO,
+    _FOSSIL_HOSTSYS_SOURCE_DISKSTATS,
+    _FOSSIL_HOSTSYS_SOURCE_NETDEV,
+    _FOSSIL_HOSTSYS_SOURCE_PRESSURE_CPU,
+    _FOSSIL_HOSTSYS_SOURCE_PRESSURE_MEMORY,
+    _FOSSIL_HOSTSYS_SOURCE_PRESSURE_IO,
+    _FOSSIL_HOSTSYS_SOURCES
+};
+
+#ifdef __linux__
+static const char *const fossil_hostsys_source_paths[_FOSSIL_HOSTSYS_SOURCES] = {
+    "/proc/stat", "/proc/meminfo", "/proc/diskstats", "/proc/net/dev",
+    "/proc/pressure/cpu", "/proc/pressure/memory", "/proc/pressure/io"
+};
+#endif
+
+// Counter totals of one CPU, or of all CPUs, at the previous sample
+typedef struct {
+    uint64_t total;
+    uint64_t idle;
+    uint64_t iowait;
+} fossil_hostsys_cpu_times_t;
+
+struct fossil_hostsys_sampler {
+    // Published under the sequence lock: odd while the sampler writes
+    uint64_t sequence;
+    fossil_hostsys_sample_t sample;
+    float *cpu_busy;
+    int32_t slots;
+
+    // Owned by the sampler thread
+    int64_t interval;
+    int fds[_FOSSIL_HOSTSYS_SOURCES];
+    char *buffer;
+    size_t buffer_size;
+    fossil_hostsys_sample_t staging;
+    float *staging_busy;
+    fossil_hostsys_cpu_times_t all_times;
+    fossil_hostsys_cpu_times_t *cpu_times;
+    uint64_t disk_read;
+    uint64_t disk_write;
+    uint64_t net_receive;
+    uint64_t net_transmit;
+    int64_t sampled_at;
+
+#ifdef _WIN32
+    HANDLE thread;
+    SRWLOCK lock;
+    CONDITION_VARIABLE wake;
+#else
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+#endif
+    bool stopping;
+};
+
+#ifdef __linux__
+static const char* fossil_hostsys_sampler_load(fossil_hostsys_sampler_t *sampler, int32_t source) {
+    if (sampler->fds[source] < 0) {
+        return NULL;
+    }
+    ssize_t length = pread(sampler->fds[source], sampler->buffer, sampler->buffer_size - 1, 0);
+    if (length <= 0) {
+        return NULL;
+    }
+    sampler->buffer[length] = '\0';
+    return sampler->buffer;
+}
+
+static double fossil_hostsys_fraction(uint64_t part, uint64_t whole) {
+    return whole ? (double)part / (double)whole : 0.0;
+}
+
+static void fossil_hostsys_sampler_stat(fossil_hostsys_sampler_t *sampler, bool baseline) {
+    const char *text = fossil_hostsys_sampler_load(sampler, _FOSSIL_HOSTSYS_SOURCE_STAT);
+
+    // The cpu lines come first; the long intr line after them is never parsed
+    for (const char *line = text; line && strncmp(line, "cpu", 3) == 0;) {
+        char *p = (char*)line + 3;
+        long cpu = -1;
+        if (*p >= '0' && *p <= '9') {
+            cpu = strtol(p, &p, 10);
+        }
+        uint64_t values[8];
+        uint64_t total = 0;
+        for (int32_t i = 0; i < 8; ++i) {
+            values[i] = strtoull(p, &p, 10);
+            total += values[i];   // user nice system idle iowait irq softirq steal
+        }
+        fossil_hostsys_cpu_times_t now = {total, values[3] + values[4], values[4]};
+        fossil_hostsys_cpu_times_t *last = cpu < 0 ? &sampler->all_times : (cpu < sampler->slots ? &sampler->cpu_times[cpu] : NULL);
+        if (last) {
+            uint64_t elapsed = now.total - last->total;
+            double busy = baseline ? 0.0 : 1.0 - fossil_hostsys_fraction(now.idle - last->idle, elapsed);
+            if (cpu < 0) {
+                sampler->staging.cpu_busy = busy;
+                sampler->staging.cpu_iowait = baseline ? 0.0 : fossil_hostsys_fraction(now.iowait - last->iowait, elapsed);
+            } else {
+                sampler->staging_busy[cpu] = (float)busy;
+            }
+            *last = now;
+        }
+        line = strchr(p, '\n');
+        line = line ? line + 1 : NULL;
+    }
+}
+
+static void fossil_hostsys_sampler_meminfo(fossil_hostsys_sampler_t *sampler) {
+    const char *text = fossil_hostsys_sampler_load(sampler, _FOSSIL_HOSTSYS_SOURCE_MEMINFO);
+    if (text) {
+        sampler->staging.memory_total = fossil_hostsys_meminfo_field(text, "MemTotal:") * 1024;
+        sampler->staging.memory_available = fossil_hostsys_meminfo_field(text, "MemAvailable:") * 1024;
+        sampler->staging.swap_used = (fossil_hostsys_meminfo_field(text, "SwapTotal:") -
+                                      fossil_hostsys_meminfo_field(text, "SwapFree:")) * 1024;
+    }
+}
+
+// Whole physical disks only; partitions and stacked devices would count twice
+static bool fossil_hostsys_physical_disk(const char *name, size_t length) {
+    static const char *const virtual_prefixes[] = {"loop", "ram", "zram", "dm-", "md", "sr"};
+    for (size_t i = 0; i < sizeof(virtual_prefixes) / sizeof(virtual_prefixes[0]); ++i) {
+        size_t prefix = strlen(virtual_prefixes[i]);
+        if (length >= prefix && strncmp(name, virtual_prefixes[i], prefix) == 0) {
+            return false;
+        }
+    }
+    // nvme0n1p2 and mmcblk0p1 partitions end in p and digits after a digit
+    size_t digits = length;
+    while (digits > 0 && name[digits - 1] >= '0' && name[digits - 1] <= '9') {
+        --digits;
+    }
+    if (digits < length && digits >= 2 && name[digits - 1] == 'p' && name[digits - 2] >= '0' && name[digits - 2] <= '9') {
+        return false;
+    }
+    // sda1, vdb2, xvda1: letters of a disk name followed by a partition number
+    bool letter_disk = strncmp(name, "sd", 2) == 0 || strncmp(name, "vd", 2) == 0 ||
+                       strncmp(name, "hd", 2) == 0 || strncmp(name, "xvd", 3) == 0;
+    return !(letter_disk && digits < length);
+}
+
+static void fossil_hostsys_sampler_diskstats(fossil_hostsys_sampler_t *sampler, double seconds, bool baseline) {
+    const char *text = fossil_hostsys_sampler_load(sampler, _FOSSIL_HOSTSYS_SOURCE_DISKSTATS);
+    uint64_t read_sectors = 0;
+    uint64_t written_sectors = 0;
+
+    for (const char *line = text; line && *line;) {
+        char *p = (char*)line;
+        strtoul(p, &p, 10);   // major
+        strtoul(p, &p, 10);   // minor
+        while (*p == ' ') {
+            ++p;
+        }
+        const char *name = p;
+        size_t length = strcspn(p, " \n");
+        p += length;
+        if (fossil_hostsys_physical_disk(name, length)) {
+            uint64_t fields[7];
+            for (int32_t i = 0; i < 7; ++i) {
+                fields[i] = strtoull(p, &p, 10);
+            }
+            read_sectors += fields[2];       // sectors read
+            written_sectors += fields[6];    // sectors written
+        }
+        line = strchr(p, '\n');
+        line = line ? line + 1 : NULL;
+    }
+
+    // diskstats counts 512-byte sectors whatever the device's block size
+    if (!baseline && seconds > 0) {
+        sampler->staging.disk_read_rate = (double)(read_sectors - sampler->disk_read) * 512.0 / seconds;
+        sampler->staging.disk_write_rate = (double)(written_sectors - sampler->disk_write) * 512.0 / seconds;
+    }
+    sampler->disk_read = read_sectors;
+    sampler->disk_write = written_sectors;
+}
+
+static void fossil_hostsys_sampler_netdev(fossil_hostsys_sampler_t *sampler, double seconds, bool baseline) {
+    const char *text = fossil_hostsys_sampler_load(sampler, _FOSSIL_HOSTSYS_SOURCE_NETDEV);
+    uint64_t received = 0;
+    uint64_t transmitted = 0;
+
+    for (const char *line = text; line && *line;) {
+        const char *colon = strchr(line, ':');
+        const char *end = strchr(line, '\n');
+        if (colon && (!end || colon < end)) {
+            const char *name = line;
+            while (*name == ' ') {
+                ++name;
+            }
+            if (!(colon - name == 2 && strncmp(name, "lo", 2) == 0)) {
+                char *p = (char*)colon + 1;
+                uint64_t fields[9];
+                for (int32_t i = 0; i < 9; ++i) {
+                    fields[i] = strtoull(p, &p, 10);
+                }
+                received += fields[0];
+                transmitted += fields[8];
+            }
+        }
+        line = end ? end + 1 : NULL;
+    }
+
+    if (!baseline && seconds > 0) {
+        sampler->staging.net_receive_rate = (double)(received - sampler->net_receive) / seconds;
+        sampler->staging.net_transmit_rate = (double)(transmitted - sampler->net_transmit) / seconds;
+    }
+    sampler->net_receive = received;
+    sampler->net_transmit = transmitted;
+}
+
+static double fossil_hostsys_sampler_pressure(fossil_hostsys_sampler_t *sampler, int32_t source) {
+    const char *text = fossil_hostsys_sampler_load(sampler, source);
+    const char *avg10 = text ? strstr(text, "some avg10=") : NULL;
+    return avg10 ? strtod(avg10 + 11, NULL) : 0.0;
+}
+#endif
+
+// Reads every source into the staging sample; the first call only sets the baseline
+static void fossil_hostsys_sampler_collect(fossil_hostsys_sampler_t *sampler, bool baseline) {
+    int64_t now = fossil_hostsys_monotonic_ns();
+    double seconds = (double)(now - sampler->sampled_at) / 1e9;
+
+    sampler->staging.timestamp = now;
+    sampler->sampled_at = now;
+#ifdef __linux__
+    fossil_hostsys_sampler_stat(sampler, baseline);
+    fossil_hostsys_sampler_meminfo(sampler);
+    fossil_hostsys_sampler_diskstats(sampler, seconds, baseline);
+    fossil_hostsys_sampler_netdev(sampler, seconds, baseline);
+    sampler->staging.cpu_pressure = fossil_hostsys_sampler_pressure(sampler, _FOSSIL_HOSTSYS_SOURCE_PRESSURE_CPU);
+    sampler->staging.memory_pressure = fossil_hostsys_sampler_pressure(sampler, _FOSSIL_HOSTSYS_SOURCE_PRESSURE_MEMORY);
+    sampler->staging.io_pressure = fossil_hostsys_sampler_pressure(sampler, _FOSSIL_HOSTSYS_SOURCE_PRESSURE_IO);
+#else
+    (void)seconds;
+    (void)baseline;
+    fossil_hostsystem_t info;
+    if (fossil_hostsys_get(&info)) {
+        sampler->staging.memory_total = info.total_memory * 1024 * 1024;
+        sampler->staging.memory_available = info.available_memory * 1024 * 1024;
+    }
+#endif
+}
+
+static void fossil_hostsys_sampler_publish(fossil_hostsys_sampler_t *sampler) {
+    uint64_t sequence = sampler->sequence;
+
+    _FOSSIL_HOSTSYS_SEQ_STORE(&sampler->sequence, sequence + 1);
+    _FOSSIL_HOSTSYS_FENCE();
+    sampler->staging.sequence = sequence / 2 + 1;
+    memcpy(&sampler->sample, &sampler->staging, sizeof(sampler->sample));
+    memcpy(sampler->cpu_busy, sampler->staging_busy, (size_t)sampler->slots * sizeof(float));
+    _FOSSIL_HOSTSYS_FENCE();
+    _FOSSIL_HOSTSYS_SEQ_STORE(&sampler->sequence, sequence + 2);
+}
+
+// Waits one interval; returns false once the sampler is asked to stop
+static bool fossil_hostsys_sampler_wait(fossil_hostsys_sampler_t *sampler) {
+    bool running;
+#ifdef _WIN32
+    DWORD milliseconds = (DWORD)(sampler->interval / 1000000);
+    AcquireSRWLockExclusive(&sampler->lock);
+    if (!sampler->stopping) {
+        SleepConditionVariableSRW(&sampler->wake, &sampler->lock, milliseconds, 0);
+    }
+    running = !sampler->stopping;
+    ReleaseSRWLockExclusive(&sampler->lock);
+#else
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    int64_t nanoseconds = (int64_t)deadline.tv_nsec + sampler->interval;
+    deadline.tv_sec += (time_t)(nanoseconds / 1000000000);
+    deadline.tv_nsec = (long)(nanoseconds % 1000000000);
+
+    pthread_mutex_lock(&sampler->lock);
+    while (!sampler->stopping) {
+        if (pthread_cond_timedwait(&sampler->wake, &sampler->lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    running = !sampler->stopping;
+    pthread_mutex_unlock(&sampler->lock);
+#endif
+    return running;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI fossil_hostsys_sampler_main(LPVOID context) {
+#else
+static void* fossil_hostsys_sampler_main(void *context) {
+#endif
+    fossil_hostsys_sampler_t *sampler = (fossil_hostsys_sampler_t*)context;
+    while (fossil_hostsys_sampler_wait(sampler)) {
+        fossil_hostsys_sampler_collect(sampler, false);
+        fossil_hostsys_sampler_publish(sampler);
+    }
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+static void fossil_hostsys_sampler_release(fossil_hostsys_sampler_t *sampler) {
+#ifdef __linux__
+    for (int32_t i = 0; i < _FOSSIL_HOSTSYS_SOURCES; ++i) {
+        if (sampler->fds[i] >= 0) {
+            close(sampler->fds[i]);
+        }
+    }
+#endif
+    free(sampler->buffer);
+    free(sampler->cpu_busy);
+    free(sampler);
+}
+
+fossil_hostsys_sampler_t* fossil_hostsys_sampler_start(int64_t interval) {
+    const fossil_hostsys_topology_t *topology = fossil_hostsys_topology();
+    int32_t slots = topology->num_cpus > 0 ? topology->cpus[topology->num_cpus - 1].cpu + 1 : 1;
+
+    if (interval < 1000000) {
+        fprintf(stderr, "Error: sampler interval below one millisecond\n");
+        return NULL;
+    }
+    fossil_hostsys_sampler_t *sampler = calloc(1, sizeof(fossil_hostsys_sampler_t));
+    if (!sampler) {
+        return NULL;
+    }
+    for (int32_t i = 0; i < _FOSSIL_HOSTSYS_SOURCES; ++i) {
+        sampler->fds[i] = -1;
+    }
+    sampler->interval = interval;
+    sampler->slots = slots;
+
+    // Both per-CPU arrays and the counters in one block, a read buffer sized
+    // for the cpu lines of /proc/stat
+    size_t floats = fossil_hostsys_align(2 * (size_t)slots * sizeof(float), _Alignof(fossil_hostsys_cpu_times_t));
+    sampler->cpu_busy = malloc(floats + (size_t)slots * sizeof(fossil_hostsys_cpu_times_t));
+    sampler->buffer_size = 65536 + (size_t)slots * 256;
+    sampler->buffer = malloc(sampler->buffer_size);
+    if (!sampler->cpu_busy || !sampler->buffer) {
+        fossil_hostsys_sampler_release(sampler);
+        return NULL;
+    }
+    sampler->staging_busy = sampler->cpu_busy + slots;
+    sampler->cpu_times = (fossil_hostsys_cpu_times_t*)((char*)sampler->cpu_busy + floats);
+    memset(sampler->cpu_busy, 0, floats + (size_t)slots * sizeof(fossil_hostsys_cpu_times_t));
+    sampler->staging.num_cpus = slots;
+
+#ifdef __linux__
+    for (int32_t i = 0; i < _FOSSIL_HOSTSYS_SOURCES; ++i) {
+        sampler->fds[i] = open(fossil_hostsys_source_paths[i], O_RDONLY | O_CLOEXEC);   // PSI may be missing
+    }
+#endif
+    fossil_hostsys_sampler_collect(sampler, true);
+
+#ifdef _WIN32
+    InitializeSRWLock(&sampler->lock);
+    InitializeConditionVariable(&sampler->wake);
+    sampler->thread = CreateThread(NULL, 0, fossil_hostsys_sampler_main, sampler, 0, NULL);
+    if (!sampler->thread) {
+        fossil_hostsys_sampler_release(sampler);
+        return NULL;
+    }
+#else
+    pthread_mutex_init(&sampler->lock, NULL);
+    pthread_cond_init(&sampler->wake, NULL);
+    if (pthread_create(&sampler->thread, NULL, fossil_hostsys_sampler_main, sampler) != 0) {
+        pthread_cond_destroy(&sampler->wake);
+        pthread_mutex_destroy(&sampler->lock);
+        fossil_hostsys_sampler_release(sampler);
+        return NULL;
+    }
+#endif
+    return sampler;
+}
+
+void fossil_hostsys_sampler_stop(fossil_hostsys_sampler_t *sampler) {
+    if (!sampler) {
+        return;
+    }
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&sampler->lock);
+    sampler->stopping = true;
+    ReleaseSRWLockExclusive(&sampler->lock);
+    WakeConditionVariable(&sampler->wake);
+    WaitForSingleObject(sampler->thread, INFINITE);
+    CloseHandle(sampler->thread);
+#else
+    pthread_mutex_lock(&sampler->lock);
+    sampler->stopping = true;
+    pthread_cond_signal(&sampler->wake);
+    pthread_mutex_unlock(&sampler->lock);
+    pthread_join(sampler->thread, NULL);
+    pthread_cond_destroy(&sampler->wake);
+    pthread_mutex_destroy(&sampler->lock);
+#endif
+    fossil_hostsys_sampler_release(sampler);
+}
+
+bool fossil_hostsys_sampler_read(const fossil_hostsys_sampler_t *sampler, fossil_hostsys_sample_t *sample,
+                                 float *cpu_busy, int32_t capacity) {
+    if (!sampler || !sample) {
+        return false;
+    }
+    int32_t count = cpu_busy ? (capacity < sampler->slots ? capacity : sampler->slots) : 0;
+    for (;;) {
+        uint64_t before = _FOSSIL_HOSTSYS_SEQ_LOAD(&sampler->sequence);
+        if (before & 1) {
+            continue;   // the sampler is writing
+        }
+        memcpy(sample, &sampler->sample, sizeof(*sample));
+        if (count > 0) {
+            memcpy(cpu_busy, sampler->cpu_busy, (size_t)count * sizeof(float));
+        }
+        _FOSSIL_HOSTSYS_FENCE();
+        if (_FOSSIL_HOSTSYS_SEQ_LOAD(&sampler->sequence) == before) {
+            return before != 0;
+        }
+    }
+}
+
+// * * * * * * * * * * * * * * * * * * * * * * * *
+// * Process metrics
+// * * * * * * * * * * * * * * * * * * * * * * * *
+
+#ifdef __linux__
+// /proc/self files kept open; reopened after fork since they name the opener
+static int fossil_hostsys_statm_fd = -1;
+static int fossil_hostsys_stat_fd = -1;
+static pid_t fossil_hostsys_self_pid = 0;
+static pthread_mutex_t fossil_hostsys_self_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static ssize_t fossil_hostsys_read_self(int *fd, const char *path, char *buffer, size_t size) {
+    if (*fd < 0) {
+        *fd = open(path, O_RDONLY | O_CLOEXEC);
+    }
+    ssize_t length = *fd < 0 ? -1 : pread(*fd, buffer, size - 1, 0);
+    buffer[length > 0 ? length : 0] = '\0';
+    return length;
+}
+
+static bool fossil_hostsys_process_linux(fossil_hostsys_process_t *process, bool include_pss) {
+    char text[1024];
+    long page_size = sysconf(_SC_PAGE_SIZE);
+    bool result = true;
+
+    pthread_mutex_lock(&fossil_hostsys_self_lock);
+    if (fossil_hostsys_self_pid != getpid()) {
+        if (fossil_hostsys_statm_fd >= 0) {
+            close(fossil_hostsys_statm_fd);
+        }
+        if (fossil_hostsys_stat_fd >= 0) {
+            close(fossil_hostsys_stat_fd);
+        }
+        fossil_hostsys_statm_fd = -1;
+        fossil_hostsys_stat_fd = -1;
+        fossil_hostsys_self_pid = getpid();
+    }
+
+    // statm: size resident shared text lib data dt, in pages
+    if (fossil_hostsys_read_self(&fossil_hostsys_statm_fd, "/proc/self/statm", text, sizeof(text)) > 0) {
+        char *p = text;
+        process->virtual_size = (int64_t)strtoll(p, &p, 10) * page_size;
+        process->rss = (int64_t)strtoll(p, &p, 10) * page_size;
+    } else {
+        result = false;
+    }
+
+    // stat: the thread count is field 20, counting from the pid; the command
+    // name in field 2 may hold spaces, so fields are counted after its ')'
+    if (fossil_hostsys_read_self(&fossil_hostsys_stat_fd, "/proc/self/stat", text, sizeof(text)) > 0) {
+        char *p = strrchr(text, ')');
+        for (int32_t field = 2; p && field < 20; ++field) {
+            p = strchr(p + 1, ' ');
+        }
+        if (p) {
+            process->threads = (int32_t)strtol(p + 1, NULL, 10);
+        }
+    }
+    pthread_mutex_unlock(&fossil_hostsys_self_lock);
+
+    // Linux 6.2 and later report the descriptor count as the directory size
+    struct stat fd_dir;
+    if (stat("/proc/self/fd", &fd_dir) == 0 && fd_dir.st_size > 0) {
+        process->open_fds = (int32_t)fd_dir.st_size;
+    } else {
+        DIR *dir = opendir("/proc/self/fd");
+        if (dir) {
+            struct dirent *entry;
+            while ((entry = readdir(dir)) != NULL) {
+                process->open_fds += entry->d_name[0] != '.';
+            }
+            closedir(dir);
+            --process->open_fds;   // the descriptor opendir itself holds
+        }
+    }
+
+    if (include_pss) {
+        char *rollup = malloc(4096);
+        if (rollup && fossil_hostsys_read_text("/proc/self/smaps_rollup", rollup, 4096) > 0) {
+            process->pss = fossil_hostsys_meminfo_field(rollup, "\nPss:") * 1024;
+        }
+        free(rollup);
+    }
+    return result;
+}
+#endif
+
+bool fossil_hostsys_process_get(fossil_hostsys_process_t *process, bool include_pss) {
+    bool result = false;
+
+    if (!process) {
+        return false;
+    }
+    memset(process, 0, sizeof(*process));
+    process->timestamp = fossil_hostsys_monotonic_ns();
+
+#ifdef _WIN32
+    (void)include_pss;
+    HANDLE self = GetCurrentProcess();
+    PROCESS_MEMORY_COUNTERS counters;
+    if (K32GetProcessMemoryInfo(self, &counters, sizeof(counters))) {
+        process->rss = (int64_t)counters.WorkingSetSize;
+        process->virtual_size = (int64_t)counters.PagefileUsage;
+        process->minor_faults = (int64_t)counters.PageFaultCount;
+        result = true;
+    }
+    FILETIME created, exited, kernel, user;
+    if (GetProcessTimes(self, &created, &exited, &kernel, &user)) {
+        process->user_time = (double)(((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime) / 1e7;
+        process->system_time = (double)(((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) / 1e7;
+    }
+    DWORD handles = 0;
+    if (GetProcessHandleCount(self, &handles)) {
+        process->open_fds = (int32_t)handles;
+    }
+    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+    if (snapshot != INVALID_HANDLE_VALUE) {
+        THREADENTRY32 entry;
+        entry.dwSize = sizeof(entry);
+        DWORD pid = GetCurrentProcessId();
+        for (BOOL more = Thread32First(snapshot, &entry); more; more = Thread32Next(snapshot, &entry)) {
+            process->threads += entry.th32OwnerProcessID == pid;
+        }
+        CloseHandle(snapshot);
+    }
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        process->minor_faults = (int64_t)usage.ru_minflt;
+        process->major_faults = (int64_t)usage.ru_majflt;
+        process->voluntary_switches = (int64_t)usage.ru_nvcsw;
+        process->involuntary_switches = (int64_t)usage.ru_nivcsw;
+        process->user_time = (double)usage.ru_utime.tv_sec + (double)usage.ru_utime.tv_usec / 1e6;
+        process->system_time = (double)usage.ru_stime.tv_sec + (double)usage.ru_stime.tv_usec / 1e6;
+        result = true;
+    }
+#ifdef __linux__
+    result = fossil_hostsys_process_linux(process, include_pss) && result;
+#elif defined(__APPLE__)
+    (void)include_pss;
+    struct proc_taskinfo task;
+    if (proc_pidinfo(getpid(), PROC_PIDTASKINFO, 0, &task, sizeof(task)) == (int)sizeof(task)) {
+        process->rss = (int64_t)task.pti_resident_size;
+        process->virtual_size = (int64_t)task.pti_virtual_size;
+        process->threads = (int32_t)task.pti_threadnum;
+    }
+    int bytes = proc_pidinfo(getpid(), PROC_PIDLISTFDS, 0, NULL, 0);
+    if (bytes > 0) {
+        process->open_fds = bytes / (int)sizeof(struct proc_fdinfo);   // an upper bound sized by the kernel
+    }
+#else
+    (void)include_pss;
+#endif
+#endif
+    return result;
+}
+
+// * * * * * * * * * * * * * * * * * * * * * * * *
+// * Thread placement
+// * * * * * * * * * * * * * * * * * * * * * * * *
+
+void fossil_hostsys_cpuset_clear(fossil_hostsys_cpuset_t *set) {
+    if (set) {
+        memset(set, 0, sizeof(*set));
+    }
+}
+
+void fossil_hostsys_cpuset_add(fossil_hostsys_cpuset_t *set, int32_t cpu) {
+    if (set && cpu >= 0 && cpu < _FOSSIL_HOSTSYS_MAX_CPUS) {
+        set->bits[cpu / 64] |= (uint64_t)1 << (cpu % 64);
+    }
+}
+
+bool fossil_hostsys_cpuset_has(const fossil_hostsys_cpuset_t *set, int32_t cpu) {
+    if (!set || cpu < 0 || cpu >= _FOSSIL_HOSTSYS_MAX_CPUS) {
+        return false;
+    }
+    return (set->bits[cpu / 64] >> (cpu % 64)) & 1;
+}
+
+int32_t fossil_hostsys_cpuset_count(const fossil_hostsys_cpuset_t *set) {
+    int32_t count = 0;
+    if (set) {
+        for (size_t i = 0; i < sizeof(set->bits) / sizeof(set->bits[0]); ++i) {
+            for (uint64_t word = set->bits[i]; word; word &= word - 1) {
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+
+bool fossil_hostsys_cpuset_domain(const fossil_hostsys_topology_t *topology, fossil_hostsys_domain_t domain,
+                                  int32_t id, fossil_hostsys_cpuset_t *set) {
+    if (!topology || !topology->cpus || !set) {
+        return false;
+    }
+    fossil_hostsys_cpuset_clear(set);
+    for (int32_t i = 0; i < topology->num_cpus; ++i) {
+        const fossil_hostsys_cpu_t *cpu = &topology->cpus[i];
+        int32_t value;
+        switch (domain) {
+            case FOSSIL_HOSTSYS_DOMAIN_CPU:     value = cpu->cpu; break;
+            case FOSSIL_HOSTSYS_DOMAIN_CORE:    value = cpu->core; break;
+            case FOSSIL_HOSTSYS_DOMAIN_PACKAGE: value = cpu->package; break;
+            case FOSSIL_HOSTSYS_DOMAIN_NUMA:    value = cpu->numa_node; break;
+            case FOSSIL_HOSTSYS_DOMAIN_L2:      value = cpu->l2_domain; break;
+            case FOSSIL_HOSTSYS_DOMAIN_L3:      value = cpu->l3_domain; break;
+            default:                            return false;
+        }
+        if (value == id) {
+            fossil_hostsys_cpuset_add(set, cpu->cpu);
+        }
+    }
+    return fossil_hostsys_cpuset_count(set) > 0;
+}
+
+// One usable CPU while ordering a placement
+typedef struct {
+    int32_t cpu;
+    int32_t package;
+    int32_t core;
+    int32_t sibling;   // SMT index while sorting compactly, then rank among the usable siblings
+    int32_t rank;      // rank of the core within its package
+} fossil_hostsys_slot_t;
+
+static int fossil_hostsys_slot_compact(const void *a, const void *b) {
+    const fossil_hostsys_slot_t *x = a;
+    const fossil_hostsys_slot_t *y = b;
+    if (x->package != y->package) {
+        return x->package < y->package ? -1 : 1;
+    }
+    if (x->core != y->core) {
+        return x->core < y->core ? -1 : 1;
+    }
+    if (x->sibling != y->sibling) {
+        return x->sibling < y->sibling ? -1 : 1;
+    }
+    return (x->cpu > y->cpu) - (x->cpu < y->cpu);
+}
+
+static int fossil_hostsys_slot_scatter(const void *a, const void *b) {
+    const fossil_hostsys_slot_t *x = a;
+    const fossil_hostsys_slot_t *y = b;
+    if (x->sibling != y->sibling) {
+        return x->sibling < y->sibling ? -1 : 1;
+    }
+    if (x->rank != y->rank) {
+        return x->rank < y->rank ? -1 : 1;
+    }
+    return (x->package > y->package) - (x->package < y->package);
+}
+
+bool fossil_hostsys_place(const fossil_hostsys_topology_t *topology, fossil_hostsys_policy_t policy,
+                          int32_t worker, const fossil_hostsys_cpuset_t *allowed, fossil_hostsys_cpuset_t *set) {
+    if (!topology || !topology->cpus || topology->num_cpus <= 0 || !set || worker < 0) {
+        return false;
+    }
+    fossil_hostsys_slot_t *slots = (fossil_hostsys_slot_t*)malloc((size_t)topology->num_cpus * sizeof(*slots));
+    if (!slots) {
+        return false;
+    }
+    int32_t count = 0;
+    for (int32_t i = 0; i < topology->num_cpus; ++i) {
+        const fossil_hostsys_cpu_t *cpu = &topology->cpus[i];
+        if (!allowed || fossil_hostsys_cpuset_has(allowed, cpu->cpu)) {
+            fossil_hostsys_slot_t slot = { cpu->cpu, cpu->package, cpu->core, cpu->smt_index, 0 };
+            slots[count++] = slot;
+        }
+    }
+    qsort(slots, (size_t)count, sizeof(*slots), fossil_hostsys_slot_compact);
+
+    // Rank cores within packages and siblings within cores, counting only usable CPUs
+    for (int32_t i = 0; i < count; ++i) {
+        if (i == 0 || slots[i].package != slots[i - 1].package) {
+            slots[i].rank = 0;
+            slots[i].sibling = 0;
+        } else if (slots[i].core != slots[i - 1].core) {
+            slots[i].rank = slots[i - 1].rank + 1;
+            slots[i].sibling = 0;
+        } else {
+            slots[i].rank = slots[i - 1].rank;
+            slots[i].sibling = slots[i - 1].sibling + 1;
+        }
+    }
+    if (policy == FOSSIL_HOSTSYS_PLACE_PHYSICAL) {
+        int32_t kept = 0;
+        for (int32_t i = 0; i < count; ++i) {
+            if (slots[i].sibling == 0) {
+                slots[kept++] = slots[i];
+            }
+        }
+        count = kept;
+    } else if (policy == FOSSIL_HOSTSYS_PLACE_SCATTER) {
+        qsort(slots, (size_t)count, sizeof(*slots), fossil_hostsys_slot_scatter);
+    }
+
+    bool result = count > 0;
+    if (result) {
+        fossil_hostsys_cpuset_clear(set);
+        fossil_hostsys_cpuset_add(set, slots[worker % count].cpu);
+    }
+    free(slots);
+    return result;
+}
+
+#ifdef __linux__
+static void fossil_hostsys_cpuset_to_mask(const fossil_hostsys_cpuset_t *set, cpu_set_t *mask) {
+    CPU_ZERO(mask);
+    for (int32_t cpu = 0; cpu < _FOSSIL_HOSTSYS_MAX_CPUS && cpu < CPU_SETSIZE; ++cpu) {
+        if (fossil_hostsys_cpuset_has(set, cpu)) {
+            CPU_SET(cpu, mask);
+        }
+    }
+}
+#endif
+
+bool fossil_hostsys_affinity_self(fossil_hostsys_cpuset_t *set) {
+    if (!set) {
+        return false;
+    }
+    fossil_hostsys_cpuset_clear(set);
+#ifdef __linux__
+    int rc = ENOMEM;
+    for (int cpus = 1024; cpus <= (1 << 20); cpus *= 2) {
+        cpu_set_t *mask = CPU_ALLOC(cpus);
+        size_t size = CPU_ALLOC_SIZE(cpus);
+        if (!mask) {
+            rc = ENOMEM;
+            break;
+        }
+        rc = pthread_getaffinity_np(pthread_self(), size, mask);
+        if (rc == 0) {
+            for (int32_t cpu = 0; cpu < _FOSSIL_HOSTSYS_MAX_CPUS && cpu < cpus; ++cpu) {
+                if (CPU_ISSET_S(cpu, size, mask)) {
+                    fossil_hostsys_cpuset_add(set, cpu);
+                }
+            }
+            CPU_FREE(mask);
+            return true;
+        }
+        CPU_FREE(mask);
+        if (rc != EINVAL) {
+            break;   // EINVAL means the kernel's mask is larger than ours
+        }
+    }
+    fprintf(stderr, "Error reading thread affinity: %s\n", strerror(rc));
+    return false;
+#elif defined(_WIN32)
+    DWORD_PTR process_mask, system_mask;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) {
+        fprintf(stderr, "Error reading process affinity\n");
+        return false;
+    }
+    set->bits[0] = (uint64_t)process_mask;
+    return true;
+#else
+    // No affinity to read, so every online CPU is usable
+    int32_t cpus = fossil_hostsys_online_cpus();
+    for (int32_t cpu = 0; cpu < cpus; ++cpu) {
+        fossil_hostsys_cpuset_add(set, cpu);
+    }
+    return true;
+#endif
+}
+
+bool fossil_hostsys_pin_self(const fossil_hostsys_cpuset_t *set) {
+    if (!set || fossil_hostsys_cpuset_count(set) == 0) {
+        return false;
+    }
+#ifdef __linux__
+    cpu_set_t mask;
+    fossil_hostsys_cpuset_to_mask(set, &mask);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+    if (rc != 0) {
+        fprintf(stderr, "Error pinning thread: %s\n", strerror(rc));
+        return false;
+    }
+    return true;
+#elif defined(_WIN32)
+    if (!SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)set->bits[0])) {
+        fprintf(stderr, "Error pinning thread\n");
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+int32_t fossil_hostsys_current_cpu(void) {
+#ifdef __linux__
+    return (int32_t)sched_getcpu();
+#elif defined(_WIN32)
+    return (int32_t)GetCurrentProcessorNumber();
+#else
+    return -1;
+#endif
+}
+
+struct fossil_hostsys_thread {
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+    fossil_hostsys_routine_t routine;
+    void *arg;
+    void *result;
+};
+
+#ifdef _WIN32
+static DWORD WINAPI fossil_hostsys_thread_main(LPVOID data) {
+    fossil_hostsys_thread_t *thread = (fossil_hostsys_thread_t*)data;
+    thread->result = thread->routine(thread->arg);
+    return 0;
+}
+#else
+static void* fossil_hostsys_thread_main(void *data) {
+    fossil_hostsys_thread_t *thread = (fossil_hostsys_thread_t*)data;
+    thread->result = thread->routine(thread->arg);
+    return NULL;
+}
+#endif
+
+fossil_hostsys_thread_t* fossil_hostsys_thread_start(const fossil_hostsys_cpuset_t *set, fossil_hostsys_routine_t routine, void *arg) {
+    if (!routine || (set && fossil_hostsys_cpuset_count(set) == 0)) {
+        return NULL;
+    }
+    fossil_hostsys_thread_t *thread = (fossil_hostsys_thread_t*)calloc(1, sizeof(*thread));
+    if (!thread) {
+        return NULL;
+    }
+    thread->routine = routine;
+    thread->arg = arg;
+#ifdef _WIN32
+    thread->handle = CreateThread(NULL, 0, fossil_hostsys_thread_main, thread, CREATE_SUSPENDED, NULL);
+    if (!thread->handle) {
+        fprintf(stderr, "Error starting thread\n");
+        free(thread);
+        return NULL;
+    }
+    if (set && !SetThreadAffinityMask(thread->handle, (DWORD_PTR)set->bits[0])) {
+        fprintf(stderr, "Error pinning thread\n");
+        TerminateThread(thread->handle, 0);   // never ran
+        CloseHandle(thread->handle);
+        free(thread);
+        return NULL;
+    }
+    ResumeThread(thread->handle);
+#else
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+#ifdef __linux__
+    cpu_set_t mask;
+    if (set) {
+        fossil_hostsys_cpuset_to_mask(set, &mask);
+        int rc = pthread_attr_setaffinity_np(&attr, sizeof(mask), &mask);
+        if (rc != 0) {
+            fprintf(stderr, "Error pinning thread: %s\n", strerror(rc));
+            pthread_attr_destroy(&attr);
+            free(thread);
+            return NULL;
+        }
+    }
+#endif
+    int rc = pthread_create(&thread->handle, &attr, fossil_hostsys_thread_main, thread);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        fprintf(stderr, "Error starting thread: %s\n", strerror(rc));
+        free(thread);
+        return NULL;
+    }
+#endif
+    return thread;
+}
+
+void* fossil_hostsys_thread_join(fossil_hostsys_thread_t *thread) {
+    if (!thread) {
+        return NULL;
+    }
+#ifdef _WIN32
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+#else
+    pthread_join(thread->handle, NULL);
+#endif
+    void *result = thread->result;
+    free(thread);
+    return result;
+}
+
+// * * * * * * * * * * * * * * * * * * * * * * * *
+// * Host report
+// * * * * * * * * * * * * * * * * * * * * * * * *
+
+// Text sink that counts what it could not store, like snprintf
+typedef struct {
+    char *data;
+    size_t size;
+    size_t length;
+} fossil_hostsys_writer_t;
+
+static void fossil_hostsys_write(fossil_hostsys_writer_t *writer, const char *text, size_t len) {
+    if (writer->length < writer->size) {
+        size_t room = writer->size - writer->length;
+        memcpy(writer->data + writer->length, text, len < room ? len : room);
+    }
+    writer->length += len;
+}
+
+static void fossil_hostsys_write_str(fossil_hostsys_writer_t *writer, const char *text) {
+    fossil_hostsys_write(writer, text, strlen(text));
+}
+
+static void fossil_hostsys_writef(fossil_hostsys_writer_t *writer, const char *format, ...) {
+    va_list args, measure;
+    va_start(args, format);
+    va_copy(measure, args);
+    int len = vsnprintf(NULL, 0, format, measure);
+    va_end(measure);
+    if (len > 0) {
+        size_t room = writer->length < writer->size ? writer->size - writer->length : 0;
+        if ((size_t)len < room) {
+            vsnprintf(writer->data + writer->length, room, format, args);
+            writer->length += (size_t)len;
+        } else {
+            // Only part fits; format in full so the tail is cut at the right byte
+            char *text = room > 0 ? (char*)malloc((size_t)len + 1) : NULL;
+            if (text) {
+                vsnprintf(text, (size_t)len + 1, format, args);
+                fossil_hostsys_write(writer, text, (size_t)len);
+                free(text);
+            } else {
+                writer->length += (size_t)len;
+            }
+        }
+    }
+    va_end(args);
+}
+
+// Quoted JSON string, or null for a missing or empty value
+static void fossil_hostsys_write_json(fossil_hostsys_writer_t *writer, const char *text) {
+    if (!text || !*text) {
+        fossil_hostsys_write_str(writer, "null");
+        return;
+    }
+    fossil_hostsys_write(writer, "\"", 1);
+    for (const unsigned char *c = (const unsigned char*)text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            char escaped[2] = { '\\', (char)*c };
+            fossil_hostsys_write(writer, escaped, 2);
+        } else if (*c < 0x20) {
+            fossil_hostsys_writef(writer, "\\u%04x", (unsigned)*c);
+        } else {
+            fossil_hostsys_write(writer, (const char*)c, 1);
+        }
+    }
+    fossil_hostsys_write(writer, "\"", 1);
+}
+
+static size_t fossil_hostsys_writer_finish(fossil_hostsys_writer_t *writer) {
+    if (writer->size > 0) {
+        writer->data[writer->length < writer->size ? writer->length : writer->size - 1] = '\0';
+    }
+    return writer->length;
+}
+
+static uint64_t fossil_hostsys_hash(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Integers go in little-endian order so the hash is the same on every build
+static uint64_t fossil_hostsys_hash_int(uint64_t hash, int64_t value) {
+    unsigned char bytes[8];
+    for (int i = 0; i < 8; ++i) {
+        bytes[i] = (unsigned char)((uint64_t)value >> (8 * i));
+    }
+    return fossil_hostsys_hash(hash, bytes, sizeof(bytes));
+}
+
+uint64_t fossil_hostsys_fingerprint(void) {
+    fossil_hostsystem_t info;
+    const fossil_hostsys_topology_t *topology = fossil_hostsys_topology();
+    uint64_t hash = 14695981039346656037ull;
+    if (fossil_hostsys_get(&info)) {
+        hash = fossil_hostsys_hash(hash, info.cpu_model, strlen(info.cpu_model));
+    }
+    hash = fossil_hostsys_hash_int(hash, (int64_t)fossil_hostsys_features());
+    hash = fossil_hostsys_hash_int(hash, topology->num_cpus);
+    hash = fossil_hostsys_hash_int(hash, topology->num_cores);
+    hash = fossil_hostsys_hash_int(hash, topology->num_packages);
+    hash = fossil_hostsys_hash_int(hash, topology->num_numa_nodes);
+    for (int32_t i = 0; i < topology->num_caches; ++i) {
+        const fossil_hostsys_cache_t *cache = &topology->caches[i];
+        hash = fossil_hostsys_hash_int(hash, cache->level);
+        hash = fossil_hostsys_hash_int(hash, cache->type);
+        hash = fossil_hostsys_hash_int(hash, cache->size);
+        hash = fossil_hostsys_hash_int(hash, cache->line_size);
+        hash = fossil_hostsys_hash_int(hash, cache->ways);
+        hash = fossil_hostsys_hash_int(hash, cache->shared_cpus);
+    }
+    // Rounded to the GiB, since firmware and kernel reservations move the exact figure
+    int64_t memory = fossil_hostsys_physical_memory();
+    return fossil_hostsys_hash_int(hash, (memory + ((int64_t)1 << 29)) >> 30);
+}
+
+static void fossil_hostsys_report_os(fossil_hostsys_writer_t *writer, const fossil_hostsystem_t *info) {
+    char governor[64] = "";
+    char thp[128] = "";
+#ifdef __linux__
+    if (fossil_hostsys_read_text("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor", governor, sizeof(governor)) < 0) {
+        governor[0] = '\0';
+    }
+    // The active mode is the bracketed word, as in "always [madvise] never"
+    if (fossil_hostsys_read_text("/sys/kernel/mm/transparent_hugepage/enabled", thp, sizeof(thp)) > 0) {
+        char *open = strchr(thp, '[');
+        char *close = open ? strchr(open, ']') : NULL;
+        if (close) {
+            *close = '\0';
+            memmove(thp, open + 1, (size_t)(close - open));
+        }
+    } else {
+        thp[0] = '\0';
+    }
+#endif
+    fossil_hostsys_write_str(writer, "\"os\":{\"name\":");
+    fossil_hostsys_write_json(writer, info->os_name);
+    fossil_hostsys_write_str(writer, ",\"kernel\":");
+    fossil_hostsys_write_json(writer, info->os_version);
+    fossil_hostsys_write_str(writer, ",\"governor\":");
+    fossil_hostsys_write_json(writer, governor);
+    fossil_hostsys_write_str(writer, ",\"thp\":");
+    fossil_hostsys_write_json(writer, thp);
+    fossil_hostsys_writef(writer, ",\"endianness\":\"%s\"}", info->is_big_endian ? "big" : "little");
+}
+
+static void fossil_hostsys_report_cpu(fossil_hostsys_writer_t *writer, const fossil_hostsystem_t *info,
+                                      const fossil_hostsys_topology_t *topology) {
+    static const char *types[] = { "data", "instruction", "unified" };
+
+    fossil_hostsys_write_str(writer, "\"cpu\":{\"model\":");
+    fossil_hostsys_write_json(writer, info->cpu_model);
+    fossil_hostsys_writef(writer, ",\"logical\":%d,\"cores\":%d,\"packages\":%d,\"threads_per_core\":%d",
+                          (int)topology->num_cpus, (int)topology->num_cores, (int)topology->num_packages,
+                          (int)topology->threads_per_core);
+    fossil_hostsys_writef(writer, ",\"timer_frequency\":%lld,\"invariant_tsc\":%s,\"features\":[",
+                          (long long)info->timer_frequency, info->invariant_tsc ? "true" : "false");
+    bool first = true;
+    for (size_t i = 0; i < sizeof(fossil_hostsys_feature_names) / sizeof(fossil_hostsys_feature_names[0]); ++i) {
+        if (info->cpu_features & fossil_hostsys_feature_names[i].feature) {
+            fossil_hostsys_writef(writer, "%s\"%s\"", first ? "" : ",", fossil_hostsys_feature_names[i].name);
+            first = false;
+        }
+    }
+    fossil_hostsys_write_str(writer, "]},\"caches\":[");
+    for (int32_t i = 0; i < topology->num_caches; ++i) {
+        const fossil_hostsys_cache_t *cache = &topology->caches[i];
+        fossil_hostsys_writef(writer, "%s{\"level\":%d,\"type\":\"%s\",\"size\":%lld,\"line_size\":%d,\"ways\":%d,\"shared_cpus\":%d}",
+                              i ? "," : "", (int)cache->level, types[cache->type], (long long)cache->size,
+                              (int)cache->line_size, (int)cache->ways, (int)cache->shared_cpus);
+    }
+    fossil_hostsys_writef(writer, "],\"topology\":{\"l2_domains\":%d,\"l3_domains\":%d,\"cpus\":[",
+                          (int)topology->num_l2_domains, (int)topology->num_l3_domains);
+    for (int32_t i = 0; i < topology->num_cpus; ++i) {
+        const fossil_hostsys_cpu_t *cpu = &topology->cpus[i];
+        fossil_hostsys_writef(writer, "%s{\"cpu\":%d,\"core\":%d,\"package\":%d,\"node\":%d,\"smt\":%d,\"l2\":%d,\"l3\":%d}",
+                              i ? "," : "", (int)cpu->cpu, (int)cpu->core, (int)cpu->package, (int)cpu->numa_node,
+                              (int)cpu->smt_index, (int)cpu->l2_domain, (int)cpu->l3_domain);
+    }
+    fossil_hostsys_write_str(writer, "]}");
+}
+
+static void fossil_hostsys_report_numa(fossil_hostsys_writer_t *writer, const fossil_hostsys_topology_t *topology) {
+    fossil_hostsys_write_str(writer, "\"numa\":[");
+    int32_t written = 0;
+    int32_t previous = -1;
+    // Node ids may be sparse, so walk them in increasing order
+    for (;;) {
+        int32_t node = -1;
+        int32_t cpus = 0;
+        for (int32_t i = 0; i < topology->num_cpus; ++i) {
+            int32_t id = topology->cpus[i].numa_node;
+            if (id > previous && (node < 0 || id < node)) {
+                node = id;
+                cpus = 0;
+            }
+            cpus += id == node;
+        }
+        if (node < 0) {
+            break;
+        }
+        int64_t memory = 0;
+#ifdef __linux__
+        char path[_FOSSIL_HOSTSYS_PATH];
+        char text[256];   // MemTotal is on the first line
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/meminfo", (int)node);
+        if (fossil_hostsys_read_text(path, text, sizeof(text)) > 0) {
+            memory = fossil_hostsys_meminfo_field(text, "MemTotal:") * 1024;
+        }
+#endif
+        fossil_hostsys_writef(writer, "%s{\"node\":%d,\"cpus\":%d,\"memory\":", written ? "," : "", (int)node, (int)cpus);
+        if (memory > 0) {
+            fossil_hostsys_writef(writer, "%lld}", (long long)memory);
+        } else {
+            fossil_hostsys_write_str(writer, "null}");
+        }
+        previous = node;
+        ++written;
+    }
+    fossil_hostsys_write_str(writer, "]");
+}
+
+size_t fossil_hostsys_report_json(char *buffer, size_t size) {
+    fossil_hostsys_writer_t writer = { buffer, size, 0 };
+    fossil_hostsystem_t info;
+    if (!fossil_hostsys_get(&info)) {
+        memset(&info, 0, sizeof(info));
+    }
+    const fossil_hostsys_topology_t *topology = fossil_hostsys_topology();
+    fossil_hostsys_limits_t limits;
+    fossil_hostsys_limits_load(NULL, &limits);
+
+    fossil_hostsys_writef(&writer, "{\"fingerprint\":\"%016llx\",", (unsigned long long)fossil_hostsys_fingerprint());
+    fossil_hostsys_report_os(&writer, &info);
+    fossil_hostsys_write(&writer, ",", 1);
+    fossil_hostsys_report_cpu(&writer, &info, topology);
+    fossil_hostsys_write(&writer, ",", 1);
+    fossil_hostsys_report_numa(&writer, topology);
+    fossil_hostsys_writef(&writer, ",\"memory\":{\"total\":%lld,\"available\":%lld,\"effective\":%lld}",
+                          (long long)fossil_hostsys_physical_memory(), (long long)info.available_memory * 1024 * 1024,
+                          (long long)limits.effective_memory);
+    fossil_hostsys_writef(&writer, ",\"limits\":{\"affinity_cpus\":%d,\"cpu_quota\":%g,\"memory_max\":%lld,\"memory_high\":%lld,\"effective_cpus\":%d}}",
+                          (int)limits.affinity_cpus, limits.cpu_quota, (long long)limits.memory_max,
+                          (long long)limits.memory_high, (int)limits.effective_cpus);
+    return fossil_hostsys_writer_finish(&writer);
 }
 
 const char* fossil_hostsys_endian(fossil_hostsystem_t *info) {
@@ -209,7 +2662,20 @@ void fossil_hostsys_print(fossil_hostsystem_t *info) {
     printf("Version: %s\n", info->os_version);
     printf("CPU Model: %s\n", info->cpu_model);
     printf("CPU Cores: %d\n", info->cpu_cores);
+    printf("Physical Cores: %d\n", info->physical_cores);
+    printf("CPU Sockets: %d\n", info->cpu_sockets);
+    printf("NUMA Nodes: %d\n", info->numa_nodes);
+    printf("L1/L2/L3 Cache: %ld/%ld/%ld KB\n", (long int)(info->l1_cache / 1024),
+           (long int)(info->l2_cache / 1024), (long int)(info->l3_cache / 1024));
+    char features[512];
+    fossil_hostsys_feature_string(info->cpu_features, features, sizeof(features));
+    printf("CPU Features: %s\n", features);
     printf("Total Memory: %ld MB\n", (long int)info->total_memory);
     printf("Free Memory: %ld MB\n", (long int)info->free_memory);
+    printf("Available Memory: %ld MB\n", (long int)info->available_memory);
+    printf("Load Average: %.2f\n", info->load_average);
+    printf("Effective CPUs: %d\n", info->effective_cpus);
+    printf("Effective Memory: %ld MB\n", (long int)info->effective_memory);
+    printf("Timer Frequency: %lld Hz%s\n", (long long)info->timer_frequency, info->invariant_tsc ? " (invariant)" : "");
     printf("Endianness: %s\n", fossil_hostsys_endian(info));
 }
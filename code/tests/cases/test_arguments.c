@@ -14,6 +14,12 @@
 #include <fossil/test/framework.h>
 
 #include "fossil/lib/framework.h"
+#include <string.h>
+#ifndef _WIN32
+#include <pthread.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Utilities
@@ -75,6 +81,746 @@ FOSSIL_TEST_CASE(c_test_arg_parse) {
     ASSUME_ITS_EQUAL_I32(0, options[1].value.bool_val);
 }
 
+FOSSIL_TEST_CASE(c_test_arg_parse_many_options) {
+    // Benchmark: 10k arguments against 1k options, lookups go through the hashed index
+    enum { NUM_OPTIONS = 1000, NUM_ARGS = 10000 };
+    fossil_option_t *options = calloc(NUM_OPTIONS, sizeof(fossil_option_t));
+    char **argv = calloc(NUM_ARGS + 1, sizeof(char *));
+    char *names = calloc(NUM_OPTIONS, 16);
+    static char values[NUM_ARGS / 2][8];
+
+    for (int i = 0; i < NUM_OPTIONS; ++i) {
+        snprintf(names + i * 16, 16, "opt%d", i);
+        options[i].name = names + i * 16;
+        options[i].type = COPTION_TYPE_INT;
+    }
+
+    static char flags[NUM_ARGS / 2][16];
+    argv[0] = (char *)"program";
+    for (int i = 0; i < NUM_ARGS / 2; ++i) {
+        snprintf(flags[i], sizeof(flags[i]), "-opt%d", (i * 7) % NUM_OPTIONS);
+        snprintf(values[i], sizeof(values[i]), "%d", i);
+        argv[1 + i * 2] = flags[i];
+        argv[2 + i * 2] = values[i];
+    }
+
+    fossil_command_line_t cmd = {NUM_ARGS + 1, argv};
+    fossil_arg_parse(&cmd, options, NUM_OPTIONS);
+
+    // The last occurrence of each option wins
+    ASSUME_ITS_EQUAL_I32(4999, options[(4999 * 7) % NUM_OPTIONS].value.int_val);
+    ASSUME_ITS_EQUAL_I32(1, fossil_arg_parse_has(options, NUM_OPTIONS, "opt0"));
+    ASSUME_ITS_EQUAL_I32(0, fossil_arg_parse_has(options, NUM_OPTIONS, "opt1000"));
+
+    free(names);
+    free(argv);
+    free(options);
+}
+
+FOSSIL_TEST_CASE(c_test_arg_parse_value) {
+    fossil_option_value_t value;
+    fossil_option_t int_opt = {"n", COPTION_TYPE_INT, {.int_val = 0}, cnull, 0, 0};
+    fossil_option_t int64_opt = {"n", COPTION_TYPE_INT64, {.int64_val = 0}, cnull, 0, 0};
+    fossil_option_t double_opt = {"d", COPTION_TYPE_DOUBLE, {.double_val = 0}, cnull, 0, 0};
+    fossil_option_t size_opt = {"s", COPTION_TYPE_SIZE, {.size_val = 0}, cnull, 0, 0};
+    fossil_option_t duration_opt = {"t", COPTION_TYPE_DURATION, {.duration_val = 0}, cnull, 0, 0};
+
+    // Integers are range checked against the option's width
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_parse_value(&int_opt, "-2147483648", &value));
+    ASSUME_ITS_EQUAL_I32(INT32_MIN, value.int_val);
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_ERROR_RANGE, fossil_arg_parse_value(&int_opt, "2147483648", &value));
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_ERROR_INVALID, fossil_arg_parse_value(&int_opt, "12abc", &value));
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_parse_value(&int64_opt, "9223372036854775807", &value));
+    ASSUME_ITS_TRUE(value.int64_val == INT64_MAX);
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_ERROR_RANGE, fossil_arg_parse_value(&int64_opt, "99999999999999999999", &value));
+
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_parse_value(&double_opt, "-2.5e3", &value));
+    ASSUME_ITS_TRUE(value.double_val == -2500.0);
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_parse_value(&double_opt, "0.1", &value));
+    ASSUME_ITS_TRUE(value.double_val == 0.1);
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_parse_value(&double_opt, "1.7976931348623157e308", &value));
+    // Past the fast path the value is still read with '.' as the point
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_parse_value(&double_opt, "0.12345678901234567890123", &value));
+    ASSUME_ITS_TRUE(value.double_val == 0.12345678901234567890123);
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_ERROR_RANGE, fossil_arg_parse_value(&double_opt, "1e999", &value));
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_ERROR_INVALID, fossil_arg_parse_value(&double_opt, ".", &value));
+
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_parse_value(&size_opt, "64KiB", &value));
+    ASSUME_ITS_TRUE(value.size_val == 65536);
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_parse_value(&size_opt, "2G", &value));
+    ASSUME_ITS_TRUE(value.size_val == 2ULL << 30);
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_ERROR_RANGE, fossil_arg_parse_value(&size_opt, "16777216T", &value));
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_ERROR_INVALID, fossil_arg_parse_value(&size_opt, "4X", &value));
+
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_parse_value(&duration_opt, "1h30m", &value));
+    ASSUME_ITS_TRUE(value.duration_val == 5400LL * 1000000000LL);
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_parse_value(&duration_opt, "250ms", &value));
+    ASSUME_ITS_TRUE(value.duration_val == 250000000LL);
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_parse_value(&duration_opt, "3", &value));
+    ASSUME_ITS_TRUE(value.duration_val == 3000000000LL);
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_ERROR_INVALID, fossil_arg_parse_value(&duration_opt, "1h30", &value));
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_ERROR_RANGE, fossil_arg_parse_value(&duration_opt, "300000d", &value));
+}
+
+FOSSIL_TEST_CASE(c_test_arg_parse_typed) {
+    const char* argv[] = {"program", "-jobs", "8", "-verbose", "-ratio", "0.75", "-cache", "512M",
+                          "-timeout", "1m30s", "-level", "high", "-mode", "disable", "-offset", "-5000000000"};
+    const int argc = sizeof(argv) / sizeof(argv[0]);
+    fossil_command_line_t cmd = {argc, (char **)argv};
+
+    static fossil_combo_choice_t levels[] = {{"low", 1}, {"high", 2}};
+    fossil_option_t options[] = {
+        {"jobs", COPTION_TYPE_INT, {.int_val = 1}, cnull, 0, 0},
+        {"verbose", COPTION_TYPE_BOOL, {.bool_val = 0}, cnull, 0, 0},
+        {"ratio", COPTION_TYPE_DOUBLE, {.double_val = 0}, cnull, 0, 0},
+        {"cache", COPTION_TYPE_SIZE, {.size_val = 0}, cnull, 0, 0},
+        {"timeout", COPTION_TYPE_DURATION, {.duration_val = 0}, cnull, 0, 0},
+        {"level", COPTION_TYPE_COMBO, {.combo_val = 1}, levels, 2, 0},
+        {"mode", COPTION_TYPE_FEATURE, {.feature_val = FEATURE_AUTO}, cnull, 0, 0},
+        {"offset", COPTION_TYPE_INT64, {.int64_val = 0}, cnull, 0, 0}
+    };
+    int num_options = sizeof(options) / sizeof(options[0]);
+
+    fossil_arg_parse(&cmd, options, num_options);
+
+    ASSUME_ITS_EQUAL_I32(8, options[0].value.int_val);
+    ASSUME_ITS_EQUAL_I32(1, options[1].value.bool_val);
+    ASSUME_ITS_TRUE(options[2].value.double_val == 0.75);
+    ASSUME_ITS_TRUE(options[3].value.size_val == 512ULL << 20);
+    ASSUME_ITS_TRUE(options[4].value.duration_val == 90LL * 1000000000LL);
+    ASSUME_ITS_EQUAL_I32(2, options[5].value.combo_val);
+    ASSUME_ITS_EQUAL_I32(FEATURE_DISABLE, options[6].value.feature_val);
+    ASSUME_ITS_TRUE(options[7].value.int64_val == -5000000000LL);
+}
+
+FOSSIL_TEST_CASE(c_test_arg_parse_response_file) {
+    FILE* file = fopen("fossil_args_response.txt", "w");
+    ASSUME_NOT_CNULL(file);
+    fputs("-jobs 12\n-name \"John Smith\" -verbose\n", file);
+    fclose(file);
+
+    const char* argv[] = {"program", "@fossil_args_response.txt", "-level", "3"};
+    fossil_command_line_t cmd = {4, (char **)argv};
+    fossil_option_t options[] = {
+        {"jobs", COPTION_TYPE_INT, {.int_val = 1}, cnull, 0, 0},
+        {"name", COPTION_TYPE_STRING, {.str_val = cnull}, cnull, 0, 0},
+        {"verbose", COPTION_TYPE_BOOL, {.bool_val = 0}, cnull, 0, 0},
+        {"level", COPTION_TYPE_INT, {.int_val = 0}, cnull, 0, 0}
+    };
+
+    fossil_arg_parse(&cmd, options, 4);
+
+    ASSUME_ITS_EQUAL_I32(12, options[0].value.int_val);
+    ASSUME_ITS_EQUAL_CSTR("John Smith", options[1].value.str_val);
+    ASSUME_ITS_EQUAL_I32(1, options[2].value.bool_val);
+    ASSUME_ITS_EQUAL_I32(3, options[3].value.int_val);
+
+    // An option's value is never a response file, even when one exists
+    const char* literal_argv[] = {"program", "-name", "@fossil_args_response.txt", "-level", "4"};
+    fossil_command_line_t literal_cmd = {5, (char **)literal_argv};
+    options[0].value.int_val = 1;
+    fossil_arg_parse(&literal_cmd, options, 4);
+    remove("fossil_args_response.txt");
+
+    ASSUME_ITS_EQUAL_CSTR("@fossil_args_response.txt", options[1].value.str_val);
+    ASSUME_ITS_EQUAL_I32(1, options[0].value.int_val);
+    ASSUME_ITS_EQUAL_I32(4, options[3].value.int_val);
+    fossil_arg_release_response_files();
+}
+
+FOSSIL_TEST_CASE(c_test_arg_check_unrecognized_response_file) {
+#ifndef _WIN32
+    FILE* file = fopen("fossil_args_unknown.txt", "w");
+    ASSUME_NOT_CNULL(file);
+    fputs("-jobs 2 -bogus\n", file);
+    fclose(file);
+
+    fossil_option_t options[] = {
+        {"jobs", COPTION_TYPE_INT, {.int_val = 1}, cnull, 0, 0}
+    };
+    const char* argv[] = {"program", "@fossil_args_unknown.txt"};
+    fossil_command_line_t cmd = {2, (char **)argv};
+
+    // Options read from the file are checked like the ones on the command line
+    fflush(cnull);
+    pid_t pid = fork();
+    ASSUME_ITS_TRUE(pid >= 0);
+    if (pid == 0) {
+        freopen("/dev/null", "w", stderr);
+        fossil_arg_check_unrecognized(&cmd, options, 1);
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    remove("fossil_args_unknown.txt");
+    ASSUME_ITS_TRUE(WIFEXITED(status));
+    ASSUME_ITS_EQUAL_I32(EXIT_FAILURE, WEXITSTATUS(status));
+#endif
+}
+
+typedef struct {
+    int32_t remaining;
+    char buffer[16];
+} c_arg_counter_t;
+
+// Produces "-count <n>" pairs without ever holding the full argument list
+static const char* c_arg_counter_next(void* context) {
+    c_arg_counter_t* counter = (c_arg_counter_t*)context;
+    if (counter->remaining == 0) {
+        return cnull;
+    }
+    if (--counter->remaining % 2 == 1) {
+        return "-count";
+    }
+    snprintf(counter->buffer, sizeof(counter->buffer), "%d", counter->remaining / 2);
+    return counter->buffer;
+}
+
+FOSSIL_TEST_CASE(c_test_arg_parse_stream) {
+    c_arg_counter_t counter = {200000, {0}};
+    fossil_option_t options[] = {
+        {"count", COPTION_TYPE_INT, {.int_val = -1}, cnull, 0, 0}
+    };
+
+    fossil_arg_parse_stream(c_arg_counter_next, &counter, options, 1);
+
+    ASSUME_ITS_EQUAL_I32(0, counter.remaining);
+    ASSUME_ITS_EQUAL_I32(1, options[0].parsed);
+    ASSUME_ITS_EQUAL_I32(0, options[0].value.int_val);
+}
+
+FOSSIL_TEST_CASE(c_test_arg_resolve_layers) {
+    FILE* file = fopen("fossil_args_config.ini", "w");
+    ASSUME_NOT_CNULL(file);
+    fputs("# defaults for the tool\n"
+          "jobs = 4\n"
+          "name = \"from \\\"config\\\"\" ; trailing comment\n"
+          "[build]\n"
+          "level: 2\n"
+          "verbose = true\n"
+          "[other]\n"
+          "level = 9\n", file);
+    fclose(file);
+
+    const char* argv[] = {"program", "-jobs", "8"};
+    fossil_command_line_t cmd = {3, (char **)argv};
+    fossil_option_t options[] = {
+        {"jobs", COPTION_TYPE_INT, {.int_val = 1}, cnull, 0, 0},
+        {"name", COPTION_TYPE_STRING, {.str_val = cnull}, cnull, 0, 0},
+        {"level", COPTION_TYPE_INT, {.int_val = 0}, cnull, 0, 0},
+        {"verbose", COPTION_TYPE_BOOL, {.bool_val = 0}, cnull, 0, 0},
+        {"path", COPTION_TYPE_STRING, {.str_val = cnull}, cnull, 0, 0}
+    };
+    fossil_arg_layers_t layers = {"fossil_args_config.ini", "build", ""};
+
+    // Config file, then the environment (PATH), then the command line
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_resolve(&cmd, options, 5, &layers));
+    ASSUME_ITS_EQUAL_I32(8, options[0].value.int_val);
+    ASSUME_ITS_EQUAL_CSTR("from \"config\"", options[1].value.str_val);
+    ASSUME_ITS_EQUAL_I32(2, options[2].value.int_val);
+    ASSUME_ITS_EQUAL_I32(1, options[3].value.bool_val);
+    ASSUME_ITS_EQUAL_CSTR(getenv("PATH"), options[4].value.str_val);
+
+    // A second resolve reuses the cached file, a changed file is reloaded
+    options[2].value.int_val = 0;
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_resolve(&cmd, options, 4, &layers));
+    ASSUME_ITS_EQUAL_I32(2, options[2].value.int_val);
+
+    file = fopen("fossil_args_config.ini", "w");
+    fputs("[build]\nlevel = 30\nbroken line\n", file);
+    fclose(file);
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_ERROR_INVALID, fossil_arg_resolve(cnull, options, 4, &layers));
+    ASSUME_ITS_EQUAL_I32(30, options[2].value.int_val);
+    ASSUME_ITS_EQUAL_CSTR("from \"config\"", options[1].value.str_val);
+
+    remove("fossil_args_config.ini");
+    fossil_arg_release_response_files();
+}
+
+FOSSIL_TEST_CASE(c_test_arg_build_options) {
+    const char* level_names[] = {"low", "high"};
+    const int32_t level_values[] = {1, 2};
+    fossil_option_spec_t specs[] = {
+        {"jobs", COPTION_TYPE_INT, {.int_val = 4}, cnull, cnull, 0},
+        {"level", COPTION_TYPE_COMBO, {.combo_val = 1}, level_names, level_values, 2}
+    };
+
+    // Heap table: one block, one free
+    fossil_option_t* options = cnull;
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_build_options(specs, 2, cnull, &options));
+    ASSUME_NOT_CNULL(options);
+    ASSUME_ITS_EQUAL_CSTR("level", options[1].name);
+    ASSUME_ITS_EQUAL_I32(2, options[1].num_choices);
+    ASSUME_ITS_EQUAL_CSTR("high", ((fossil_combo_choice_t*)options[1].extra_data)[1].name);
+    ASSUME_ITS_TRUE(options[1].name != specs[1].name);
+
+    const char* argv[] = {"program", "-level", "high", "-jobs", "6"};
+    fossil_command_line_t cmd = {5, (char **)argv};
+    fossil_arg_parse(&cmd, options, 2);
+    ASSUME_ITS_EQUAL_I32(2, options[1].value.combo_val);
+    ASSUME_ITS_EQUAL_I32(6, options[0].value.int_val);
+    fossil_arg_free_options(options);
+
+    // Arena table: everything lands inside the caller's buffer
+    static _Alignas(16) unsigned char buffer[512];
+    fossil_arg_arena_t arena = {buffer, sizeof(buffer), 0};
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_build_options(specs, 2, &arena, &options));
+    ASSUME_ITS_TRUE((unsigned char*)options == buffer);
+    ASSUME_ITS_TRUE(arena.used <= fossil_arg_options_size(specs, 2));
+    ASSUME_ITS_TRUE((unsigned char*)options[1].name < buffer + arena.used);
+
+    fossil_arg_arena_t small = {buffer, 16, 0};
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_ERROR_NOMEM, fossil_arg_build_options(specs, 2, &small, &options));
+    ASSUME_ITS_EQUAL_I32(0, (int32_t)small.used);
+
+    specs[1].num_choices = 0;
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_ERROR_INVALID, fossil_arg_build_options(specs, 2, cnull, &options));
+}
+
+FOSSIL_TEST_CASE(c_test_arg_create_options_choices) {
+    const char* choice_names[] = {"a", "b", "c"};
+    const int32_t choice_values[] = {1, 2, 3};
+    fossil_combo_choice_t* choices = fossil_arg_create_fossil_combo_choice_ts(choice_names, choice_values, 3);
+    ASSUME_NOT_CNULL(choices);
+
+    const char* names[] = {"mode"};
+    fossil_option_type_t types[] = {COPTION_TYPE_COMBO};
+    fossil_option_value_t values[] = {{.combo_val = 1}};
+    void* extra[] = {choices};
+    const int32_t counts[] = {3};
+    fossil_option_t* options = fossil_arg_create_combo_options(names, types, values, extra, counts, 1);
+    ASSUME_NOT_CNULL(options);
+    ASSUME_ITS_EQUAL_I32(3, options[0].num_choices);
+    fossil_arg_free_options(options);
+
+    // Caller arrays carry no terminator, only the explicit count is trusted
+    fossil_combo_choice_t plain[] = {{"x", 7}, {"y", 8}};
+    extra[0] = plain;
+    const int32_t plain_counts[] = {2};
+    options = fossil_arg_create_combo_options(names, types, values, extra, plain_counts, 1);
+    ASSUME_NOT_CNULL(options);
+    ASSUME_ITS_EQUAL_I32(2, options[0].num_choices);
+    fossil_arg_free_options(options);
+
+    options = fossil_arg_create_options(names, types, values, extra, 1);
+    ASSUME_NOT_CNULL(options);
+    ASSUME_ITS_EQUAL_I32(0, options[0].num_choices);
+    fossil_arg_free_options(options);
+
+    fossil_arg_free_options(choices);
+}
+
+typedef struct {
+    const char* last;
+    int32_t jobs;
+    int32_t argc;
+} c_arg_dispatch_t;
+
+static int32_t c_arg_record_build(fossil_command_line_t* cmd, fossil_option_t* options, int32_t num_options, void* user_data) {
+    c_arg_dispatch_t* record = (c_arg_dispatch_t*)user_data;
+    record->last = "build";
+    record->jobs = num_options > 0 ? options[0].value.int_val : -1;
+    record->argc = cmd->argc;
+    return 0;
+}
+
+static int32_t c_arg_record_remote_add(fossil_command_line_t* cmd, fossil_option_t* options, int32_t num_options, void* user_data) {
+    c_arg_dispatch_t* record = (c_arg_dispatch_t*)user_data;
+    (void)options;
+    (void)num_options;
+    record->last = "remote add";
+    record->argc = cmd->argc;
+    return 7;
+}
+
+FOSSIL_TEST_CASE(c_test_arg_commands_dispatch) {
+    c_arg_dispatch_t record = {cnull, 0, 0};
+    fossil_option_spec_t build_specs[] = {
+        {"jobs", COPTION_TYPE_INT, {.int_val = 1}, cnull, cnull, 0}
+    };
+    fossil_arg_commands_t* commands = fossil_arg_commands_create();
+    ASSUME_NOT_CNULL(commands);
+
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_commands_register(commands, "build", c_arg_record_build, build_specs, 1, &record));
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_commands_register(commands, "remote add", c_arg_record_remote_add, cnull, 0, &record));
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_ERROR_INVALID, fossil_arg_commands_register(commands, "build", c_arg_record_build, cnull, 0, &record));
+
+    // Hundreds of siblings sharing prefixes with the real commands
+    static char names[300][16];
+    for (int i = 0; i < 300; ++i) {
+        snprintf(names[i], sizeof(names[i]), "build%d", i);
+        ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_commands_register(commands, names[i], c_arg_record_build, cnull, 0, &record));
+    }
+
+    const char* build_argv[] = {"tool", "build", "-jobs", "8", "target"};
+    fossil_command_line_t build_cmd = {5, (char **)build_argv};
+    ASSUME_ITS_EQUAL_I32(0, fossil_arg_commands_dispatch(commands, &build_cmd));
+    ASSUME_ITS_EQUAL_CSTR("build", record.last);
+    ASSUME_ITS_EQUAL_I32(8, record.jobs);
+    ASSUME_ITS_EQUAL_I32(4, record.argc);
+
+    // The next dispatch starts from the declared default again
+    const char* plain_argv[] = {"tool", "build"};
+    fossil_command_line_t plain_cmd = {2, (char **)plain_argv};
+    ASSUME_ITS_EQUAL_I32(0, fossil_arg_commands_dispatch(commands, &plain_cmd));
+    ASSUME_ITS_EQUAL_I32(1, record.jobs);
+
+    const char* add_argv[] = {"tool", "remote", "add", "origin"};
+    fossil_command_line_t add_cmd = {4, (char **)add_argv};
+    ASSUME_ITS_EQUAL_I32(7, fossil_arg_commands_dispatch(commands, &add_cmd));
+    ASSUME_ITS_EQUAL_CSTR("remote add", record.last);
+    ASSUME_ITS_EQUAL_I32(2, record.argc);
+
+    // "remote" alone is only an inner node, "bui" only a prefix
+    const char* remote_argv[] = {"tool", "remote"};
+    fossil_command_line_t remote_cmd = {2, (char **)remote_argv};
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_ERROR_INVALID, fossil_arg_commands_dispatch(commands, &remote_cmd));
+    const char* prefix_argv[] = {"tool", "bui"};
+    fossil_command_line_t prefix_cmd = {2, (char **)prefix_argv};
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_ERROR_INVALID, fossil_arg_commands_dispatch(commands, &prefix_cmd));
+
+    fossil_arg_commands_free(commands);
+}
+
+#ifndef _WIN32
+typedef struct {
+    fossil_arg_commands_t* commands;
+    const char* jobs;
+    int32_t mismatches;
+} c_arg_dispatch_worker_t;
+
+static int32_t c_arg_check_jobs(fossil_command_line_t* cmd, fossil_option_t* options, int32_t num_options, void* user_data) {
+    (void)user_data;
+    // The parsed table must hold this call's value, not another thread's
+    return num_options == 1 && options[0].value.int_val == atoi(cmd->argv[2]) ? 0 : 1;
+}
+
+static void* c_arg_dispatch_worker(void* arg) {
+    c_arg_dispatch_worker_t* worker = (c_arg_dispatch_worker_t*)arg;
+    const char* argv[] = {"tool", "build", "-jobs", worker->jobs};
+    fossil_command_line_t cmd = {4, (char **)argv};
+    for (int i = 0; i < 2000; ++i) {
+        worker->mismatches += fossil_arg_commands_dispatch(worker->commands, &cmd) != 0;
+    }
+    return NULL;
+}
+#endif
+
+FOSSIL_TEST_CASE(c_test_arg_commands_dispatch_threads) {
+#ifndef _WIN32
+    fossil_option_spec_t build_specs[] = {
+        {"jobs", COPTION_TYPE_INT, {.int_val = 1}, cnull, cnull, 0}
+    };
+    static char names[64][16];
+    fossil_arg_commands_t* commands = fossil_arg_commands_create();
+    ASSUME_NOT_CNULL(commands);
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_commands_register(commands, "build", c_arg_check_jobs, build_specs, 1, cnull));
+
+    c_arg_dispatch_worker_t workers[4] = {
+        {commands, "2", 0}, {commands, "3", 0}, {commands, "5", 0}, {commands, "7", 0}
+    };
+    pthread_t threads[4];
+    for (int i = 0; i < 4; ++i) {
+        ASSUME_ITS_EQUAL_I32(0, pthread_create(&threads[i], cnull, c_arg_dispatch_worker, &workers[i]));
+    }
+    // Registering meanwhile grows the trie under the dispatchers
+    for (int i = 0; i < 64; ++i) {
+        snprintf(names[i], sizeof(names[i]), "extra%d", i);
+        fossil_arg_commands_register(commands, names[i], c_arg_check_jobs, cnull, 0, cnull);
+    }
+    for (int i = 0; i < 4; ++i) {
+        pthread_join(threads[i], cnull);
+        ASSUME_ITS_EQUAL_I32(0, workers[i].mismatches);
+    }
+
+    fossil_arg_commands_free(commands);
+#endif
+}
+
+FOSSIL_TEST_CASE(c_test_arg_parse_index_reuse) {
+    // More option arrays in turn than a small cache would hold
+    enum { NUM_TABLES = 24 };
+    static fossil_option_t tables[NUM_TABLES][2];
+    const char* argv[] = {"program", "-level", "3", "-quiet"};
+    fossil_command_line_t cmd = {4, (char **)argv};
+
+    for (int round = 0; round < 3; ++round) {
+        for (int t = 0; t < NUM_TABLES; ++t) {
+            fossil_option_t* options = tables[t];
+            options[0] = (fossil_option_t){"level", COPTION_TYPE_INT, {.int_val = 0}, cnull, 0, 0, cnull};
+            options[1] = (fossil_option_t){"quiet", COPTION_TYPE_BOOL, {.bool_val = 0}, cnull, 0, 0, cnull};
+            fossil_arg_parse(&cmd, options, 2);
+            ASSUME_ITS_EQUAL_I32(3, options[0].value.int_val);
+            ASSUME_ITS_EQUAL_I32(1, options[1].value.bool_val);
+        }
+    }
+
+    // Renaming an option in place is seen by the next parse
+    fossil_option_t* options = tables[0];
+    options[1].name = "silent";
+    options[1].value.bool_val = 0;
+    const char* renamed_argv[] = {"program", "-silent"};
+    fossil_command_line_t renamed = {2, (char **)renamed_argv};
+    fossil_arg_parse(&renamed, options, 2);
+    ASSUME_ITS_EQUAL_I32(1, options[1].value.bool_val);
+    ASSUME_ITS_EQUAL_I32(0, fossil_arg_parse_has(options, 2, "quiet"));
+
+    // So is a name whose text is edited without moving it
+    static char name[] = "mode";
+    options[1].name = name;
+    fossil_arg_parse(&renamed, options, 2);
+    name[0] = 'n';
+    ASSUME_ITS_EQUAL_I32(0, fossil_arg_parse_has(options, 2, "mode"));
+    const char* edited_argv[] = {"program", "-node"};
+    fossil_command_line_t edited = {2, (char **)edited_argv};
+    options[1].value.bool_val = 0;
+    fossil_arg_parse(&edited, options, 2);
+    ASSUME_ITS_EQUAL_I32(1, options[1].value.bool_val);
+    ASSUME_ITS_EQUAL_I32(1, fossil_arg_parse_has(options, 2, "node"));
+}
+
+FOSSIL_TEST_CASE(c_test_arg_parse_syntax) {
+    const char* argv[] = {"program", "--name=John", "--jobs", "3", "-vx", "-l5", "--no-color",
+                          "--cache=disable", "--", "-o", "ignored"};
+    const int argc = sizeof(argv) / sizeof(argv[0]);
+    fossil_command_line_t cmd = {argc, (char **)argv};
+    fossil_option_t options[] = {
+        {"name", COPTION_TYPE_STRING, {.str_val = cnull}, cnull, 0, 0},
+        {"jobs", COPTION_TYPE_INT, {.int_val = 1}, cnull, 0, 0},
+        {"v", COPTION_TYPE_BOOL, {.bool_val = 0}, cnull, 0, 0},
+        {"x", COPTION_TYPE_BOOL, {.bool_val = 0}, cnull, 0, 0},
+        {"l", COPTION_TYPE_INT, {.int_val = 0}, cnull, 0, 0},
+        {"color", COPTION_TYPE_BOOL, {.bool_val = 1}, cnull, 0, 0},
+        {"cache", COPTION_TYPE_FEATURE, {.feature_val = FEATURE_AUTO}, cnull, 0, 0},
+        {"o", COPTION_TYPE_STRING, {.str_val = cnull}, cnull, 0, 0}
+    };
+
+    fossil_arg_parse(&cmd, options, 8);
+
+    ASSUME_ITS_EQUAL_CSTR("John", options[0].value.str_val);
+    ASSUME_ITS_EQUAL_I32(3, options[1].value.int_val);
+    ASSUME_ITS_EQUAL_I32(1, options[2].value.bool_val);
+    ASSUME_ITS_EQUAL_I32(1, options[3].value.bool_val);
+    ASSUME_ITS_EQUAL_I32(5, options[4].value.int_val);
+    ASSUME_ITS_EQUAL_I32(0, options[5].value.bool_val);
+    ASSUME_ITS_EQUAL_I32(FEATURE_DISABLE, options[6].value.feature_val);
+    ASSUME_ITS_EQUAL_I32(0, options[7].parsed);
+}
+
+FOSSIL_TEST_CASE(c_test_arg_parse_syntax_throughput) {
+    // Benchmark: a mix of every syntax over a large synthetic command line
+    enum { NUM_ARGS = 200000 };
+    char **argv = calloc(NUM_ARGS + 1, sizeof(char *));
+    fossil_option_t options[] = {
+        {"threads", COPTION_TYPE_INT, {.int_val = 0}, cnull, 0, 0},
+        {"output", COPTION_TYPE_STRING, {.str_val = cnull}, cnull, 0, 0},
+        {"a", COPTION_TYPE_BOOL, {.bool_val = 0}, cnull, 0, 0},
+        {"b", COPTION_TYPE_BOOL, {.bool_val = 0}, cnull, 0, 0},
+        {"debug", COPTION_TYPE_BOOL, {.bool_val = 0}, cnull, 0, 0}
+    };
+    static const char* forms[] = {"--threads=16", "--output", "out.txt", "-ab", "--no-debug", "input.c"};
+
+    argv[0] = (char *)"program";
+    for (int i = 1; i <= NUM_ARGS; ++i) {
+        argv[i] = (char *)forms[(i - 1) % 6];
+    }
+
+    fossil_command_line_t cmd = {NUM_ARGS + 1, argv};
+    fossil_arg_parse(&cmd, options, 5);
+
+    ASSUME_ITS_EQUAL_I32(16, options[0].value.int_val);
+    ASSUME_ITS_EQUAL_CSTR("out.txt", options[1].value.str_val);
+    ASSUME_ITS_EQUAL_I32(1, options[3].value.bool_val);
+    ASSUME_ITS_EQUAL_I32(1, options[4].parsed);
+    ASSUME_ITS_EQUAL_I32(0, options[4].value.bool_val);
+
+    free(argv);
+}
+
+FOSSIL_TEST_CASE(c_test_arg_parse_into) {
+    fossil_option_spec_t specs[] = {
+        {"jobs", COPTION_TYPE_INT, {.int_val = 2}, cnull, cnull, 0},
+        {"verbose", COPTION_TYPE_BOOL, {.bool_val = 0}, cnull, cnull, 0},
+        {"limit", COPTION_TYPE_SIZE, {.size_val = 1024}, cnull, cnull, 0}
+    };
+    fossil_arg_schema_t* schema = fossil_arg_schema_create(specs, 3);
+    ASSUME_NOT_CNULL(schema);
+    fossil_arg_result_t* result = fossil_arg_result_create(schema);
+    ASSUME_NOT_CNULL(result);
+    int32_t jobs = fossil_arg_schema_find(schema, "jobs");
+    int32_t verbose = fossil_arg_schema_find(schema, "verbose");
+    int32_t limit = fossil_arg_schema_find(schema, "limit");
+    ASSUME_ITS_EQUAL_I32(-1, fossil_arg_schema_find(schema, "bogus"));
+
+    const char* argv[] = {"rpc", "--jobs=9", "-verbose"};
+    fossil_command_line_t cmd = {3, (char **)argv};
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_parse_into(schema, &cmd, result));
+    ASSUME_ITS_EQUAL_I32(9, result->values[jobs].int_val);
+    ASSUME_ITS_EQUAL_I32(1, fossil_arg_result_has(result, verbose));
+    ASSUME_ITS_EQUAL_I32(0, fossil_arg_result_has(result, limit));
+    ASSUME_ITS_TRUE(result->values[limit].size_val == 1024);
+
+    // The schema keeps its defaults and a reused result starts from them again
+    int32_t num_options = 0;
+    const fossil_option_t* options = fossil_arg_schema_options(schema, &num_options);
+    ASSUME_ITS_EQUAL_I32(3, num_options);
+    ASSUME_ITS_EQUAL_I32(2, options[jobs].value.int_val);
+    ASSUME_ITS_EQUAL_I32(0, options[jobs].parsed);
+
+    const char* bad_argv[] = {"rpc", "-limit", "12Q", "--unknown"};
+    fossil_command_line_t bad_cmd = {4, (char **)bad_argv};
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_ERROR_INVALID, fossil_arg_parse_into(schema, &bad_cmd, result));
+    ASSUME_ITS_EQUAL_I32(limit, result->error_option);
+    ASSUME_ITS_EQUAL_I32(2, result->values[jobs].int_val);
+    ASSUME_ITS_EQUAL_I32(0, fossil_arg_result_has(result, verbose));
+
+    fossil_arg_result_free(result);
+    fossil_arg_schema_free(schema);
+}
+
+FOSSIL_TEST_CASE(c_test_arg_format_usage) {
+    static fossil_combo_choice_t levels[] = {{"low", 1}, {"high", 2}};
+    fossil_option_t options[] = {
+        {"jobs", COPTION_TYPE_INT, {.int_val = 4}, cnull, 0, 0, "Number of worker threads that build in parallel"},
+        {"level", COPTION_TYPE_COMBO, {.combo_val = 2}, levels, 2, 0, cnull},
+        {"mode", COPTION_TYPE_COMBO, {.combo_val = 1}, cnull, 0, 0, cnull},
+        {"verbose", COPTION_TYPE_BOOL, {.bool_val = 0}, cnull, 0, 0, cnull}
+    };
+    char buffer[1024];
+
+    size_t length = fossil_arg_format_usage("tool", options, 4, 50, buffer, sizeof(buffer));
+    ASSUME_ITS_TRUE(length == strlen(buffer));
+    ASSUME_NOT_CNULL(strstr(buffer, "  -jobs <int>"));
+    ASSUME_NOT_CNULL(strstr(buffer, "(default: 4)"));
+    ASSUME_NOT_CNULL(strstr(buffer, "-level {low|high}"));
+    ASSUME_NOT_CNULL(strstr(buffer, "(default: high)"));
+    ASSUME_NOT_CNULL(strstr(buffer, "-mode <choice>"));
+    ASSUME_NOT_CNULL(strstr(buffer, "  -verbose (flag)\n"));
+
+    // Wrapped lines stay within the width
+    for (const char* line = buffer; *line; ) {
+        const char* end = strchr(line, '\n');
+        ASSUME_ITS_TRUE(end != cnull && end - line <= 50);
+        line = end + 1;
+    }
+
+    // A short buffer is truncated but still reports the full length
+    char small[8];
+    ASSUME_ITS_TRUE(fossil_arg_format_usage("tool", options, 4, 50, small, sizeof(small)) == length);
+    ASSUME_ITS_EQUAL_CSTR("Usage: ", small);
+
+    // Long STRING defaults are shown whole
+    fossil_option_t path[] = {
+        {"config", COPTION_TYPE_STRING, {.str_val = "/etc/fossil/services/production/cluster-overrides/default-settings.conf"}, cnull, 0, 0, cnull}
+    };
+    fossil_arg_format_usage("tool", path, 1, 200, buffer, sizeof(buffer));
+    ASSUME_NOT_CNULL(strstr(buffer, "(default: /etc/fossil/services/production/cluster-overrides/default-settings.conf)\n"));
+}
+
+FOSSIL_TEST_CASE(c_test_arg_schema_usage) {
+    fossil_option_spec_t specs[] = {
+        {"timeout", COPTION_TYPE_DURATION, {.duration_val = 1500000000LL}, cnull, cnull, 0, "Time to wait"}
+    };
+    fossil_arg_schema_t* schema = fossil_arg_schema_create(specs, 1);
+    ASSUME_NOT_CNULL(schema);
+    char first[256];
+    char second[256];
+
+    size_t length = fossil_arg_schema_usage(schema, "tool", 0, first, sizeof(first));
+    ASSUME_ITS_TRUE(fossil_arg_schema_usage(schema, "tool", 0, second, sizeof(second)) == length);
+    ASSUME_ITS_EQUAL_CSTR(first, second);
+    ASSUME_NOT_CNULL(strstr(first, "Time to wait (default: 1500ms)"));
+
+    // A different program name renders again
+    fossil_arg_schema_usage(schema, "other", 0, second, sizeof(second));
+    ASSUME_NOT_CNULL(strstr(second, "Usage: other"));
+    fossil_arg_schema_free(schema);
+}
+
+FOSSIL_TEST_CASE(c_test_arg_completion) {
+    fossil_combo_choice_t levels[] = {{"low", 0}, {"lower", 1}, {"high", 2}, {cnull, 0}};
+    fossil_option_t options[] = {
+        {"verbose", COPTION_TYPE_BOOL, {.bool_val = false}, cnull, 0, 0, cnull},
+        {"level", COPTION_TYPE_COMBO, {.combo_val = 0}, levels, 3, 0, cnull},
+        {"cache", COPTION_TYPE_FEATURE, {.feature_val = FEATURE_AUTO}, cnull, 0, 0, cnull},
+        {"limit", COPTION_TYPE_SIZE, {.size_val = 0}, cnull, 0, 0, cnull},
+        {"j", COPTION_TYPE_INT, {.int_val = 1}, cnull, 0, 0, cnull}
+    };
+    fossil_arg_completion_t* completion = fossil_arg_completion_create(options, 5);
+    ASSUME_NOT_CNULL(completion);
+    char buffer[256];
+
+    fossil_arg_complete(completion, "tool", "--l", buffer, sizeof(buffer));
+    ASSUME_ITS_EQUAL_CSTR("--level\n--limit\n", buffer);
+    fossil_arg_complete(completion, "tool", "-", buffer, sizeof(buffer));
+    ASSUME_ITS_EQUAL_CSTR("--cache\n-j\n--level\n--limit\n--verbose\n", buffer);
+    fossil_arg_complete(completion, "--level", "lo", buffer, sizeof(buffer));
+    ASSUME_ITS_EQUAL_CSTR("low\nlower\n", buffer);
+    fossil_arg_complete(completion, "-cache", "", buffer, sizeof(buffer));
+    ASSUME_ITS_EQUAL_CSTR("enable\ndisable\nauto\n", buffer);
+    fossil_arg_complete(completion, "tool", "--cache=d", buffer, sizeof(buffer));
+    ASSUME_ITS_EQUAL_CSTR("--cache=disable\n", buffer);
+
+    // Free values and positionals have nothing to offer; a flag does not take one
+    ASSUME_ITS_TRUE(fossil_arg_complete(completion, "--limit", "", buffer, sizeof(buffer)) == 0);
+    ASSUME_ITS_TRUE(fossil_arg_complete(completion, "tool", "file", buffer, sizeof(buffer)) == 0);
+    fossil_arg_complete(completion, "--verbose", "--v", buffer, sizeof(buffer));
+    ASSUME_ITS_EQUAL_CSTR("--verbose\n", buffer);
+
+    char* argv[] = {"tool", "--level", "high"};
+    fossil_command_line_t cmd = {3, argv};
+    ASSUME_ITS_EQUAL_I32(0, fossil_arg_completion_request(completion, &cmd));
+    fossil_arg_completion_free(completion);
+}
+
+FOSSIL_TEST_CASE(c_test_arg_completion_script) {
+    fossil_combo_choice_t levels[] = {{"low", 0}, {"high", 1}, {cnull, 0}};
+    fossil_option_t options[] = {
+        {"level", COPTION_TYPE_COMBO, {.combo_val = 0}, levels, 2, 0, "Detail [0-1]: how much"},
+        {"cache", COPTION_TYPE_FEATURE, {.feature_val = FEATURE_AUTO}, cnull, 0, 0, "Reuse 'old' results"},
+        {"v", COPTION_TYPE_BOOL, {.bool_val = false}, cnull, 0, 0, cnull}
+    };
+    char buffer[1024];
+
+    size_t length = fossil_arg_completion_script("my-tool", options, 3, FOSSIL_ARG_SHELL_BASH, buffer, sizeof(buffer));
+    ASSUME_ITS_TRUE(length == strlen(buffer));
+    ASSUME_NOT_CNULL(strstr(buffer, "--level) COMPREPLY=($(compgen -W 'low high' -- \"$cur\")); return ;;"));
+    ASSUME_NOT_CNULL(strstr(buffer, "--cache) COMPREPLY=($(compgen -W 'enable disable auto'"));
+    ASSUME_NOT_CNULL(strstr(buffer, "compgen -W '--level --cache -v'"));
+    ASSUME_NOT_CNULL(strstr(buffer, "complete -F _fossil_complete_my_tool my-tool"));
+
+    fossil_arg_completion_script("my-tool", options, 3, FOSSIL_ARG_SHELL_ZSH, buffer, sizeof(buffer));
+    ASSUME_NOT_CNULL(strstr(buffer, "'--level[Detail \\[0-1\\]\\: how much]:value:(low high)'"));
+    ASSUME_NOT_CNULL(strstr(buffer, "'-v[v]'"));
+
+    fossil_arg_completion_script("my-tool", options, 3, FOSSIL_ARG_SHELL_FISH, buffer, sizeof(buffer));
+    ASSUME_NOT_CNULL(strstr(buffer, "complete -c my-tool -l cache -x -a 'enable disable auto' -d 'Reuse '\\''old'\\'' results'"));
+    ASSUME_NOT_CNULL(strstr(buffer, "complete -c my-tool -s v\n"));
+
+    fossil_arg_completion_script("my-tool", options, 3, FOSSIL_ARG_SHELL_BASH | FOSSIL_ARG_SHELL_DYNAMIC, buffer, sizeof(buffer));
+    ASSUME_NOT_CNULL(strstr(buffer, "my-tool --fossil-complete"));
+
+    fossil_arg_completion_script("my-tool", options, 3, FOSSIL_ARG_SHELL_FISH | FOSSIL_ARG_SHELL_DYNAMIC, buffer, sizeof(buffer));
+    ASSUME_NOT_CNULL(strstr(buffer, "complete -c my-tool -f -a '(my-tool --fossil-complete (commandline -opc)[-1] (commandline -ct))'\n"));
+
+    // Long program names keep whole headers and footers
+    const char* program = "deploy-manager-for-production-clusters";
+    length = fossil_arg_completion_script(program, options, 3, FOSSIL_ARG_SHELL_BASH, buffer, sizeof(buffer));
+    ASSUME_ITS_TRUE(length == strlen(buffer));
+    ASSUME_NOT_CNULL(strstr(buffer, "# bash completion for deploy-manager-for-production-clusters\n_fossil_complete_deploy_manager_for_production_clusters() {\n"));
+    ASSUME_NOT_CNULL(strstr(buffer, "complete -F _fossil_complete_deploy_manager_for_production_clusters deploy-manager-for-production-clusters\n"));
+    fossil_arg_completion_script(program, options, 3, FOSSIL_ARG_SHELL_ZSH, buffer, sizeof(buffer));
+    ASSUME_NOT_CNULL(strstr(buffer, "#compdef deploy-manager-for-production-clusters\n_fossil_complete_deploy_manager_for_production_clusters() {\n"));
+    ASSUME_NOT_CNULL(strstr(buffer, "compdef _fossil_complete_deploy_manager_for_production_clusters deploy-manager-for-production-clusters\n"));
+    length = fossil_arg_completion_script(program, options, 3, FOSSIL_ARG_SHELL_FISH | FOSSIL_ARG_SHELL_DYNAMIC, buffer, sizeof(buffer));
+    ASSUME_ITS_TRUE(length == strlen(buffer));
+    ASSUME_NOT_CNULL(strstr(buffer, "complete -c deploy-manager-for-production-clusters -f -a '(deploy-manager-for-production-clusters --fossil-complete (commandline -opc)[-1] (commandline -ct))'\n"));
+
+    // Names that would need quoting are refused
+    ASSUME_ITS_TRUE(fossil_arg_completion_script("rm -rf", options, 3, FOSSIL_ARG_SHELL_BASH, buffer, sizeof(buffer)) == 0);
+    ASSUME_ITS_TRUE(fossil_arg_completion_script("tool", options, 3, 7, buffer, sizeof(buffer)) == 0);
+}
+
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Pool
 // * * * * * * * * * * * * * * * * * * * * * * * *
@@ -82,6 +828,25 @@ FOSSIL_TEST_CASE(c_test_arg_parse) {
 FOSSIL_TEST_GROUP(c_commandline_tests) {
     FOSSIL_TEST_ADD(c_args_suite, c_test_arg_parse_has);
     FOSSIL_TEST_ADD(c_args_suite, c_test_arg_parse);
+    FOSSIL_TEST_ADD(c_args_suite, c_test_arg_parse_many_options);
+    FOSSIL_TEST_ADD(c_args_suite, c_test_arg_parse_index_reuse);
+    FOSSIL_TEST_ADD(c_args_suite, c_test_arg_parse_value);
+    FOSSIL_TEST_ADD(c_args_suite, c_test_arg_parse_typed);
+    FOSSIL_TEST_ADD(c_args_suite, c_test_arg_parse_response_file);
+    FOSSIL_TEST_ADD(c_args_suite, c_test_arg_check_unrecognized_response_file);
+    FOSSIL_TEST_ADD(c_args_suite, c_test_arg_parse_stream);
+    FOSSIL_TEST_ADD(c_args_suite, c_test_arg_resolve_layers);
+    FOSSIL_TEST_ADD(c_args_suite, c_test_arg_build_options);
+    FOSSIL_TEST_ADD(c_args_suite, c_test_arg_create_options_choices);
+    FOSSIL_TEST_ADD(c_args_suite, c_test_arg_commands_dispatch);
+    FOSSIL_TEST_ADD(c_args_suite, c_test_arg_commands_dispatch_threads);
+    FOSSIL_TEST_ADD(c_args_suite, c_test_arg_parse_syntax);
+    FOSSIL_TEST_ADD(c_args_suite, c_test_arg_parse_syntax_throughput);
+    FOSSIL_TEST_ADD(c_args_suite, c_test_arg_parse_into);
+    FOSSIL_TEST_ADD(c_args_suite, c_test_arg_format_usage);
+    FOSSIL_TEST_ADD(c_args_suite, c_test_arg_schema_usage);
+    FOSSIL_TEST_ADD(c_args_suite, c_test_arg_completion);
+    FOSSIL_TEST_ADD(c_args_suite, c_test_arg_completion_script);
 
     FOSSIL_TEST_REGISTER(c_args_suite);
 }
@@ -14,6 +14,11 @@
 #include <fossil/test/framework.h>
 
 #include "fossil/lib/framework.h"
+#include "fossil/lib/arguments.hpp"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
 
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Utilities
@@ -25,6 +30,29 @@
 // Define the test suite and add test cases
 FOSSIL_TEST_SUITE(cpp_args_suite);
 
+// Compile-time schema used by the constexpr parsing samples
+static constexpr fossil_combo_choice_t cpp_level_choices[] = {{"low", 1}, {"high", 2}};
+static constexpr auto cpp_schema = fossil::lib::make_schema({
+    {"jobs", COPTION_TYPE_INT, {.int_val = 4}},
+    {"name", COPTION_TYPE_STRING},
+    {"verbose", COPTION_TYPE_BOOL},
+    {"level", COPTION_TYPE_COMBO, {.combo_val = 1}, cpp_level_choices, 2},
+    {"cache", COPTION_TYPE_FEATURE, {.feature_val = FEATURE_AUTO}},
+});
+
+static constexpr auto cpp_typed_schema = fossil::lib::make_schema({
+    {"offset", COPTION_TYPE_INT64},
+    {"ratio", COPTION_TYPE_DOUBLE},
+    {"buffer", COPTION_TYPE_SIZE, {.size_val = 4096}},
+    {"timeout", COPTION_TYPE_DURATION},
+});
+
+static constexpr auto cpp_short_schema = fossil::lib::make_schema({
+    {"a", COPTION_TYPE_BOOL},
+    {"b", COPTION_TYPE_BOOL},
+    {"j", COPTION_TYPE_INT, {.int_val = 1}},
+});
+
 // Setup function for the test suite
 FOSSIL_SETUP(cpp_args_suite) {
     // Setup code here
@@ -101,6 +129,344 @@ FOSSIL_TEST_CASE(cpp_test_arg_parse) {
     ASSUME_ITS_EQUAL_I32(0, options[1].value.bool_val);
 }
 
+FOSSIL_TEST_CASE(cpp_test_arg_parse_many_options) {
+    // Benchmark: 10k arguments against 1k options, lookups go through the hashed index
+    enum { NUM_OPTIONS = 1000, NUM_ARGS = 10000 };
+    fossil_option_t *options = (fossil_option_t *)calloc(NUM_OPTIONS, sizeof(fossil_option_t));
+    char **argv = (char **)calloc(NUM_ARGS + 1, sizeof(char *));
+    char *names = (char *)calloc(NUM_OPTIONS, 16);
+    static char values[NUM_ARGS / 2][8];
+
+    for (int i = 0; i < NUM_OPTIONS; ++i) {
+        snprintf(names + i * 16, 16, "opt%d", i);
+        options[i].name = names + i * 16;
+        options[i].type = COPTION_TYPE_INT;
+    }
+
+    static char flags[NUM_ARGS / 2][16];
+    argv[0] = (char *)"program";
+    for (int i = 0; i < NUM_ARGS / 2; ++i) {
+        snprintf(flags[i], sizeof(flags[i]), "-opt%d", (i * 7) % NUM_OPTIONS);
+        snprintf(values[i], sizeof(values[i]), "%d", i);
+        argv[1 + i * 2] = flags[i];
+        argv[2 + i * 2] = values[i];
+    }
+
+    fossil_command_line_t cmd = {NUM_ARGS + 1, argv};
+    fossil_arg_parse(&cmd, options, NUM_OPTIONS);
+
+    // The last occurrence of each option wins
+    ASSUME_ITS_EQUAL_I32(4999, options[(4999 * 7) % NUM_OPTIONS].value.int_val);
+    ASSUME_ITS_EQUAL_I32(1, fossil_arg_parse_has(options, NUM_OPTIONS, "opt0"));
+    ASSUME_ITS_EQUAL_I32(0, fossil_arg_parse_has(options, NUM_OPTIONS, "opt1000"));
+
+    free(names);
+    free(argv);
+    free(options);
+}
+
+FOSSIL_TEST_CASE(cpp_test_arg_constexpr_schema) {
+    // Every declared name is reachable through the compile-time perfect hash
+    static_assert(cpp_schema.find("jobs", 4) == 0);
+    static_assert(cpp_schema.find("cache", 5) == 4);
+    static_assert(cpp_schema.find("job", 3) == -1);
+
+    const char* argv[] = {"program", "-jobs", "16", "-verbose", "-level", "high", "-name", "John"};
+    auto args = fossil::lib::parse<cpp_schema>(8, (char **)argv);
+
+    ASSUME_ITS_TRUE(static_cast<bool>(args));
+    ASSUME_ITS_EQUAL_I32(16, args.get<"jobs">());
+    ASSUME_ITS_TRUE(args.get<"verbose">());
+    ASSUME_ITS_EQUAL_I32(2, args.get<"level">());
+    ASSUME_ITS_EQUAL_CSTR("John", args.get<"name">());
+
+    // Options that were not given keep their declared default
+    ASSUME_ITS_FALSE(args.has<"cache">());
+    ASSUME_ITS_EQUAL_I32(FEATURE_AUTO, args.get<"cache">());
+}
+
+FOSSIL_TEST_CASE(cpp_test_arg_constexpr_errors) {
+    const char* unknown[] = {"program", "-jobs", "2", "-bogus"};
+    auto args = fossil::lib::parse<cpp_schema>(4, (char **)unknown);
+    ASSUME_ITS_TRUE(args.error() == fossil::lib::parse_error::unknown_option);
+    ASSUME_ITS_EQUAL_I32(3, args.error_index());
+
+    const char* overflow[] = {"program", "-jobs", "99999999999"};
+    args = fossil::lib::parse<cpp_schema>(3, (char **)overflow);
+    ASSUME_ITS_TRUE(args.error() == fossil::lib::parse_error::bad_value);
+
+    const char* missing[] = {"program", "-name"};
+    args = fossil::lib::parse<cpp_schema>(2, (char **)missing);
+    ASSUME_ITS_TRUE(args.error() == fossil::lib::parse_error::missing_value);
+}
+
+FOSSIL_TEST_CASE(cpp_test_arg_constexpr_syntax) {
+    // --name value and --name=value
+    const char* long_form[] = {"program", "--jobs", "6", "--name=Ann", "--level=high"};
+    auto args = fossil::lib::parse<cpp_schema>(5, (char **)long_form);
+    ASSUME_ITS_TRUE(static_cast<bool>(args));
+    ASSUME_ITS_EQUAL_I32(6, args.get<"jobs">());
+    ASSUME_ITS_EQUAL_CSTR("Ann", args.get<"name">());
+    ASSUME_ITS_EQUAL_I32(2, args.get<"level">());
+
+    // -name=value, and a flag only takes a value after '='
+    const char* inline_form[] = {"program", "-jobs=3", "-verbose=false", "input.txt"};
+    args = fossil::lib::parse<cpp_schema>(4, (char **)inline_form);
+    ASSUME_ITS_TRUE(static_cast<bool>(args));
+    ASSUME_ITS_EQUAL_I32(3, args.get<"jobs">());
+    ASSUME_ITS_TRUE(args.has<"verbose">());
+    ASSUME_ITS_FALSE(args.get<"verbose">());
+
+    // --no-name turns off flags and features
+    const char* negated[] = {"program", "--verbose", "--no-verbose", "--no-cache"};
+    args = fossil::lib::parse<cpp_schema>(4, (char **)negated);
+    ASSUME_ITS_TRUE(static_cast<bool>(args));
+    ASSUME_ITS_FALSE(args.get<"verbose">());
+    ASSUME_ITS_EQUAL_I32(FEATURE_DISABLE, args.get<"cache">());
+    const char* negated_value[] = {"program", "--no-jobs"};
+    args = fossil::lib::parse<cpp_schema>(2, (char **)negated_value);
+    ASSUME_ITS_TRUE(args.error() == fossil::lib::parse_error::unknown_option);
+
+    // "--" ends the options
+    const char* ended[] = {"program", "--", "--jobs", "9"};
+    args = fossil::lib::parse<cpp_schema>(4, (char **)ended);
+    ASSUME_ITS_TRUE(static_cast<bool>(args));
+    ASSUME_ITS_FALSE(args.has<"jobs">());
+}
+
+FOSSIL_TEST_CASE(cpp_test_arg_constexpr_bundles) {
+    // Flags run together, the first option with a value takes the rest of the word
+    const char* attached[] = {"program", "-abj8"};
+    auto args = fossil::lib::parse<cpp_short_schema>(2, (char **)attached);
+    ASSUME_ITS_TRUE(static_cast<bool>(args));
+    ASSUME_ITS_TRUE(args.get<"a">());
+    ASSUME_ITS_TRUE(args.get<"b">());
+    ASSUME_ITS_EQUAL_I32(8, args.get<"j">());
+
+    // ... or the next argument
+    const char* separate[] = {"program", "-bj", "5"};
+    args = fossil::lib::parse<cpp_short_schema>(3, (char **)separate);
+    ASSUME_ITS_TRUE(static_cast<bool>(args));
+    ASSUME_ITS_FALSE(args.has<"a">());
+    ASSUME_ITS_EQUAL_I32(5, args.get<"j">());
+
+    const char* unknown_flag[] = {"program", "-abx"};
+    args = fossil::lib::parse<cpp_short_schema>(2, (char **)unknown_flag);
+    ASSUME_ITS_TRUE(args.error() == fossil::lib::parse_error::unknown_option);
+    ASSUME_ITS_EQUAL_I32(1, args.error_index());
+
+    const char* missing[] = {"program", "-aj"};
+    args = fossil::lib::parse<cpp_short_schema>(2, (char **)missing);
+    ASSUME_ITS_TRUE(args.error() == fossil::lib::parse_error::missing_value);
+}
+
+FOSSIL_TEST_CASE(cpp_test_arg_typed_values) {
+    const char* argv[] = {"program", "-offset", "-9000000000", "-ratio", "1.25", "-buffer", "8MiB", "-timeout", "2s500ms"};
+    auto args = fossil::lib::parse<cpp_typed_schema>(9, (char **)argv);
+
+    ASSUME_ITS_TRUE(static_cast<bool>(args));
+    ASSUME_ITS_TRUE(args.get<"offset">() == -9000000000LL);
+    ASSUME_ITS_TRUE(args.get<"ratio">() == 1.25);
+    ASSUME_ITS_TRUE(args.get<"buffer">() == 8ULL << 20);
+    ASSUME_ITS_TRUE(args.get<"timeout">() == 2500000000LL);
+
+    const char* overflow[] = {"program", "-buffer", "99999999999999999999"};
+    args = fossil::lib::parse<cpp_typed_schema>(3, (char **)overflow);
+    ASSUME_ITS_TRUE(args.error() == fossil::lib::parse_error::bad_value);
+}
+
+FOSSIL_TEST_CASE(cpp_test_arg_parse_response_file) {
+    FILE* file = fopen("fossil_args_response_cpp.txt", "w");
+    ASSUME_NOT_CNULL(file);
+    fputs("-name 'Jane Doe' -jobs 7 @fossil_args_missing.txt", file);
+    fclose(file);
+
+    const char* argv[] = {"program", "@fossil_args_response_cpp.txt"};
+    fossil_command_line_t cmd = {2, (char **)argv};
+    fossil_option_t options[] = {
+        {"jobs", COPTION_TYPE_INT, {.int_val = 1}, cnull, 0, 0, cnull},
+        {"name", COPTION_TYPE_STRING, {.str_val = cnull}, cnull, 0, 0, cnull}
+    };
+
+    fossil_arg_parse(&cmd, options, 2);
+    remove("fossil_args_response_cpp.txt");
+
+    ASSUME_ITS_EQUAL_I32(7, options[0].value.int_val);
+    ASSUME_ITS_EQUAL_CSTR("Jane Doe", options[1].value.str_val);
+    fossil_arg_release_response_files();
+}
+
+FOSSIL_TEST_CASE(cpp_test_arg_resolve_layers) {
+    FILE* file = fopen("fossil_args_config_cpp.toml", "w");
+    ASSUME_NOT_CNULL(file);
+    fputs("timeout = '1m'\nbuffer = 64K # bytes\n", file);
+    fclose(file);
+
+    fossil_option_t options[] = {
+        {"timeout", COPTION_TYPE_DURATION, {.duration_val = 0}, cnull, 0, 0, cnull},
+        {"buffer", COPTION_TYPE_SIZE, {.size_val = 0}, cnull, 0, 0, cnull}
+    };
+    fossil_arg_layers_t layers = {"fossil_args_config_cpp.toml", cnull, cnull};
+
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_resolve(cnull, options, 2, &layers));
+    ASSUME_ITS_TRUE(options[0].value.duration_val == 60LL * 1000000000LL);
+    ASSUME_ITS_TRUE(options[1].value.size_val == 65536);
+
+    // A missing config file is an empty layer
+    remove("fossil_args_config_cpp.toml");
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_resolve(cnull, options, 2, &layers));
+    fossil_arg_release_response_files();
+}
+
+FOSSIL_TEST_CASE(cpp_test_arg_build_options) {
+    const char* feature_names[] = {"fast", "safe"};
+    const int32_t feature_values[] = {10, 20};
+    fossil_option_spec_t specs[2] = {};
+    specs[0].name = "profile";
+    specs[0].type = COPTION_TYPE_COMBO;
+    specs[0].value.combo_val = 20;
+    specs[0].choice_names = feature_names;
+    specs[0].choice_values = feature_values;
+    specs[0].num_choices = 2;
+    specs[1].name = "verbose";
+    specs[1].type = COPTION_TYPE_BOOL;
+
+    fossil_option_t* options = nullptr;
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_build_options(specs, 2, nullptr, &options));
+    ASSUME_ITS_EQUAL_I32(2, options[0].num_choices);
+    ASSUME_ITS_EQUAL_I32(20, options[0].value.combo_val);
+    ASSUME_ITS_EQUAL_CSTR("verbose", options[1].name);
+    fossil_arg_free_options(options);
+
+    specs[1].name = nullptr;
+    ASSUME_ITS_EQUAL_I32(0, (int32_t)fossil_arg_options_size(specs, 2));
+}
+
+static int32_t cpp_arg_count_calls(fossil_command_line_t* cmd, fossil_option_t* options, int32_t num_options, void* user_data) {
+    (void)cmd;
+    (void)options;
+    (void)num_options;
+    return ++*static_cast<int32_t*>(user_data);
+}
+
+FOSSIL_TEST_CASE(cpp_test_arg_commands_dispatch) {
+    int32_t root_calls = 0;
+    int32_t show_calls = 0;
+    fossil_arg_commands_t* commands = fossil_arg_commands_create();
+    ASSUME_NOT_CNULL(commands);
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_commands_register(commands, "", cpp_arg_count_calls, nullptr, 0, &root_calls));
+    ASSUME_ITS_EQUAL_I32(FOSSIL_ARG_OK, fossil_arg_commands_register(commands, "config  show", cpp_arg_count_calls, nullptr, 0, &show_calls));
+
+    const char* show_argv[] = {"tool", "config", "show", "-all"};
+    fossil_command_line_t show_cmd = {4, (char **)show_argv};
+    ASSUME_ITS_EQUAL_I32(1, fossil_arg_commands_dispatch(commands, &show_cmd));
+
+    // Unknown words fall back to the deepest registered node, here the root
+    const char* other_argv[] = {"tool", "config", "edit"};
+    fossil_command_line_t other_cmd = {3, (char **)other_argv};
+    ASSUME_ITS_EQUAL_I32(1, fossil_arg_commands_dispatch(commands, &other_cmd));
+    ASSUME_ITS_EQUAL_I32(1, show_calls);
+
+    fossil_arg_commands_free(commands);
+}
+
+FOSSIL_TEST_CASE(cpp_test_arg_parse_syntax) {
+    const char* argv[] = {"program", "-n", "-12", "--verbose=false", "-qn7", "--", "--verbose"};
+    fossil_command_line_t cmd = {7, (char **)argv};
+    fossil_option_t options[3] = {};
+    options[0].name = "n";
+    options[0].type = COPTION_TYPE_INT;
+    options[1].name = "verbose";
+    options[1].type = COPTION_TYPE_BOOL;
+    options[1].value.bool_val = 1;
+    options[2].name = "q";
+    options[2].type = COPTION_TYPE_BOOL;
+
+    fossil_arg_parse(&cmd, options, 3);
+
+    // The bundle sets -q and hands the rest of the word to -n
+    ASSUME_ITS_EQUAL_I32(7, options[0].value.int_val);
+    ASSUME_ITS_EQUAL_I32(0, options[1].value.bool_val);
+    ASSUME_ITS_EQUAL_I32(1, options[2].value.bool_val);
+}
+
+FOSSIL_TEST_CASE(cpp_test_arg_parse_into_threads) {
+    fossil_option_spec_t specs[2] = {};
+    specs[0].name = "id";
+    specs[0].type = COPTION_TYPE_INT64;
+    specs[1].name = "trace";
+    specs[1].type = COPTION_TYPE_BOOL;
+    fossil_arg_schema_t* schema = fossil_arg_schema_create(specs, 2);
+    ASSUME_NOT_CNULL(schema);
+
+    // Every thread parses its own requests against the one shared schema
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 8; ++t) {
+        workers.emplace_back([schema, t, &mismatches] {
+            fossil_arg_result_t* result = fossil_arg_result_create(schema);
+            for (int i = 0; i < 2000; ++i) {
+                std::string id = std::to_string(t * 100000 + i);
+                const char* argv[] = {"rpc", "--id", id.c_str(), (i % 2) ? "--trace" : "--no-trace"};
+                fossil_command_line_t cmd = {4, (char **)argv};
+                if (fossil_arg_parse_into(schema, &cmd, result) != FOSSIL_ARG_OK ||
+                    result->values[0].int64_val != t * 100000 + i || result->values[1].bool_val != (i % 2)) {
+                    ++mismatches;
+                }
+            }
+            fossil_arg_result_free(result);
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    ASSUME_ITS_EQUAL_I32(0, mismatches.load());
+    fossil_arg_schema_free(schema);
+}
+
+FOSSIL_TEST_CASE(cpp_test_arg_format_usage) {
+    fossil_option_t options[2] = {};
+    options[0].name = "cache";
+    options[0].type = COPTION_TYPE_FEATURE;
+    options[0].value.feature_val = FEATURE_DISABLE;
+    options[0].description = "Reuse earlier build results";
+    options[1].name = "limit";
+    options[1].type = COPTION_TYPE_SIZE;
+    options[1].value.size_val = 4096;
+
+    std::string text(fossil_arg_format_usage("tool", options, 2, 0, nullptr, 0), '\0');
+    fossil_arg_format_usage("tool", options, 2, 0, text.data(), text.size() + 1);
+
+    ASSUME_ITS_TRUE(text.find("-cache {enable|disable|auto}") != std::string::npos);
+    ASSUME_ITS_TRUE(text.find("Reuse earlier build results (default: disable)") != std::string::npos);
+    ASSUME_ITS_TRUE(text.find("-limit <size>") != std::string::npos);
+    ASSUME_ITS_TRUE(text.find("(default: 4096)") != std::string::npos);
+}
+
+FOSSIL_TEST_CASE(cpp_test_arg_completion) {
+    fossil_option_t options[2] = {};
+    options[0].name = "cache";
+    options[0].type = COPTION_TYPE_FEATURE;
+    options[1].name = "count";
+    options[1].type = COPTION_TYPE_INT;
+    fossil_arg_completion_t* completion = fossil_arg_completion_create(options, 2);
+    ASSUME_NOT_CNULL(completion);
+
+    std::string text(fossil_arg_complete(completion, "tool", "--c", nullptr, 0), '\0');
+    fossil_arg_complete(completion, "tool", "--c", text.data(), text.size() + 1);
+    ASSUME_ITS_TRUE(text == "--cache\n--count\n");
+
+    text.assign(fossil_arg_complete(completion, "--cache", "a", nullptr, 0), '\0');
+    fossil_arg_complete(completion, "--cache", "a", text.data(), text.size() + 1);
+    ASSUME_ITS_TRUE(text == "auto\n");
+
+    text.assign(fossil_arg_completion_script("tool", options, 2, FOSSIL_ARG_SHELL_FISH, nullptr, 0), '\0');
+    fossil_arg_completion_script("tool", options, 2, FOSSIL_ARG_SHELL_FISH, text.data(), text.size() + 1);
+    ASSUME_ITS_TRUE(text.find("complete -c tool -l count -r") != std::string::npos);
+    fossil_arg_completion_free(completion);
+}
+
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Pool
 // * * * * * * * * * * * * * * * * * * * * * * * *
@@ -108,6 +474,20 @@ FOSSIL_TEST_CASE(cpp_test_arg_parse) {
 FOSSIL_TEST_GROUP(cpp_commandline_tests) {
     FOSSIL_TEST_ADD(cpp_args_suite, cpp_test_arg_parse_has);
     FOSSIL_TEST_ADD(cpp_args_suite, cpp_test_arg_parse);
+    FOSSIL_TEST_ADD(cpp_args_suite, cpp_test_arg_parse_many_options);
+    FOSSIL_TEST_ADD(cpp_args_suite, cpp_test_arg_constexpr_schema);
+    FOSSIL_TEST_ADD(cpp_args_suite, cpp_test_arg_constexpr_errors);
+    FOSSIL_TEST_ADD(cpp_args_suite, cpp_test_arg_constexpr_syntax);
+    FOSSIL_TEST_ADD(cpp_args_suite, cpp_test_arg_constexpr_bundles);
+    FOSSIL_TEST_ADD(cpp_args_suite, cpp_test_arg_typed_values);
+    FOSSIL_TEST_ADD(cpp_args_suite, cpp_test_arg_parse_response_file);
+    FOSSIL_TEST_ADD(cpp_args_suite, cpp_test_arg_resolve_layers);
+    FOSSIL_TEST_ADD(cpp_args_suite, cpp_test_arg_build_options);
+    FOSSIL_TEST_ADD(cpp_args_suite, cpp_test_arg_commands_dispatch);
+    FOSSIL_TEST_ADD(cpp_args_suite, cpp_test_arg_parse_syntax);
+    FOSSIL_TEST_ADD(cpp_args_suite, cpp_test_arg_parse_into_threads);
+    FOSSIL_TEST_ADD(cpp_args_suite, cpp_test_arg_format_usage);
+    FOSSIL_TEST_ADD(cpp_args_suite, cpp_test_arg_completion);
 
     FOSSIL_TEST_REGISTER(cpp_args_suite);
 }
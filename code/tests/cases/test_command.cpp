@@ -15,6 +15,14 @@
 
 #include "fossil/lib/framework.h"
 
+#ifndef _WIN32
+#include <signal.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Utilities
 // * * * * * * * * * * * * * * * * * * * * * * * *
@@ -83,6 +91,211 @@ FOSSIL_TEST_CASE(cpp_test_command_output) {
 #endif
 }
 
+FOSSIL_TEST_CASE(cpp_test_command_output_timeout) {
+    char output[128];
+    fossil_command_limits_t limits = {};
+    limits.timeout_ms = 200;
+    limits.kill_grace_ms = 100;
+
+    // A command that finishes in time reports its own exit status
+    ASSUME_ITS_EQUAL_I32(0, fossil_command_output_ex((char *)"echo fast", output, sizeof(output), &limits));
+    ASSUME_ITS_EQUAL_CSTR("fast\n", output);
+    ASSUME_ITS_EQUAL_I32(3, fossil_command_ex((char *)"exit 3", &limits));
+
+    // A hung command is stopped once the deadline passes
+    ASSUME_ITS_EQUAL_I32(FOSSIL_COMMAND_TIMEOUT, fossil_command_output_ex((char *)"echo slow; sleep 10", output, sizeof(output), &limits));
+    ASSUME_ITS_EQUAL_CSTR("slow\n", output);
+}
+
+FOSSIL_TEST_CASE(cpp_test_command_wait_failure) {
+#ifdef SIGCHLD
+    // With SIGCHLD ignored the kernel reaps the child, so waiting fails instead of reporting success
+    void (*previous)(int) = signal(SIGCHLD, SIG_IGN);
+    int32_t result = fossil_command_ex((char *)"exit 0", cnull);
+    signal(SIGCHLD, previous);
+    ASSUME_ITS_EQUAL_I32(FOSSIL_COMMAND_ERROR, result);
+#endif
+}
+
+FOSSIL_TEST_CASE(cpp_test_command_cancel) {
+    volatile int32_t cancel = 1;
+    fossil_command_limits_t limits = {};
+    limits.cancel = &cancel;
+
+    ASSUME_ITS_EQUAL_I32(FOSSIL_COMMAND_CANCELLED, fossil_command_ex((char *)"sleep 10", &limits));
+}
+
+FOSSIL_TEST_CASE(cpp_test_command_session) {
+    char output[128];
+    fossil_command_session_t *session = fossil_command_session_open(cnull, cnull, cnull);
+    ASSUME_NOT_CNULL(session);
+
+    // State such as variables survives between commands
+    ASSUME_ITS_EQUAL_I32(0, fossil_command_session_run(session, "GREETING=Hello", output, sizeof(output)));
+    ASSUME_ITS_EQUAL_CSTR("", output);
+    ASSUME_ITS_EQUAL_I32(0, fossil_command_session_run(session, "echo $GREETING World", output, sizeof(output)));
+    ASSUME_ITS_EQUAL_CSTR("Hello World\n", output);
+
+    // Output without a trailing newline and the exit status are framed correctly
+    ASSUME_ITS_EQUAL_I32(4, fossil_command_session_run(session, "printf partial; (exit 4)", output, sizeof(output)));
+    ASSUME_ITS_EQUAL_CSTR("partial", output);
+
+    ASSUME_ITS_EQUAL_I32(0, fossil_command_session_close(session));
+}
+
+FOSSIL_TEST_CASE(cpp_test_command_session_timeout) {
+#ifndef _WIN32
+    char output[128];
+    fossil_command_session_t *session = fossil_command_session_open(cnull, cnull, cnull);
+    ASSUME_NOT_CNULL(session);
+    fossil_command_session_set_timeout(session, 200);
+    ASSUME_ITS_EQUAL_I32(0, fossil_command_session_run(session, "echo quick", output, sizeof(output)));
+
+    // A hung command ends the session instead of blocking the caller
+    time_t start = time(cnull);
+    ASSUME_ITS_EQUAL_I32(FOSSIL_COMMAND_TIMEOUT, fossil_command_session_run(session, "echo before; sleep 30", output, sizeof(output)));
+    ASSUME_ITS_EQUAL_CSTR("before\n", output);
+    ASSUME_ITS_EQUAL_I32(FOSSIL_COMMAND_ERROR, fossil_command_session_run(session, "echo after", output, sizeof(output)));
+    fossil_command_session_close(session);
+
+    // An interpreter that keeps running after EOF is stopped by close
+    FILE *script = fopen("fossil_session_stuck_cpp.sh", "w");
+    ASSUME_NOT_CNULL(script);
+    fputs("#!/bin/sh\nwhile IFS= read -r line; do eval \"$line\"; done\nsleep 30\n", script);
+    fclose(script);
+    chmod("fossil_session_stuck_cpp.sh", 0755);
+    session = fossil_command_session_open("./fossil_session_stuck_cpp.sh", cnull, cnull);
+    ASSUME_NOT_CNULL(session);
+    fossil_command_session_set_timeout(session, 200);
+    ASSUME_ITS_EQUAL_I32(0, fossil_command_session_run(session, "echo ready", output, sizeof(output)));
+    ASSUME_ITS_EQUAL_CSTR("ready\n", output);
+    ASSUME_ITS_EQUAL_I32(FOSSIL_COMMAND_TIMEOUT, fossil_command_session_close(session));
+    remove("fossil_session_stuck_cpp.sh");
+    ASSUME_ITS_TRUE(time(cnull) - start < 10);
+#endif
+}
+
+FOSSIL_TEST_CASE(cpp_test_command_trace) {
+    char output[128];
+    fossil_command_trace_entry_t entries[8];
+
+    fossil_command_trace_reset();
+    fossil_command_trace_enable(1);
+    fossil_command_output((char *)"echo traced", output, sizeof(output));
+    fossil_command_output((char *)"echo traced", output, sizeof(output));
+    fossil_command_trace_enable(0);
+    fossil_command_output((char *)"echo untraced", output, sizeof(output));
+
+    // Both traced calls land in the same entry, keyed by operation and tool
+    ASSUME_ITS_EQUAL_I32(1, (int32_t)fossil_command_trace_snapshot(entries, 8));
+    ASSUME_ITS_EQUAL_CSTR("output", entries[0].operation);
+    ASSUME_ITS_EQUAL_CSTR("echo", entries[0].name);
+    ASSUME_ITS_EQUAL_I32(2, (int32_t)entries[0].calls);
+    ASSUME_ITS_EQUAL_I32(0, (int32_t)entries[0].failures);
+    ASSUME_ITS_EQUAL_I32(7, (int32_t)entries[0].metrics[FOSSIL_COMMAND_TRACE_BYTES].max);
+    ASSUME_ITS_TRUE(entries[0].metrics[FOSSIL_COMMAND_TRACE_RUN].p50 >= entries[0].metrics[FOSSIL_COMMAND_TRACE_RUN].min);
+
+    fossil_command_trace_reset();
+    ASSUME_ITS_EQUAL_I32(0, (int32_t)fossil_command_trace_snapshot(entries, 8));
+}
+
+FOSSIL_TEST_CASE(cpp_test_command_trace_overflow) {
+    char name[32];
+    fossil_command_trace_entry_t entries[64];
+    size_t count;
+
+    fossil_command_trace_reset();
+    fossil_command_trace_enable(1);
+    fossil_command_resolve("sh", cnull, 0);
+    for (int32_t i = 0; i < 40; ++i) {
+        snprintf(name, sizeof(name), "fossil-missing-cpp-%d", (int)i);
+        fossil_command_resolve(name, cnull, 0);
+    }
+    fossil_command_trace_enable(0);
+
+    // Resolution has its own operation, and samples past the table are counted
+    count = fossil_command_trace_snapshot(entries, 64);
+    ASSUME_ITS_TRUE(count > 1 && count <= 64);
+    ASSUME_ITS_EQUAL_CSTR("dropped", entries[count - 1].operation);
+    ASSUME_ITS_EQUAL_I32(41 - (int32_t)(count - 1), (int32_t)entries[count - 1].calls);
+    for (size_t i = 0; i + 1 < count; ++i) {
+        ASSUME_ITS_EQUAL_CSTR("resolve", entries[i].operation);
+    }
+
+    fossil_command_trace_reset();
+    ASSUME_ITS_EQUAL_I32(0, (int32_t)fossil_command_trace_snapshot(entries, 64));
+}
+
+FOSSIL_TEST_CASE(cpp_test_command_pipeline) {
+    char output[128];
+    int32_t statuses[3];
+    const char *const produce[] = {"printf", "b\\na\\nc\\n", cnull};
+    const char *const order[] = {"sort", cnull};
+    const char *const count[] = {"wc", "-l", cnull};
+    const char *const *stages[] = {produce, order, count};
+
+    // Data flows through every stage without a shell in between
+    ASSUME_ITS_EQUAL_I32(0, fossil_command_pipeline(stages, 2, output, sizeof(output), statuses, 0));
+    ASSUME_ITS_EQUAL_CSTR("a\nb\nc\n", output);
+    ASSUME_ITS_EQUAL_I32(0, fossil_command_pipeline(stages, 3, output, sizeof(output), statuses, 1 << 20));
+    ASSUME_ITS_TRUE(strstr(output, "3") != cnull);
+
+    // Each stage reports its own status, a missing tool gives 127
+    const char *const missing[] = {"invalid_command", cnull};
+    const char *const *broken[] = {produce, missing};
+    ASSUME_ITS_EQUAL_I32(127, fossil_command_pipeline(broken, 2, output, sizeof(output), statuses, 0));
+    ASSUME_ITS_EQUAL_I32(127, statuses[1]);
+}
+
+FOSSIL_TEST_CASE(cpp_test_command_pipeline_no_fds) {
+#ifndef _WIN32
+    char output[128];
+    int32_t statuses[3] = {0, 0, 0};
+    int held[64];
+    int32_t num_held = 0;
+    struct rlimit saved;
+    struct rlimit low;
+    const char *const produce[] = {"printf", "x", cnull};
+    const char *const copy[] = {"cat", cnull};
+    const char *const missing[] = {"fossil-command-does-not-exist", cnull};
+    const char *const *stages[] = {produce, copy, copy};
+    const char *const *broken[] = {missing, copy, copy};
+
+    // Use up every descriptor so the first pipe of the pipeline fails
+    ASSUME_ITS_EQUAL_I32(0, getrlimit(RLIMIT_NOFILE, &saved));
+    low = saved;
+    low.rlim_cur = 64;
+    ASSUME_ITS_EQUAL_I32(0, setrlimit(RLIMIT_NOFILE, &low));
+    while (num_held < 64 && (held[num_held] = dup(STDERR_FILENO)) >= 0) {
+        ++num_held;
+    }
+
+    int32_t result = fossil_command_pipeline(stages, 3, output, sizeof(output), statuses, 0);
+
+    // Room for one pipe only: the first stage fails to spawn, the second pipe fails
+    int32_t broken_statuses[3] = {0, 0, 0};
+    close(held[--num_held]);
+    close(held[--num_held]);
+    int32_t broken_result = fossil_command_pipeline(broken, 3, output, sizeof(output), broken_statuses, 0);
+
+    while (num_held > 0) {
+        close(held[--num_held]);
+    }
+    setrlimit(RLIMIT_NOFILE, &saved);
+
+    // Stages that were never reached report an error instead of a stale pid
+    ASSUME_ITS_EQUAL_I32(FOSSIL_COMMAND_ERROR, result);
+    for (int32_t i = 0; i < 3; ++i) {
+        ASSUME_ITS_EQUAL_I32(FOSSIL_COMMAND_ERROR, statuses[i]);
+    }
+    // The stage that could not be spawned still reports 127 like the shell
+    ASSUME_ITS_EQUAL_I32(FOSSIL_COMMAND_ERROR, broken_result);
+    ASSUME_ITS_EQUAL_I32(127, broken_statuses[0]);
+    ASSUME_ITS_EQUAL_I32(FOSSIL_COMMAND_ERROR, broken_statuses[1]);
+    ASSUME_ITS_EQUAL_I32(FOSSIL_COMMAND_ERROR, broken_statuses[2]);
+#endif
+}
+
 FOSSIL_TEST_CASE(cpp_test_command_exists) {
     int32_t result;
 
@@ -105,6 +318,26 @@ FOSSIL_TEST_CASE(cpp_test_command_exists) {
     ASSUME_ITS_EQUAL_I32(0, result);
 }
 
+FOSSIL_TEST_CASE(cpp_test_command_resolve) {
+    char path[256];
+    char again[256];
+
+    // Names without a separator are searched for in PATH
+    ASSUME_ITS_EQUAL_I32(1, fossil_command_resolve("sh", path, sizeof(path)));
+    ASSUME_ITS_TRUE(strstr(path, "/sh") != cnull);
+
+    // The second lookup is served from the cache and gives the same answer
+    ASSUME_ITS_EQUAL_I32(1, fossil_command_resolve("sh", again, sizeof(again)));
+    ASSUME_ITS_EQUAL_CSTR(path, again);
+
+    // Explicit paths are checked as given
+    ASSUME_ITS_EQUAL_I32(1, fossil_command_resolve(path, cnull, 0));
+    ASSUME_ITS_EQUAL_I32(0, fossil_command_resolve("invalid_command", path, sizeof(path)));
+
+    fossil_command_cache_clear();
+    ASSUME_ITS_EQUAL_I32(0, fossil_command_resolve("invalid_command", cnull, 0));
+}
+
 FOSSIL_TEST_CASE(cpp_test_command_strcat_safe) {
     char buffer[16];
 
@@ -146,7 +379,17 @@ FOSSIL_TEST_GROUP(cpp_command_tests) {
     FOSSIL_TEST_ADD(cpp_command_suite, cpp_test_command);
     FOSSIL_TEST_ADD(cpp_command_suite, cpp_test_command_success);
     FOSSIL_TEST_ADD(cpp_command_suite, cpp_test_command_output);
+    FOSSIL_TEST_ADD(cpp_command_suite, cpp_test_command_output_timeout);
+    FOSSIL_TEST_ADD(cpp_command_suite, cpp_test_command_cancel);
+    FOSSIL_TEST_ADD(cpp_command_suite, cpp_test_command_wait_failure);
+    FOSSIL_TEST_ADD(cpp_command_suite, cpp_test_command_session);
+    FOSSIL_TEST_ADD(cpp_command_suite, cpp_test_command_session_timeout);
+    FOSSIL_TEST_ADD(cpp_command_suite, cpp_test_command_trace);
+    FOSSIL_TEST_ADD(cpp_command_suite, cpp_test_command_trace_overflow);
+    FOSSIL_TEST_ADD(cpp_command_suite, cpp_test_command_pipeline);
+    FOSSIL_TEST_ADD(cpp_command_suite, cpp_test_command_pipeline_no_fds);
     FOSSIL_TEST_ADD(cpp_command_suite, cpp_test_command_exists);
+    FOSSIL_TEST_ADD(cpp_command_suite, cpp_test_command_resolve);
     FOSSIL_TEST_ADD(cpp_command_suite, cpp_test_command_strcat_safe);
     FOSSIL_TEST_ADD(cpp_command_suite, cpp_test_command_erase_exists);
 #else
@@ -154,7 +397,17 @@ FOSSIL_TEST_GROUP(cpp_command_tests) {
     FOSSIL_TEST_SKIP(cpp_test_command, "Test case not supported on Windows");
     FOSSIL_TEST_SKIP(cpp_test_command_success, "Test case not supported on Windows");
     FOSSIL_TEST_SKIP(cpp_test_command_output, "Test case not supported on Windows");
+    FOSSIL_TEST_SKIP(cpp_test_command_output_timeout, "Test case not supported on Windows");
+    FOSSIL_TEST_SKIP(cpp_test_command_cancel, "Test case not supported on Windows");
+    FOSSIL_TEST_SKIP(cpp_test_command_wait_failure, "Test case not supported on Windows");
+    FOSSIL_TEST_SKIP(cpp_test_command_session, "Test case not supported on Windows");
+    FOSSIL_TEST_SKIP(cpp_test_command_session_timeout, "Test case not supported on Windows");
+    FOSSIL_TEST_SKIP(cpp_test_command_trace, "Test case not supported on Windows");
+    FOSSIL_TEST_SKIP(cpp_test_command_trace_overflow, "Test case not supported on Windows");
+    FOSSIL_TEST_SKIP(cpp_test_command_pipeline, "Test case not supported on Windows");
+    FOSSIL_TEST_SKIP(cpp_test_command_pipeline_no_fds, "Test case not supported on Windows");
     FOSSIL_TEST_SKIP(cpp_test_command_exists, "Test case not supported on Windows");
+    FOSSIL_TEST_SKIP(cpp_test_command_resolve, "Test case not supported on Windows");
     FOSSIL_TEST_SKIP(cpp_test_command_strcat_safe, "Test case not supported on Windows");
     FOSSIL_TEST_SKIP(cpp_test_command_erase_exists, "Test case not supported on Windows");
 #endif
@@ -14,6 +14,14 @@
 #include <fossil/test/framework.h>
 
 #include "fossil/lib/framework.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <sys/stat.h>
+#endif
 
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Utilities
@@ -25,6 +33,62 @@
 // Define the test suite and add test cases
 FOSSIL_TEST_SUITE(c_hostsys_suite);
 
+// Spins for roughly the given number of milliseconds of processor time
+static void wait_ms(int ms) {
+    clock_t end = clock() + (clock_t)ms * CLOCKS_PER_SEC / 1000;
+    while (clock() < end) {
+    }
+}
+
+#ifdef __linux__
+// Paths created for a fake sysfs tree, removed in reverse order
+static char fake_paths[256][128];
+static int fake_count = 0;
+
+static void fake_write(const char *path, const char *text) {
+    char partial[128];
+    for (const char *slash = strchr(path, '/'); slash; slash = strchr(slash + 1, '/')) {
+        snprintf(partial, sizeof(partial), "%.*s", (int)(slash - path), path);
+        if (mkdir(partial, 0755) == 0) {
+            snprintf(fake_paths[fake_count++], sizeof(fake_paths[0]), "%s", partial);
+        }
+    }
+    if (text) {
+        FILE *file = fopen(path, "w");
+        fputs(text, file);
+        fclose(file);
+    } else {
+        mkdir(path, 0755);
+    }
+    snprintf(fake_paths[fake_count++], sizeof(fake_paths[0]), "%s", path);
+}
+
+static void fake_remove(void) {
+    while (fake_count > 0) {
+        remove(fake_paths[--fake_count]);
+    }
+}
+#endif
+
+static int32_t placed_cpu(const fossil_hostsys_topology_t *topo, fossil_hostsys_policy_t policy,
+                          int32_t worker, const fossil_hostsys_cpuset_t *allowed) {
+    fossil_hostsys_cpuset_t set;
+    if (!fossil_hostsys_place(topo, policy, worker, allowed, &set) || fossil_hostsys_cpuset_count(&set) != 1) {
+        return -1;
+    }
+    for (int32_t cpu = 0; cpu < _FOSSIL_HOSTSYS_MAX_CPUS; ++cpu) {
+        if (fossil_hostsys_cpuset_has(&set, cpu)) {
+            return cpu;
+        }
+    }
+    return -1;
+}
+
+static void* report_cpu(void *arg) {
+    *(int32_t*)arg = fossil_hostsys_current_cpu();
+    return arg;
+}
+
 // Setup function for the test suite
 FOSSIL_SETUP(c_hostsys_suite) {
     // Setup code here
@@ -56,6 +120,363 @@ FOSSIL_TEST_CASE(c_test_hostsys_endian) {
     ASSUME_ITS_EQUAL_CSTR(fossil_hostsys_endian(&info), info.is_big_endian ? "Big Endian" : "Little Endian");
 }
 
+FOSSIL_TEST_CASE(c_test_hostsys_topology_load) {
+#ifdef __linux__
+    // Two packages of two cores with two threads each; cpu 7 is offline
+    char path[128];
+    char text[32];
+    fake_write("fossil_sysfs/online", "0-6\n");
+    for (int cpu = 0; cpu < 7; ++cpu) {
+        int core = cpu % 4;
+        int package = core / 2;
+        snprintf(path, sizeof(path), "fossil_sysfs/cpu%d/topology/physical_package_id", cpu);
+        snprintf(text, sizeof(text), "%d\n", package);
+        fake_write(path, text);
+        snprintf(path, sizeof(path), "fossil_sysfs/cpu%d/topology/thread_siblings_list", cpu);
+        snprintf(text, sizeof(text), "%d,%d\n", core, core + 4);
+        fake_write(path, text);
+        snprintf(path, sizeof(path), "fossil_sysfs/cpu%d/node%d", cpu, package);
+        fake_write(path, NULL);
+        snprintf(path, sizeof(path), "fossil_sysfs/cpu%d/cache/index0/level", cpu);
+        fake_write(path, "1\n");
+        snprintf(path, sizeof(path), "fossil_sysfs/cpu%d/cache/index0/type", cpu);
+        fake_write(path, "Data\n");
+        snprintf(path, sizeof(path), "fossil_sysfs/cpu%d/cache/index0/size", cpu);
+        fake_write(path, "48K\n");
+        snprintf(path, sizeof(path), "fossil_sysfs/cpu%d/cache/index0/shared_cpu_list", cpu);
+        snprintf(text, sizeof(text), "%d,%d\n", core, core + 4);
+        fake_write(path, text);
+        snprintf(path, sizeof(path), "fossil_sysfs/cpu%d/cache/index1/level", cpu);
+        fake_write(path, "3\n");
+        snprintf(path, sizeof(path), "fossil_sysfs/cpu%d/cache/index1/type", cpu);
+        fake_write(path, "Unified\n");
+        snprintf(path, sizeof(path), "fossil_sysfs/cpu%d/cache/index1/size", cpu);
+        fake_write(path, "32M\n");
+        snprintf(path, sizeof(path), "fossil_sysfs/cpu%d/cache/index1/shared_cpu_list", cpu);
+        fake_write(path, package == 0 ? "0-1,4-5\n" : "2-3,6-7\n");
+    }
+
+    fossil_hostsys_topology_t topology;
+    ASSUME_ITS_TRUE(fossil_hostsys_topology_load("fossil_sysfs", &topology));
+    fake_remove();
+
+    ASSUME_ITS_EQUAL_I32(7, topology.num_cpus);
+    ASSUME_ITS_EQUAL_I32(4, topology.num_cores);
+    ASSUME_ITS_EQUAL_I32(2, topology.num_packages);
+    ASSUME_ITS_EQUAL_I32(2, topology.num_numa_nodes);
+    ASSUME_ITS_EQUAL_I32(2, topology.threads_per_core);
+    ASSUME_ITS_EQUAL_I32(2, topology.num_l3_domains);
+    ASSUME_ITS_EQUAL_I32(2, topology.num_caches);
+    ASSUME_ITS_TRUE(topology.caches[1].size == 32 * 1024 * 1024);
+    ASSUME_ITS_EQUAL_I32(4, topology.caches[1].shared_cpus);
+
+    const fossil_hostsys_cpu_t *first = fossil_hostsys_topology_cpu(&topology, 0);
+    const fossil_hostsys_cpu_t *sibling = fossil_hostsys_topology_cpu(&topology, 4);
+    const fossil_hostsys_cpu_t *remote = fossil_hostsys_topology_cpu(&topology, 6);
+    ASSUME_NOT_CNULL(first);
+    ASSUME_NOT_CNULL(sibling);
+    ASSUME_NOT_CNULL(remote);
+    ASSUME_ITS_EQUAL_I32(first->core, sibling->core);
+    ASSUME_ITS_EQUAL_I32(1, sibling->smt_index);
+    ASSUME_ITS_EQUAL_I32(first->l3_domain, sibling->l3_domain);
+    ASSUME_NOT_EQUAL_I32(first->l3_domain, remote->l3_domain);
+    ASSUME_ITS_EQUAL_I32(1, remote->numa_node);
+    ASSUME_ITS_TRUE(fossil_hostsys_topology_cpu(&topology, 7) == NULL);
+    fossil_hostsys_topology_free(&topology);
+
+    ASSUME_ITS_FALSE(fossil_hostsys_topology_load("fossil_sysfs_missing", &topology));
+    fossil_hostsys_topology_free(&topology);
+#endif
+}
+
+FOSSIL_TEST_CASE(c_test_hostsys_features) {
+    uint64_t features = fossil_hostsys_features();
+    ASSUME_ITS_TRUE(features == fossil_hostsys_features());
+    ASSUME_ITS_TRUE(fossil_hostsys_has_features(0));
+    ASSUME_ITS_TRUE(fossil_hostsys_has_features(features));
+
+    // Wider vector families are only reported on top of the narrower ones
+    if (features & FOSSIL_HOSTSYS_FEATURE_AVX2) {
+        ASSUME_ITS_TRUE(features & FOSSIL_HOSTSYS_FEATURE_AVX);
+    }
+    if (features & FOSSIL_HOSTSYS_FEATURE_AVX512BW) {
+        ASSUME_ITS_TRUE(features & FOSSIL_HOSTSYS_FEATURE_AVX512F);
+    }
+    if (features & FOSSIL_HOSTSYS_FEATURE_SVE2) {
+        ASSUME_ITS_TRUE(features & FOSSIL_HOSTSYS_FEATURE_SVE);
+    }
+#if defined(__x86_64__) || defined(_M_X64)
+    ASSUME_ITS_TRUE(features & FOSSIL_HOSTSYS_FEATURE_SSE2);
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    ASSUME_ITS_TRUE(features & FOSSIL_HOSTSYS_FEATURE_NEON);
+#endif
+
+    fossil_hostsystem_t info;
+    fossil_hostsys_get(&info);
+    ASSUME_ITS_TRUE(info.cpu_features == features);
+}
+
+FOSSIL_TEST_CASE(c_test_hostsys_limits_load) {
+#ifdef __linux__
+    fossil_hostsys_limits_t limits;
+
+    // cgroup v2: one and a half CPUs and 512 MB
+    fake_write("fossil_cgroup/cpu.max", "150000 100000\n");
+    fake_write("fossil_cgroup/memory.max", "536870912\n");
+    fake_write("fossil_cgroup/memory.high", "max\n");
+    ASSUME_ITS_TRUE(fossil_hostsys_limits_load("fossil_cgroup", &limits));
+    fake_remove();
+    ASSUME_ITS_TRUE(limits.cpu_quota > 1.49 && limits.cpu_quota < 1.51);
+    ASSUME_ITS_TRUE(limits.memory_max == 536870912);
+    ASSUME_ITS_TRUE(limits.memory_high == 0);
+    ASSUME_ITS_TRUE(limits.effective_cpus == (limits.affinity_cpus < 2 ? limits.affinity_cpus : 2));
+    ASSUME_ITS_TRUE(limits.effective_memory <= 536870912);
+
+    // cgroup v1 without limits
+    fake_write("fossil_cgroup/cpu.cfs_quota_us", "-1\n");
+    fake_write("fossil_cgroup/cpu.cfs_period_us", "100000\n");
+    fake_write("fossil_cgroup/memory.limit_in_bytes", "9223372036854771712\n");
+    ASSUME_ITS_TRUE(fossil_hostsys_limits_load("fossil_cgroup", &limits));
+    fake_remove();
+    ASSUME_ITS_TRUE(limits.cpu_quota == 0);
+    ASSUME_ITS_TRUE(limits.memory_max == 0);
+    ASSUME_ITS_EQUAL_I32(limits.affinity_cpus, limits.effective_cpus);
+
+    ASSUME_ITS_FALSE(fossil_hostsys_limits_load("fossil_cgroup_missing", &limits));
+#endif
+}
+
+FOSSIL_TEST_CASE(c_test_hostsys_cached) {
+    fossil_hostsystem_t first;
+    fossil_hostsystem_t second;
+
+    // Within the staleness bound every call returns the same snapshot
+    fossil_hostsys_set_staleness(60LL * 1000000000LL);
+    ASSUME_ITS_TRUE(fossil_hostsys_get(&first));
+    for (int i = 0; i < 100000; ++i) {
+        ASSUME_ITS_TRUE(fossil_hostsys_get(&second));
+    }
+    ASSUME_ITS_TRUE(memcmp(&first, &second, sizeof(first)) == 0);
+    ASSUME_ITS_TRUE(strchr(first.cpu_model, '\n') == NULL);
+
+    // With no bound the dynamic fields are read again
+    fossil_hostsys_set_staleness(0);
+    ASSUME_ITS_TRUE(fossil_hostsys_get(&second));
+    ASSUME_ITS_EQUAL_CSTR(first.os_version, second.os_version);
+    ASSUME_ITS_TRUE(second.free_memory > 0);
+    ASSUME_ITS_TRUE(second.free_memory <= second.total_memory);
+    fossil_hostsys_set_staleness(_FOSSIL_HOSTSYS_STALENESS);
+}
+
+FOSSIL_TEST_CASE(c_test_hostsys_sampler) {
+    ASSUME_ITS_TRUE(fossil_hostsys_sampler_start(0) == NULL);
+
+    fossil_hostsys_sampler_t *sampler = fossil_hostsys_sampler_start(5000000);
+    ASSUME_NOT_CNULL(sampler);
+    fossil_hostsys_sample_t sample;
+    float cpu_busy[64];
+
+    // Wait for two samples, giving up after about two seconds
+    for (int i = 0; i < 2000; ++i) {
+        if (fossil_hostsys_sampler_read(sampler, &sample, cpu_busy, 64) && sample.sequence >= 2) {
+            break;
+        }
+        wait_ms(1);
+    }
+    ASSUME_ITS_TRUE(fossil_hostsys_sampler_read(sampler, &sample, cpu_busy, 64));
+    ASSUME_ITS_TRUE(sample.sequence >= 2);
+    ASSUME_ITS_TRUE(sample.num_cpus >= 1);
+    ASSUME_ITS_TRUE(sample.cpu_busy >= 0.0 && sample.cpu_busy <= 1.0);
+    ASSUME_ITS_TRUE(sample.memory_total > 0);
+    ASSUME_ITS_TRUE(sample.memory_available <= sample.memory_total);
+    ASSUME_ITS_TRUE(sample.disk_read_rate >= 0.0 && sample.net_receive_rate >= 0.0);
+    for (int32_t i = 0; i < sample.num_cpus && i < 64; ++i) {
+        ASSUME_ITS_TRUE(cpu_busy[i] >= 0.0f && cpu_busy[i] <= 1.0f);
+    }
+    fossil_hostsys_sampler_stop(sampler);
+}
+
+FOSSIL_TEST_CASE(c_test_hostsys_process) {
+    fossil_hostsys_process_t before;
+    fossil_hostsys_process_t after;
+    ASSUME_ITS_TRUE(fossil_hostsys_process_get(&before, false));
+    ASSUME_ITS_TRUE(before.pss == 0);
+
+    // Touching fresh pages shows up as resident memory and minor faults
+    size_t size = 16 * 1024 * 1024;
+    char *block = malloc(size);
+    ASSUME_NOT_CNULL(block);
+    memset(block, 1, size);
+    FILE *file = fopen("fossil_hostsys_fd.txt", "w");
+    ASSUME_ITS_TRUE(fossil_hostsys_process_get(&after, true));
+    fclose(file);
+    remove("fossil_hostsys_fd.txt");
+    free(block);
+
+    ASSUME_ITS_TRUE(after.timestamp > before.timestamp);
+    ASSUME_ITS_TRUE(after.threads >= 1);
+#if defined(__linux__) || defined(__APPLE__)
+    ASSUME_ITS_TRUE(after.rss > before.rss);
+    ASSUME_ITS_TRUE(after.open_fds == before.open_fds + 1);
+#endif
+#ifdef __linux__
+    ASSUME_ITS_TRUE(after.minor_faults > before.minor_faults);
+    ASSUME_ITS_TRUE(after.pss > 0 && after.pss <= after.rss);
+#endif
+}
+
+FOSSIL_TEST_CASE(c_test_hostsys_place) {
+    // Two packages of two cores with two SMT threads, siblings numbered four apart
+    fossil_hostsys_cpu_t cpus[8];
+    for (int32_t c = 0; c < 8; ++c) {
+        fossil_hostsys_cpu_t cpu = { c, c % 4, (c % 4) / 2, (c % 4) / 2, c / 4, c % 4, (c % 4) / 2 };
+        cpus[c] = cpu;
+    }
+    fossil_hostsys_topology_t topo;
+    memset(&topo, 0, sizeof(topo));
+    topo.num_cpus = 8;
+    topo.cpus = cpus;
+
+    const int32_t compact[8] = { 0, 4, 1, 5, 2, 6, 3, 7 };
+    const int32_t scatter[8] = { 0, 2, 1, 3, 4, 6, 5, 7 };
+    for (int32_t w = 0; w < 8; ++w) {
+        ASSUME_ITS_EQUAL_I32(compact[w], placed_cpu(&topo, FOSSIL_HOSTSYS_PLACE_COMPACT, w, NULL));
+        ASSUME_ITS_EQUAL_I32(scatter[w], placed_cpu(&topo, FOSSIL_HOSTSYS_PLACE_SCATTER, w, NULL));
+        ASSUME_ITS_EQUAL_I32(w % 4, placed_cpu(&topo, FOSSIL_HOSTSYS_PLACE_PHYSICAL, w, NULL));
+    }
+
+    // A core whose first sibling is off limits is still used through the other one
+    fossil_hostsys_cpuset_t allowed;
+    fossil_hostsys_cpuset_clear(&allowed);
+    for (int32_t c = 1; c < 8; ++c) {
+        fossil_hostsys_cpuset_add(&allowed, c);
+    }
+    ASSUME_ITS_EQUAL_I32(4, placed_cpu(&topo, FOSSIL_HOSTSYS_PLACE_PHYSICAL, 0, &allowed));
+    ASSUME_ITS_EQUAL_I32(1, placed_cpu(&topo, FOSSIL_HOSTSYS_PLACE_PHYSICAL, 1, &allowed));
+    fossil_hostsys_cpuset_clear(&allowed);
+    ASSUME_ITS_EQUAL_I32(-1, placed_cpu(&topo, FOSSIL_HOSTSYS_PLACE_COMPACT, 0, &allowed));
+
+    fossil_hostsys_cpuset_t set;
+    ASSUME_ITS_TRUE(fossil_hostsys_cpuset_domain(&topo, FOSSIL_HOSTSYS_DOMAIN_L3, 1, &set));
+    ASSUME_ITS_EQUAL_I32(4, fossil_hostsys_cpuset_count(&set));
+    ASSUME_ITS_TRUE(fossil_hostsys_cpuset_has(&set, 2) && fossil_hostsys_cpuset_has(&set, 7));
+    ASSUME_ITS_TRUE(fossil_hostsys_cpuset_domain(&topo, FOSSIL_HOSTSYS_DOMAIN_CORE, 0, &set));
+    ASSUME_ITS_EQUAL_I32(2, fossil_hostsys_cpuset_count(&set));
+    ASSUME_ITS_TRUE(fossil_hostsys_cpuset_has(&set, 0) && fossil_hostsys_cpuset_has(&set, 4));
+    ASSUME_ITS_FALSE(fossil_hostsys_cpuset_domain(&topo, FOSSIL_HOSTSYS_DOMAIN_NUMA, 5, &set));
+}
+
+FOSSIL_TEST_CASE(c_test_hostsys_pin) {
+    fossil_hostsys_cpuset_t original;
+    ASSUME_ITS_TRUE(fossil_hostsys_affinity_self(&original));
+    ASSUME_ITS_TRUE(fossil_hostsys_cpuset_count(&original) >= 1);
+
+    fossil_hostsys_cpuset_t target;
+    ASSUME_ITS_TRUE(fossil_hostsys_place(fossil_hostsys_topology(), FOSSIL_HOSTSYS_PLACE_COMPACT, 0, &original, &target));
+    int32_t cpu = -1;
+    fossil_hostsys_thread_t *thread = fossil_hostsys_thread_start(&target, report_cpu, &cpu);
+    ASSUME_NOT_CNULL(thread);
+    ASSUME_ITS_TRUE(fossil_hostsys_thread_join(thread) == &cpu);
+#if defined(__linux__) || defined(_WIN32)
+    ASSUME_ITS_TRUE(fossil_hostsys_cpuset_has(&target, cpu));
+
+    ASSUME_ITS_TRUE(fossil_hostsys_pin_self(&target));
+    fossil_hostsys_cpuset_t pinned;
+    ASSUME_ITS_TRUE(fossil_hostsys_affinity_self(&pinned));
+#ifdef __linux__
+    ASSUME_ITS_EQUAL_I32(1, fossil_hostsys_cpuset_count(&pinned));
+#endif
+    ASSUME_ITS_TRUE(fossil_hostsys_cpuset_has(&target, fossil_hostsys_current_cpu()));
+    ASSUME_ITS_TRUE(fossil_hostsys_pin_self(&original));
+#endif
+    fossil_hostsys_cpuset_t empty;
+    fossil_hostsys_cpuset_clear(&empty);
+    ASSUME_ITS_FALSE(fossil_hostsys_pin_self(&empty));
+}
+
+FOSSIL_TEST_CASE(c_test_hostsys_timer) {
+    ASSUME_ITS_TRUE(fossil_hostsys_timer_frequency() > 0);
+    uint64_t first = fossil_hostsys_ticks();
+    uint64_t second = fossil_hostsys_ticks();
+    ASSUME_ITS_TRUE(second >= first);
+    // Whole seconds of ticks convert exactly, and half a second to within rounding
+    uint64_t rate = (uint64_t)fossil_hostsys_timer_frequency();
+    for (uint64_t seconds = 1; seconds <= 3600; seconds *= 60) {
+        ASSUME_ITS_TRUE(fossil_hostsys_ticks_to_ns(rate * seconds) == (int64_t)seconds * 1000000000);
+    }
+    int64_t half = fossil_hostsys_ticks_to_ns(rate / 2);
+    ASSUME_ITS_TRUE(half >= 499999999 && half <= 500000000);
+    ASSUME_ITS_TRUE(fossil_hostsys_ticks_to_ns(0) == 0);
+
+    fossil_hostsys_timer_t timer;
+    fossil_hostsys_timer_start(&timer);
+    int64_t start_ns = fossil_hostsys_now_ns();
+    wait_ms(20);
+    int64_t elapsed = fossil_hostsys_timer_elapsed_ns(&timer);
+    int64_t span = fossil_hostsys_now_ns() - start_ns;
+    ASSUME_ITS_TRUE(elapsed >= 19000000 && elapsed < 2000000000);
+    ASSUME_ITS_TRUE(span >= 19000000 && span < 2000000000);
+    ASSUME_ITS_TRUE(fossil_hostsys_timer_lap_ns(&timer) >= elapsed);
+    ASSUME_ITS_TRUE(fossil_hostsys_timer_elapsed_ns(&timer) < elapsed);
+
+#ifdef CLOCK_MONOTONIC
+    // The counter-derived clock stays on the CLOCK_MONOTONIC timeline
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t drift = fossil_hostsys_now_ns() - ((int64_t)now.tv_sec * 1000000000 + now.tv_nsec);
+    ASSUME_ITS_TRUE(drift > -5000000 && drift < 5000000);
+#endif
+
+    fossil_hostsystem_t info;
+    ASSUME_ITS_TRUE(fossil_hostsys_get(&info));
+    ASSUME_ITS_TRUE(info.timer_frequency == fossil_hostsys_timer_frequency());
+    ASSUME_ITS_TRUE(info.invariant_tsc == fossil_hostsys_invariant_tsc());
+}
+
+FOSSIL_TEST_CASE(c_test_hostsys_report_json) {
+    size_t length = fossil_hostsys_report_json(NULL, 0);
+    ASSUME_ITS_TRUE(length > 0);
+    char *report = malloc(length + 1);
+    ASSUME_NOT_CNULL(report);
+    ASSUME_ITS_TRUE(fossil_hostsys_report_json(report, length + 1) == length);
+    ASSUME_ITS_TRUE(strlen(report) == length);
+    ASSUME_ITS_TRUE(report[0] == '{' && report[length - 1] == '}');
+
+    // Brackets balance outside strings
+    int depth = 0;
+    bool quoted = false;
+    for (size_t i = 0; i < length && depth >= 0; ++i) {
+        if (quoted) {
+            if (report[i] == '\\') {
+                ++i;
+            } else if (report[i] == '"') {
+                quoted = false;
+            }
+        } else if (report[i] == '"') {
+            quoted = true;
+        } else if (report[i] == '{' || report[i] == '[') {
+            ++depth;
+        } else if (report[i] == '}' || report[i] == ']') {
+            --depth;
+        }
+    }
+    ASSUME_ITS_TRUE(depth == 0 && !quoted);
+
+    char expected[64];
+    snprintf(expected, sizeof(expected), "{\"fingerprint\":\"%016llx\"", (unsigned long long)fossil_hostsys_fingerprint());
+    ASSUME_ITS_TRUE(strncmp(report, expected, strlen(expected)) == 0);
+    ASSUME_NOT_CNULL(strstr(report, "\"caches\":["));
+    ASSUME_NOT_CNULL(strstr(report, "\"numa\":[{\"node\":"));
+    ASSUME_NOT_CNULL(strstr(report, "\"thp\":"));
+
+    // A short buffer keeps a terminated prefix
+    char prefix[16];
+    ASSUME_ITS_TRUE(fossil_hostsys_report_json(prefix, sizeof(prefix)) == length);
+    ASSUME_ITS_TRUE(strlen(prefix) == sizeof(prefix) - 1);
+    ASSUME_ITS_TRUE(strncmp(prefix, report, sizeof(prefix) - 1) == 0);
+    free(report);
+}
+
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Pool
 // * * * * * * * * * * * * * * * * * * * * * * * *
@@ -63,6 +484,16 @@ FOSSIL_TEST_CASE(c_test_hostsys_endian) {
 FOSSIL_TEST_GROUP(c_hostsys_tests) {
     FOSSIL_TEST_ADD(c_hostsys_suite, c_test_hostsys_get);
     FOSSIL_TEST_ADD(c_hostsys_suite, c_test_hostsys_endian);
+    FOSSIL_TEST_ADD(c_hostsys_suite, c_test_hostsys_topology_load);
+    FOSSIL_TEST_ADD(c_hostsys_suite, c_test_hostsys_features);
+    FOSSIL_TEST_ADD(c_hostsys_suite, c_test_hostsys_limits_load);
+    FOSSIL_TEST_ADD(c_hostsys_suite, c_test_hostsys_cached);
+    FOSSIL_TEST_ADD(c_hostsys_suite, c_test_hostsys_sampler);
+    FOSSIL_TEST_ADD(c_hostsys_suite, c_test_hostsys_process);
+    FOSSIL_TEST_ADD(c_hostsys_suite, c_test_hostsys_place);
+    FOSSIL_TEST_ADD(c_hostsys_suite, c_test_hostsys_pin);
+    FOSSIL_TEST_ADD(c_hostsys_suite, c_test_hostsys_timer);
+    FOSSIL_TEST_ADD(c_hostsys_suite, c_test_hostsys_report_json);
 
     FOSSIL_TEST_REGISTER(c_hostsys_suite);
 }
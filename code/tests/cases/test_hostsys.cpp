@@ -14,6 +14,11 @@
 #include <fossil/test/framework.h>
 
 #include "fossil/lib/framework.h"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
 
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Utilities
@@ -56,6 +61,217 @@ FOSSIL_TEST_CASE(cpp_test_hostsys_endian) {
     ASSUME_ITS_EQUAL_CSTR(fossil_hostsys_endian(&info), info.is_big_endian ? "Big Endian" : "Little Endian");
 }
 
+FOSSIL_TEST_CASE(cpp_test_hostsys_topology) {
+    const fossil_hostsys_topology_t *topology = fossil_hostsys_topology();
+    ASSUME_ITS_TRUE(topology == fossil_hostsys_topology());
+    ASSUME_ITS_TRUE(topology->num_cpus >= 1);
+    ASSUME_ITS_TRUE(topology->num_cores >= 1 && topology->num_cores <= topology->num_cpus);
+
+    for (int32_t i = 0; i < topology->num_cpus; ++i) {
+        const fossil_hostsys_cpu_t *cpu = &topology->cpus[i];
+        ASSUME_ITS_TRUE(fossil_hostsys_topology_cpu(topology, cpu->cpu) == cpu);
+        ASSUME_ITS_TRUE(cpu->core >= 0 && cpu->core < topology->num_cores);
+        ASSUME_ITS_TRUE(cpu->smt_index < topology->threads_per_core);
+    }
+
+    fossil_hostsystem_t info;
+    ASSUME_ITS_TRUE(fossil_hostsys_get(&info));
+    ASSUME_ITS_EQUAL_I32(topology->num_cores, info.physical_cores);
+}
+
+FOSSIL_TEST_CASE(cpp_test_hostsys_feature_string) {
+    ASSUME_ITS_EQUAL_CSTR("avx2", fossil_hostsys_feature_name(FOSSIL_HOSTSYS_FEATURE_AVX2));
+    ASSUME_ITS_TRUE(fossil_hostsys_feature_name(FOSSIL_HOSTSYS_FEATURE_AVX | FOSSIL_HOSTSYS_FEATURE_AVX2) == nullptr);
+
+    char text[32];
+    uint64_t mask = FOSSIL_HOSTSYS_FEATURE_SSE2 | FOSSIL_HOSTSYS_FEATURE_NEON;
+    ASSUME_ITS_TRUE(fossil_hostsys_feature_string(mask, text, sizeof(text)) == 9);
+    ASSUME_ITS_EQUAL_CSTR("sse2 neon", text);
+
+    // Truncated output stays terminated and reports the full length
+    char small[6];
+    ASSUME_ITS_TRUE(fossil_hostsys_feature_string(mask, small, sizeof(small)) == 9);
+    ASSUME_ITS_EQUAL_CSTR("sse2 ", small);
+}
+
+FOSSIL_TEST_CASE(cpp_test_hostsys_effective) {
+    fossil_hostsys_limits_t limits;
+    ASSUME_ITS_TRUE(fossil_hostsys_limits_load(nullptr, &limits));
+    ASSUME_ITS_TRUE(limits.effective_cpus >= 1 && limits.effective_cpus <= limits.affinity_cpus);
+    ASSUME_ITS_TRUE(limits.effective_memory > 0);
+
+    fossil_hostsystem_t info;
+    ASSUME_ITS_TRUE(fossil_hostsys_get(&info));
+    ASSUME_ITS_TRUE(info.effective_cpus >= 1 && info.effective_cpus <= info.cpu_cores);
+    ASSUME_ITS_TRUE(info.effective_memory <= info.total_memory);
+
+    // A thread pinned to one CPU does not narrow the process-wide view
+    fossil_hostsys_cpuset_t one;
+    ASSUME_ITS_TRUE(fossil_hostsys_place(fossil_hostsys_topology(), FOSSIL_HOSTSYS_PLACE_COMPACT, 0, nullptr, &one));
+    fossil_hostsys_set_staleness(0);
+    fossil_hostsys_thread_t *thread = fossil_hostsys_thread_start(&one, [](void *arg) -> void* {
+        fossil_hostsys_limits_load(nullptr, static_cast<fossil_hostsys_limits_t*>(arg));
+        fossil_hostsystem_t seen;
+        fossil_hostsys_get(&seen);
+        return nullptr;
+    }, &limits);
+    ASSUME_NOT_CNULL(thread);
+    fossil_hostsys_thread_join(thread);
+    fossil_hostsys_limits_t main_view;
+    ASSUME_ITS_TRUE(fossil_hostsys_limits_load(nullptr, &main_view));
+    ASSUME_ITS_EQUAL_I32(main_view.affinity_cpus, limits.affinity_cpus);
+    fossil_hostsystem_t after;
+    ASSUME_ITS_TRUE(fossil_hostsys_get(&after));
+    ASSUME_ITS_EQUAL_I32(info.effective_cpus, after.effective_cpus);
+    fossil_hostsys_set_staleness(_FOSSIL_HOSTSYS_STALENESS);
+}
+
+FOSSIL_TEST_CASE(cpp_test_hostsys_sampler_readers) {
+    fossil_hostsys_sampler_t *sampler = fossil_hostsys_sampler_start(1000000);
+    ASSUME_NOT_CNULL(sampler);
+    std::atomic<int> torn{0};
+
+    // Every reader must see whole samples in publication order
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&] {
+            fossil_hostsys_sample_t sample;
+            uint64_t last_sequence = 0;
+            int64_t last_timestamp = 0;
+            for (int i = 0; i < 20000; ++i) {
+                if (!fossil_hostsys_sampler_read(sampler, &sample, nullptr, 0)) {
+                    continue;
+                }
+                if (sample.sequence < last_sequence || sample.timestamp < last_timestamp ||
+                    (sample.sequence == last_sequence && sample.timestamp != last_timestamp)) {
+                    ++torn;
+                }
+                last_sequence = sample.sequence;
+                last_timestamp = sample.timestamp;
+            }
+        });
+    }
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    fossil_hostsys_sampler_stop(sampler);
+    ASSUME_ITS_EQUAL_I32(0, torn.load());
+}
+
+FOSSIL_TEST_CASE(cpp_test_hostsys_process_threads) {
+    fossil_hostsys_process_t before;
+    ASSUME_ITS_TRUE(fossil_hostsys_process_get(&before, false));
+
+    std::atomic<bool> release{false};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 3; ++t) {
+        workers.emplace_back([&] {
+            while (!release.load()) {
+                std::this_thread::yield();
+            }
+        });
+    }
+    fossil_hostsys_process_t during;
+    ASSUME_ITS_TRUE(fossil_hostsys_process_get(&during, false));
+    release = true;
+    for (auto &worker : workers) {
+        worker.join();
+    }
+#if defined(__linux__) || defined(__APPLE__) || defined(_WIN32)
+    ASSUME_ITS_TRUE(during.threads >= before.threads + 3);
+#endif
+}
+
+FOSSIL_TEST_CASE(cpp_test_hostsys_pinned_pool) {
+    const fossil_hostsys_topology_t *topo = fossil_hostsys_topology();
+    fossil_hostsys_cpuset_t allowed;
+    ASSUME_ITS_TRUE(fossil_hostsys_affinity_self(&allowed));
+
+    // One worker per physical core never lands two workers on the same core
+    std::vector<fossil_hostsys_cpuset_t> sets(4);
+    std::vector<int32_t> ran(sets.size(), -1);
+    std::vector<fossil_hostsys_thread_t*> threads;
+    for (size_t w = 0; w < sets.size(); ++w) {
+        ASSUME_ITS_TRUE(fossil_hostsys_place(topo, FOSSIL_HOSTSYS_PLACE_PHYSICAL, (int32_t)w, &allowed, &sets[w]));
+        threads.push_back(fossil_hostsys_thread_start(&sets[w], [](void *arg) -> void* {
+            *static_cast<int32_t*>(arg) = fossil_hostsys_current_cpu();
+            return nullptr;
+        }, &ran[w]));
+        ASSUME_NOT_CNULL(threads.back());
+    }
+    for (auto *thread : threads) {
+        fossil_hostsys_thread_join(thread);
+    }
+    int32_t cores = 0;
+    for (int32_t core = 0; core < topo->num_cores; ++core) {
+        fossil_hostsys_cpuset_t set;
+        if (fossil_hostsys_cpuset_domain(topo, FOSSIL_HOSTSYS_DOMAIN_CORE, core, &set)) {
+            int32_t workers = 0;
+            for (auto &placed : sets) {
+                for (int32_t cpu = 0; cpu < _FOSSIL_HOSTSYS_MAX_CPUS; ++cpu) {
+                    workers += fossil_hostsys_cpuset_has(&placed, cpu) && fossil_hostsys_cpuset_has(&set, cpu);
+                }
+            }
+            cores += workers > 0;
+            ASSUME_ITS_TRUE(workers <= ((int32_t)sets.size() + topo->num_cores - 1) / topo->num_cores);
+        }
+    }
+    ASSUME_ITS_TRUE(cores >= 1);
+#if defined(__linux__) || defined(_WIN32)
+    for (size_t w = 0; w < sets.size(); ++w) {
+        ASSUME_ITS_TRUE(fossil_hostsys_cpuset_has(&sets[w], ran[w]));
+    }
+#endif
+}
+
+FOSSIL_TEST_CASE(cpp_test_hostsys_timed) {
+    int64_t elapsed = -1;
+    FOSSIL_HOSTSYS_TIMED(elapsed) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSUME_ITS_TRUE(elapsed >= 9000000 && elapsed < 2000000000);
+
+    // Readings taken on other threads share one timeline
+    std::vector<int64_t> stamps(4);
+    std::vector<std::thread> workers;
+    int64_t before = fossil_hostsys_now_ns();
+    for (size_t t = 0; t < stamps.size(); ++t) {
+        workers.emplace_back([&stamps, t] { stamps[t] = fossil_hostsys_now_ns(); });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    int64_t after = fossil_hostsys_now_ns();
+    for (int64_t stamp : stamps) {
+        ASSUME_ITS_TRUE(stamp >= before && stamp <= after);
+    }
+}
+
+FOSSIL_TEST_CASE(cpp_test_hostsys_fingerprint) {
+    // Load and memory churn between calls leave the fingerprint alone
+    uint64_t fingerprint = fossil_hostsys_fingerprint();
+    std::vector<uint64_t> seen(4);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < seen.size(); ++t) {
+        workers.emplace_back([&seen, t] {
+            std::vector<char> churn(1 << 20, 1);
+            seen[t] = fossil_hostsys_fingerprint();
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    for (uint64_t value : seen) {
+        ASSUME_ITS_TRUE(value == fingerprint);
+    }
+
+    std::string report(fossil_hostsys_report_json(nullptr, 0), '\0');
+    fossil_hostsys_report_json(&report[0], report.size() + 1);
+    for (const char *key : { "\"os\":", "\"cpu\":", "\"topology\":", "\"memory\":", "\"limits\":" }) {
+        ASSUME_ITS_TRUE(report.find(key) != std::string::npos);
+    }
+}
+
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Pool
 // * * * * * * * * * * * * * * * * * * * * * * * *
@@ -63,6 +279,14 @@ FOSSIL_TEST_CASE(cpp_test_hostsys_endian) {
 FOSSIL_TEST_GROUP(cpp_hostsys_tests) {
     FOSSIL_TEST_ADD(cpp_hostsys_suite, cpp_test_hostsys_get);
     FOSSIL_TEST_ADD(cpp_hostsys_suite, cpp_test_hostsys_endian);
+    FOSSIL_TEST_ADD(cpp_hostsys_suite, cpp_test_hostsys_topology);
+    FOSSIL_TEST_ADD(cpp_hostsys_suite, cpp_test_hostsys_feature_string);
+    FOSSIL_TEST_ADD(cpp_hostsys_suite, cpp_test_hostsys_effective);
+    FOSSIL_TEST_ADD(cpp_hostsys_suite, cpp_test_hostsys_sampler_readers);
+    FOSSIL_TEST_ADD(cpp_hostsys_suite, cpp_test_hostsys_process_threads);
+    FOSSIL_TEST_ADD(cpp_hostsys_suite, cpp_test_hostsys_pinned_pool);
+    FOSSIL_TEST_ADD(cpp_hostsys_suite, cpp_test_hostsys_timed);
+    FOSSIL_TEST_ADD(cpp_hostsys_suite, cpp_test_hostsys_fingerprint);
 
     FOSSIL_TEST_REGISTER(cpp_hostsys_suite);
 }